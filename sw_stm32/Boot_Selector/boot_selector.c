@@ -0,0 +1,232 @@
+/** *****************************************************************************
+ * @file    	boot_selector.c
+ * @brief   	resident boot selector for the A/B application slots
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+/* Runs from flash sector 0 after every reset, without HAL and without RAM variables.
+ *
+ * 1. A slot started on trial that has not been confirmed has failed: revoke it.
+ *    A power-on or brown-out reset is no failure, the trial is repeated.
+ * 2. A valid, new (pending) slot with a higher sequence number than the confirmed
+ *    one gets the trial mark and is started with the independent watchdog running.
+ * 3. Otherwise the valid confirmed slot with the highest sequence number is started.
+ * 4. Without a confirmed slot the intact slot with the highest sequence number is
+ *    started, revoked or not: an application is needed to install an update.
+ *
+ * All state changes are one-way flash marks, see boot_slots.h.
+ * A slot confirmed after its revocation (case 4) has proven its health,
+ * the confirmation wins. The reset flags are left for the application.
+ */
+
+#include "stm32f4xx.h"
+#include "stdbool.h"
+#include "boot_slots.h"
+
+#define LSI_HZ			32000
+#define IWDG_PRESCALER_256	6
+#define IWDG_RELOAD		( BOOT_TRIAL_TIMEOUT_S * LSI_HZ / 256)
+
+#if IWDG_RELOAD > 0xfff
+#error BOOT_TRIAL_TIMEOUT_S too long for the independent watchdog
+#endif
+
+static const uint32_t slots[2] = { BOOT_SLOT_A_ADDRESS, BOOT_SLOT_B_ADDRESS };
+
+//! hardware CRC as stm32_crc(), with the state words taken as erased
+static uint32_t slot_crc( const uint32_t * header, uint32_t words)
+{
+  CRC->CR = CRC_CR_RESET;
+  for( uint32_t i = BOOT_SLOT_HEADER_VERSION; i < words; ++i)
+    if( ( i >= BOOT_SLOT_SEQUENCE) && ( i < BOOT_SLOT_SEQUENCE + BOOT_SLOT_STATE_WORDS))
+      CRC->DR = BOOT_SLOT_ERASED;
+    else
+      CRC->DR = header[i];
+  return CRC->DR;
+}
+
+//! header and CRC, the state words not regarded
+static int slot_is_intact( uint32_t slot)
+{
+  const uint32_t * header = (const uint32_t *) slot;
+  uint32_t image_bytes = header[BOOT_SLOT_IMAGE_BYTES];
+
+  if( ( header[0] != (uint32_t) BOOT_SLOT_MAGIC_NUMBER)
+      || ( header[1] != (uint32_t) ( BOOT_SLOT_MAGIC_NUMBER >> 32))
+      || ( header[BOOT_SLOT_HEADER_VERSION] != 1)
+      || ( header[BOOT_SLOT_LINK_ADDRESS] != slot)
+      || ( image_bytes <= BOOT_SLOT_HEADER_BYTES)
+      || ( image_bytes > BOOT_SLOT_BYTES)
+      || ( image_bytes % sizeof( uint32_t) != 0))
+    return 0;
+
+  return slot_crc( header, image_bytes / sizeof( uint32_t)) == header[BOOT_SLOT_CRC];
+}
+
+//! the migration image installs slot A without sequence number
+static uint32_t slot_sequence( uint32_t slot)
+{
+  uint32_t sequence = ((const uint32_t *) slot)[BOOT_SLOT_SEQUENCE];
+  return ( sequence == BOOT_SLOT_ERASED) ? 0 : sequence;
+}
+
+static uint32_t slot_state( uint32_t slot, uint32_t word)
+{
+  return ((const uint32_t *) slot)[word];
+}
+
+static int slot_is_valid( uint32_t slot)
+{
+  if(    ( slot_state( slot, BOOT_SLOT_REVOKED_MARK) == BOOT_SLOT_MARKED)
+      && ( slot_state( slot, BOOT_SLOT_CONFIRMED_MARK) == BOOT_SLOT_ERASED))
+    return 0;
+
+  return slot_is_intact( slot);
+}
+
+static void program_mark( uint32_t slot, uint32_t word)
+{
+  FLASH->KEYR = 0x45670123;
+  FLASH->KEYR = 0xCDEF89AB;
+  FLASH->SR = FLASH_SR_EOP | FLASH_SR_SOP | FLASH_SR_WRPERR
+      | FLASH_SR_PGAERR | FLASH_SR_PGPERR | FLASH_SR_PGSERR;
+  FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_PG; // 32-bit words
+
+  *(volatile uint32_t *) ( slot + word * sizeof( uint32_t)) = BOOT_SLOT_MARKED;
+  __DSB();
+  while( FLASH->SR & FLASH_SR_BSY)
+    ;
+
+  FLASH->CR = FLASH_CR_LOCK;
+}
+
+static void start_trial_watchdog( void)
+{
+  IWDG->KR = 0x5555; // write access to PR and RLR
+  IWDG->PR = IWDG_PRESCALER_256;
+  IWDG->RLR = IWDG_RELOAD;
+  while( IWDG->SR != 0)
+    ;
+  IWDG->KR = 0xCCCC; // start, can not be stopped until the next reset
+}
+
+static void start_application( uint32_t slot)
+{
+  const uint32_t * vectors = (const uint32_t *) ( slot + BOOT_SLOT_HEADER_BYTES);
+
+  RCC->AHB1ENR &= ~RCC_AHB1ENR_CRCEN;
+  SCB->VTOR = (uint32_t) vectors;
+  __DSB();
+  __ISB();
+  __set_MSP( vectors[0]);
+  ((void (*)( void)) vectors[1])();
+}
+
+void Reset_Handler( void)
+{
+  uint32_t confirmed = 0;
+  uint32_t pending = 0;
+  uint32_t interrupted = 0;
+  uint32_t fallback = 0;
+
+  RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+  __DSB();
+
+  // the application clears the flags: a watchdog or software reset since the power-on is a failure
+  uint32_t reset_flags = RCC->CSR;
+  bool power_lost =    ( ( reset_flags & ( RCC_CSR_PORRSTF | RCC_CSR_BORRSTF)) != 0)
+		    && ( ( reset_flags & ( RCC_CSR_IWDGRSTF | RCC_CSR_WWDGRSTF | RCC_CSR_SFTRSTF)) == 0);
+
+  for( unsigned i = 0; i < 2; ++i)
+    if(    ( slot_state( slots[i], BOOT_SLOT_TRIAL_MARK) == BOOT_SLOT_MARKED)
+	&& ( slot_state( slots[i], BOOT_SLOT_CONFIRMED_MARK) == BOOT_SLOT_ERASED)
+	&& ( slot_state( slots[i], BOOT_SLOT_REVOKED_MARK) == BOOT_SLOT_ERASED))
+      {
+	if( power_lost)
+	  interrupted = slots[i]; // not the application's fault
+	else
+	  program_mark( slots[i], BOOT_SLOT_REVOKED_MARK); // the trial has failed
+      }
+
+  for( unsigned i = 0; i < 2; ++i)
+    {
+      uint32_t slot = slots[i];
+      if( ! slot_is_intact( slot))
+	continue;
+
+      if( ( fallback == 0) || ( slot_sequence( slot) > slot_sequence( fallback)))
+	fallback = slot;
+
+      if( ! slot_is_valid( slot))
+	continue;
+
+      if( slot_state( slot, BOOT_SLOT_CONFIRMED_MARK) == BOOT_SLOT_MARKED)
+	{
+	  if( ( confirmed == 0) || ( slot_sequence( slot) > slot_sequence( confirmed)))
+	    confirmed = slot;
+	}
+      else if( slot_state( slot, BOOT_SLOT_TRIAL_MARK) == BOOT_SLOT_ERASED)
+	pending = slot;
+    }
+
+  if( interrupted && slot_is_intact( interrupted)
+      && ( ( confirmed == 0) || ( slot_sequence( interrupted) > slot_sequence( confirmed))))
+    {
+      start_trial_watchdog(); // the trial starts again
+      start_application( interrupted);
+    }
+
+  if( pending && ( ( confirmed == 0) || ( slot_sequence( pending) > slot_sequence( confirmed))))
+    {
+      program_mark( pending, BOOT_SLOT_TRIAL_MARK);
+      start_trial_watchdog();
+      start_application( pending);
+    }
+
+  if( confirmed)
+    start_application( confirmed);
+
+  if( fallback) // better than nothing: the application can install an update
+    start_application( fallback);
+
+  while( true) // nothing intact to start, the uSD card can not help without an application
+    __WFI();
+}
+
+static void Default_Handler( void)
+{
+  while( true)
+    ; // the trial watchdog, if running, resets and the trial fails
+}
+
+extern uint32_t _estack;
+
+__attribute__((section(".isr_vector"), used))
+static const void * const vectors[] =
+{
+  &_estack,
+  Reset_Handler,
+  Default_Handler, // NMI
+  Default_Handler, // HardFault
+  Default_Handler, // MemManage
+  Default_Handler, // BusFault
+  Default_Handler, // UsageFault
+};
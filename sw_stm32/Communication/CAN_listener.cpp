@@ -32,6 +32,8 @@
 #include "watchdog_handler.h"
 #include "system_state.h"
 #include "communicator.h"
+#include "EEPROM_data_file_implementation.h"
+#include "warm_restart.h"
 
 #define CAN_Id_Send_Config_Value 0x12f
 
@@ -82,7 +84,7 @@ bool EEPROM_config_read_write( const CANpacket & p, float & return_value)
       {
 	float value = p.data_f[1];
 
-	(void) write_EEPROM_value( id, value); // no way to report errors here ...
+	(void) write_EEPROM_value_deferred( id, value); // no way to report errors here ...
 	communicator_command_queue.send( SOME_EEPROM_VALUE_HAS_CHANGED, 1);
 	return false; // report "nothing read"
       }
@@ -233,6 +235,9 @@ CAN_listener_task_runnable (void*)
 		    communicator_command_queue.send( FINE_TUNE_CALIB, 1);
 		    break;
 		  case CMD_RESET_SENSOR:
+		    if( not flush_deferred_EEPROM_values()) // typically: set values, then reset
+		      break; // refused: the values acknowledged via CAN would be lost
+		    request_cold_restart();
 	#if CRASFILE_ON_USER_RESET == 0
 		    user_initiated_reset = true;
 	#endif
@@ -25,6 +25,8 @@
 #include "FreeRTOS_wrapper.h"
 #include "CAN_output.h"
 #include "communicator.h"
+#include "EEPROM_data_file_implementation.h"
+#include "boot_timeline.h"
 
 COMMON Queue <CANpacket> CAN_pipeline( 5);
 
@@ -38,14 +40,21 @@ void CAN_task_runnable( void *)
   suspend();
 
   bool horizon_available = configuration( HORIZON);
+  uint32_t configuration_seen = configuration_generation();
   unsigned decimator_1_second=10;
 
-  delay(5000); // allow data acquisition setup
-
+  // resumed by the communicator when the data acquisition is set up
   while( true)
     {
       notify_take(); // synchronize with data acquisition
+
+      if( configuration_generation() != configuration_seen) // horizon may be set via CAN or NMEA
+	{
+	  configuration_seen = configuration_generation();
+	  horizon_available = configuration( HORIZON);
+	}
       CAN_output( observations, coordinates, state_vector, horizon_available);
+      boot_milestone( BOOT_FIRST_CAN_OUTPUT);
 
       --decimator_1_second;
       if( decimator_1_second < 1)
@@ -36,6 +36,8 @@
 #include "system_state.h"
 #include "sensor_dump.h"
 #include "uSD_handler.h"
+#include "EEPROM_data_file_implementation.h"
+#include "boot_timeline.h"
 
 COMMON string_buffer_t __ALIGNED( sizeof(string_buffer_t)) NMEA_buf;
 extern USBD_HandleTypeDef hUsbDeviceFS; // from usb_device.c
@@ -47,6 +49,7 @@ static void NMEA_runnable (void* data)
   suspend(); // and wait until the communicator wakes us up
 
   bool horizon_available = configuration( HORIZON);
+  uint32_t configuration_seen = configuration_generation();
 
 
 #if ACTIVATE_USB_NMEA
@@ -93,8 +96,28 @@ re_initialize: // in case of USART hangup
   }
 
   unsigned decimating_counter = NMEA_DECIMATION_RATIO;
+#if ACTIVATE_USB_NMEA
+  unsigned boot_timeline_countdown = BOOT_TIMELINE_REPORT_SECONDS * 1000 / NMEA_REPORTING_PERIOD;
+#endif
   for (synchronous_timer t (NMEA_REPORTING_PERIOD); true; t.sync ())
     {
+#if ACTIVATE_USB_NMEA
+      if( boot_timeline_countdown && ( --boot_timeline_countdown == 0))
+	{
+	  // this cycle: the boot timeline instead of the NMEA data
+	  NMEA_buf.length = format_boot_timeline( NMEA_buf.string) - NMEA_buf.string;
+	  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, (uint8_t *)NMEA_buf.string, NMEA_buf.length);
+	  USBD_CDC_TransmitPacket(&hUsbDeviceFS);
+	  continue;
+	}
+#endif
+
+      if( configuration_generation() != configuration_seen)
+	{
+	  configuration_seen = configuration_generation();
+	  horizon_available = configuration( HORIZON);
+	}
+
       NMEA_buf.length = 0; // start at the beginning of the buffer
       format_NMEA_string_fast( state_vector, NMEA_buf, horizon_available);
 #if NMEA_DECIMATION_RATIO == 0
@@ -154,6 +177,7 @@ re_initialize: // in case of USART hangup
       if( not success)
 	goto re_initialize;
 #endif
+      boot_milestone( BOOT_FIRST_NMEA_OUTPUT);
     }
 }
 
@@ -30,6 +30,7 @@
 #include "ascii_support.h"
 #include "generic_CAN_driver.h"
 #include "CAN_output.h"
+#include "boot_timeline.h"
 
 #define MAX_LEN 40
 COMMON char rxNMEASentence[MAX_LEN];
@@ -37,7 +38,8 @@ COMMON int PLARScnt = 0;
 
 void NMEA_listener_task_runnable( void *)
 {
-  delay(5000); // allow data acquisition setup
+  // USART 1 is set up by the NMEA task before its first output
+  (void) wait_for_boot_milestones( BOOT_EVENT( BOOT_FIRST_NMEA_OUTPUT), 5000);
   char rxByte;
   int i = 0;
   int len = 0;
@@ -0,0 +1,170 @@
+/** *****************************************************************************
+ * @file    	black_box.h
+ * @brief   	always-on RAM ring of the most recent sensor, GNSS and state data
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef BLACK_BOX_H_
+#define BLACK_BOX_H_
+
+#include "stdint.h"
+#include "string.h"
+#include "system_configuration.h"
+#include "data_structures.h"
+
+/* The black box keeps the last BLACK_BOX_SECONDS of data in RAM, independent of
+ * the log file. It is written by the communicator task and read only after
+ * freeze(), which is called where a crash or a watchdog event is detected.
+ * write_crash_minidump() streams it to the uSD card.
+ *
+ * There is one producer and no lock: a record is published by incrementing
+ * records_written after the copy. A record being written when freeze() comes
+ * can only be the oldest one, so the reader leaves out the oldest slot.
+ *
+ * The black box lives in section .black_box, which shares one MPU region of
+ * the communicator task with the magnetic calibration data, see the linker script.
+ */
+
+extern uint32_t __black_box_region_start__[];
+extern uint32_t _Black_Box_Region_Size[];
+#define BLACK_BOX_REGION_START __black_box_region_start__
+#define BLACK_BOX_REGION_SIZE ( (uint32_t) _Black_Box_Region_Size) // check file STM32F407VGTX_FLASH.ld !
+
+enum black_box_stream
+{
+  BLACK_BOX_SENSOR_DATA = 1,	//!< measurement_data_t
+  BLACK_BOX_GNSS,		//!< D_GNSS_coordinates_t
+  BLACK_BOX_STATE_VECTOR,	//!< state_vector_t
+};
+
+//! fixed size records, each stamped with the 100 Hz sample number
+template <class record_type, unsigned SLOTS> class black_box_ring_t
+{
+public:
+  typedef struct
+  {
+    uint32_t sample;
+    record_type record;
+  } slot_t;
+
+  black_box_ring_t( void)
+  : records_written( 0)
+  {}
+
+  void put( uint32_t sample, const record_type & record)
+  {
+    slot_t & target = slot[records_written % SLOTS];
+    target.sample = sample;
+    memcpy( &target.record, &record, sizeof( record_type));
+    __asm volatile ( "" ::: "memory" ); // publish the record after its data
+    records_written = records_written + 1;
+  }
+
+  //! complete records, oldest first, in at most two pieces
+  unsigned get_records( const slot_t * begin[2], unsigned count[2]) const
+  {
+    uint32_t written = records_written;
+    unsigned available = written < SLOTS ? written : SLOTS - 1;
+    unsigned first = ( written - available) % SLOTS;
+    unsigned pieces = 0;
+    if( available == 0)
+      return 0;
+    begin[pieces] = slot + first;
+    count[pieces] = first + available <= SLOTS ? available : SLOTS - first;
+    available -= count[pieces++];
+    if( available > 0)
+      {
+	begin[pieces] = slot;
+	count[pieces++] = available;
+      }
+    return pieces;
+  }
+
+  uint32_t get_records_written( void) const
+  {
+    return records_written;
+  }
+
+private:
+  slot_t slot[SLOTS];
+  volatile uint32_t records_written; //!< maintained by the producer only
+};
+
+// one slot more than needed, the oldest one may be incomplete
+#define BLACK_BOX_SLOTS( rate_hz) ( BLACK_BOX_SECONDS * ( rate_hz) + 1)
+
+class black_box_t
+{
+public:
+  enum
+  {
+    SENSOR_DATA_SLOTS = BLACK_BOX_SLOTS( 100 / BLACK_BOX_SENSOR_DATA_DIVIDER),
+    GNSS_SLOTS = BLACK_BOX_SLOTS( 10),
+    STATE_VECTOR_SLOTS = BLACK_BOX_SLOTS( 100 / BLACK_BOX_STATE_VECTOR_DIVIDER)
+  };
+
+  black_box_t( void)
+  : sample( 0),
+    frozen( false)
+  {}
+
+  //! call @ 100 Hz
+  void update( const measurement_data_t & observations, const state_vector_t & state_vector)
+  {
+    if( frozen)
+      return;
+    if( sample % BLACK_BOX_SENSOR_DATA_DIVIDER == 0)
+      sensor_data.put( sample, observations);
+    if( sample % BLACK_BOX_STATE_VECTOR_DIVIDER == 0)
+      state_vectors.put( sample, state_vector);
+    ++sample;
+  }
+
+  //! call @ 10 Hz
+  void update_GNSS( const D_GNSS_coordinates_t & coordinates)
+  {
+    if( not frozen)
+      GNSS_data.put( sample, coordinates);
+  }
+
+  //! stop recording, may be called from exception context
+  void freeze( void)
+  {
+    frozen = true;
+  }
+
+  uint32_t get_sample( void) const
+  {
+    return sample;
+  }
+
+  black_box_ring_t <measurement_data_t, SENSOR_DATA_SLOTS> sensor_data;
+  black_box_ring_t <D_GNSS_coordinates_t, GNSS_SLOTS> GNSS_data;
+  black_box_ring_t <state_vector_t, STATE_VECTOR_SLOTS> state_vectors;
+
+private:
+  uint32_t sample;	//!< 100 Hz sample number
+  volatile bool frozen;
+};
+
+extern black_box_t black_box;
+
+#endif /* BLACK_BOX_H_ */
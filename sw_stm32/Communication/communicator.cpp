@@ -37,15 +37,68 @@
 #include "CAN_distributor.h"
 #include "uSD_handler.h"
 #include "persistent_data_file.h"
+#include "EEPROM_data_file_implementation.h"
 #include "communicator.h"
 #include "flexible_log_file_implementation.h"
+#include "compact_log_records.h"
+#include "log_rate_scheduler.h"
+#include "boot_slots.h"
+#include "black_box.h"
+#include "warm_restart.h"
+#include "boot_timeline.h"
+#include "embedded_math.h"
 
 COMMON D_GNSS_coordinates_t coordinates;
 COMMON measurement_data_t observations;
 COMMON float3vector external_magnetometer;
 COMMON state_vector_t state_vector;
 
+black_box_t __attribute__((section(".black_box"))) black_box;
+
 extern "C" void sync_logger (void);
+uint64_t getTime_usec (void);
+
+#if ANALYZE_WRITE_PERFORMANCE
+COMMON uint32_t logger_max_time_usec; //!< logger's share of the 100 Hz loop
+COMMON uint32_t loop_max_period_usec; //!< longest 100 Hz cycle, shows flash write stalls, see flash_write_statistics
+COMMON uint32_t black_box_max_time_usec; //!< black box share of the 100 Hz loop
+#endif
+
+#if LOG_COMPACT_SENSOR_DATA || LOG_STATE_VECTOR
+//!< encode a record in place into the log ring, start over with a keyframe if it had to be dropped
+static void append_compact_record( compact_record_codec_t & codec, flexible_log_file_record_type type, const void * record)
+{
+  ASSERT( codec.get_max_encoded_words() <= flexible_log_file_implementation_t::MAX_RESERVE_WORDS);
+  uint32_t * span = flex_file.reserve( type, codec.get_max_encoded_words());
+  if( span == 0)
+    {
+      codec.force_keyframe();
+      return;
+    }
+  unsigned words = codec.encode( (const uint32_t *)record, span);
+  if( not flex_file.commit( words))
+    codec.force_keyframe();
+}
+#endif
+
+#if LOG_COMPACT_SENSOR_DATA
+COMMON compact_record_codec_t sensor_data_codec(
+    sizeof(measurement_data_t) / sizeof(uint32_t), LOG_COMPACT_KEYFRAME_INTERVAL,
+    MEASUREMENT_DATA_FIELDS, MEASUREMENT_DATA_FIELD_COUNT);
+#endif
+
+#if LOG_STATE_VECTOR
+COMMON compact_record_codec_t state_vector_codec(
+    sizeof(state_vector_t) / sizeof(uint32_t), LOG_COMPACT_KEYFRAME_INTERVAL);
+#endif
+
+//!< log the flight phase and the decimation ratios now in effect
+static void log_rate_record( const log_rate_scheduler_t & scheduler)
+{
+  log_rate_record_t record;
+  scheduler.get_record( record);
+  flex_file.append_record( LOG_RATE_POLICY, (uint32_t*) &record, sizeof(record) / sizeof(uint32_t));
+}
 
 COMMON Semaphore setup_file_handling_completed(1,0,(char *)"SETUP");
 
@@ -99,6 +152,10 @@ communicator_runnable (void*)
 
   // wait until configuration file read if one is given
   setup_file_handling_completed.wait ();
+  boot_milestone (BOOT_CONFIGURATION_READ);
+
+  log_rate_scheduler_t log_rate_scheduler;
+  log_rate_scheduler.load_policy (); // now that the configuration file has been read
 
   report_horizon_avalability ();
 
@@ -112,6 +169,32 @@ communicator_runnable (void*)
       configuration (GNSS_CONFIGURATION));
   organizer.set_GNSS_type (GNSS_configuration); // required for speed accuracy monitoring limit value
 
+  // state resumed after an unplanned reset, see warm_restart.h
+  warm_restart_piece_t warm_restart_state[] =
+    {
+      { &organizer, sizeof(organizer) },
+      { &log_rate_scheduler, sizeof(log_rate_scheduler) },
+      { &coordinates, sizeof(coordinates) },
+      { &have_first_GNSS_fix, sizeof(have_first_GNSS_fix) }
+    };
+  static_assert( sizeof(organizer) + sizeof(log_rate_scheduler) + sizeof(coordinates)
+		 + 4 * sizeof(uint32_t) <= WARM_RESTART_PAYLOAD_BYTES, "backup SRAM too small");
+  const unsigned warm_restart_pieces = sizeof(warm_restart_state) / sizeof(warm_restart_piece_t);
+
+  bool warm_restart = false;
+  if (warm_restart_available ()) // before the GNSS tasks write the coordinates
+    {
+      acquire_privileges ();
+      warm_restart = warm_restart_restore (warm_restart_state, warm_restart_pieces);
+      drop_privileges ();
+      if (warm_restart)
+	{
+	  inhibit_flash_background_work (log_rate_scheduler.get_phase () != PHASE_GROUND_IDLE);
+	  inhibit_deferred_EEPROM_commits (log_rate_scheduler.get_phase () == PHASE_LAUNCH
+					   || log_rate_scheduler.get_phase () == PHASE_FLIGHT);
+	}
+    }
+
   switch (GNSS_configuration)
     {
     case GNSS_M9N:
@@ -150,41 +233,70 @@ communicator_runnable (void*)
       break;
     }
 
-  for (int i = 0; i < 100; ++i) // wait 1 s until measurement stable
+  // wait until the sensors are ready, at most 1 s, then let the measurement become stable
+  (void) wait_for_boot_milestones (BOOT_SENSORS_REQUIRED, 1000);
+  for (int i = 0; i < SENSOR_SETTLE_CYCLES; ++i)
     notify_take (true);
+  boot_milestone (BOOT_SENSORS_SETTLED);
 
-  GNSS.clear_sat_fix_type ();
+  if (not warm_restart)
+    GNSS.clear_sat_fix_type ();
   GNSS_new_data_ready = false;
 
   // the construction-process may be very slow and shall not wake the watchdog
   // now we can switch to our original priority
   communicator_task.set_priority ( COMMUNICATOR_PRIORITY); // lift priority
 
-  organizer.initialize_after_first_measurement (coordinates, observations);
+  if (not warm_restart)
+    organizer.initialize_after_first_measurement (coordinates, observations);
 
   NMEA_task.resume ();
   CAN_task.resume ();
 
   unsigned synchronizer_10Hz = 10; // re-sampling 100Hz -> 10Hz
+  unsigned synchronizer_1Hz = 10; // warm restart checkpoint
   unsigned GNSS_watchdog = 0;
   unsigned GNSS_LED_count = 0;
   unsigned old_system_state = system_state;
   bool configuration_data_written = false;
+#if ANALYZE_WRITE_PERFORMANCE
+  uint64_t loop_start_time = getTime_usec ();
+#endif
+
+  boot_milestone (BOOT_NAVIGATION_INITIALIZED);
+  report_valid_output (getTime_usec ()); // output starts with the first cycle below
 
   // this is the MAIN data acquisition and processing loop **********************************************
   while (true)
     {
       notify_take (true); // wait for synchronization by IMU @ 100 Hz
+      report_sensor_loop_running ();
+
+#if ANALYZE_WRITE_PERFORMANCE
+	{
+	  uint64_t now = getTime_usec ();
+	  uint32_t loop_period = now - loop_start_time;
+	  loop_start_time = now;
+	  if (loop_period > loop_max_period_usec)
+	    loop_max_period_usec = loop_period;
+	}
+#endif
 
       if (not configuration_data_written && flex_file.is_open ())
 	{
 	  configuration_data_written = true;
+	  boot_milestone (BOOT_LOG_FILE_OPEN);
 
 	  // we can now start using the log file
 	  // so: write the necessary start information
 	    {
+#if LOG_COMPACT_SENSOR_DATA || LOG_STATE_VECTOR
 	      uint32_t file_format_version =
 		  flexible_log_file_implementation_t::FLEXIBLE_LOG_FILE_FORMAT_VERSION;
+#else // readable by the existing tools
+	      uint32_t file_format_version =
+		  flexible_log_file_t::FLEXIBLE_LOG_FILE_FORMAT_VERSION;
+#endif
 	      flex_file.append_record (FILE_FORMAT_VERSION, &file_format_version, 1);
 	    }
 
@@ -197,6 +309,16 @@ communicator_runnable (void*)
 	      if (node)
 		flex_file.append_record (EEPROM_FILE_RECORD, (uint32_t*) node, node->size);
 	    }
+	  EEPROM_file_system_node *transaction = permanent_data_file.find_datum (
+	      EEPROM_TRANSACTION_ID); // newer than the records above
+	  if (transaction)
+	    flex_file.append_record (EEPROM_FILE_RECORD, (uint32_t*) transaction, transaction->size);
+
+	  log_rate_record (log_rate_scheduler);
+	  flex_file.append_record (WARM_RESTART_REPORT, (uint32_t*) &get_warm_restart_report (),
+				   sizeof(warm_restart_report_t) / sizeof(uint32_t));
+	  flex_file.append_record (BOOT_TIMELINE, (uint32_t*) &get_boot_timeline (),
+				   sizeof(boot_timeline_t) / sizeof(uint32_t));
 	}
 
       if (GNSS_new_data_ready) // triggered after 75ms or 100ms, GNSS-dependent
@@ -270,8 +392,10 @@ communicator_runnable (void*)
 	      if (vector_average_collection.acc_observed_level.abs () < 0.001f)
 		break;
 
+	      begin_EEPROM_transaction (); // roll, pitch and yaw: all or nothing
 	      organizer.update_sensor_orientation_data (
 		  vector_average_collection);
+	      (void) commit_EEPROM_transaction ();
 	      organizer.initialize_before_measurement ();
 	      report_horizon_avalability ();
 	      break;
@@ -311,8 +435,10 @@ communicator_runnable (void*)
 	      if (fine_tune_sensor_attitude)
 		{
 		  fine_tune_sensor_attitude = false;
+		  begin_EEPROM_transaction ();
 		  organizer.fine_tune_sensor_orientation (
 		      vector_average_collection);
+		  (void) commit_EEPROM_transaction ();
 		  organizer.initialize_before_measurement ();
 		  report_horizon_avalability ();
 		}
@@ -325,6 +451,8 @@ communicator_runnable (void*)
 	{
 	  synchronizer_10Hz = 10;
 
+	  black_box.update_GNSS (coordinates);
+
 	  bool landing_detected_here = organizer.update_at_10Hz (coordinates, observations);
 	  if (landing_detected_here)
 	    {
@@ -332,7 +460,25 @@ communicator_runnable (void*)
 	      perform_after_landing_actions.set ();
 	    }
 
+	  float ground_speed = SQRT( SQR( coordinates.velocity[0]) + SQR( coordinates.velocity[1]));
+	  if (log_rate_scheduler.update_phase (observations.pitot_pressure, ground_speed, landing_detected_here))
+	    {
+	      log_rate_record (log_rate_scheduler);
+	      inhibit_flash_background_work (log_rate_scheduler.get_phase () != PHASE_GROUND_IDLE);
+	      inhibit_deferred_EEPROM_commits (log_rate_scheduler.get_phase () == PHASE_LAUNCH
+					       || log_rate_scheduler.get_phase () == PHASE_FLIGHT);
+	    }
+
 	  trigger_CAN ();
+
+	  --synchronizer_1Hz;
+	  if (synchronizer_1Hz == 0)
+	    {
+	      synchronizer_1Hz = 10;
+	      acquire_privileges ();
+	      warm_restart_save (warm_restart_state, warm_restart_pieces);
+	      drop_privileges ();
+	    }
 	}
 
       // service the GNSS LED ****************************************************************************
@@ -383,6 +529,16 @@ communicator_runnable (void*)
 
       organizer.report_data (state_vector);
 
+#if ANALYZE_WRITE_PERFORMANCE
+      uint64_t black_box_start_time = getTime_usec ();
+#endif
+      black_box.update (observations, state_vector); // always, also without log file
+#if ANALYZE_WRITE_PERFORMANCE
+      uint32_t black_box_time = getTime_usec () - black_box_start_time;
+      if (black_box_time > black_box_max_time_usec)
+	black_box_max_time_usec = black_box_time;
+#endif
+
       if (system_state != old_system_state)
 	{
 	  old_system_state = system_state;
@@ -392,10 +548,26 @@ communicator_runnable (void*)
       // write log file
       if (configuration_data_written && flex_file.is_open ())
 	{
-	  flex_file.append_record (
-	      BASIC_SENSOR_DATA, (uint32_t*) &observations, sizeof(observations) / sizeof(uint32_t));
-
-	  if (system_state & EXTERNAL_MAGNETOMETER_AVAILABLE)
+#if ANALYZE_WRITE_PERFORMANCE
+	  uint64_t logger_start_time = getTime_usec ();
+#endif
+	  if (log_rate_scheduler.due (LOG_CLASS_SENSOR_DATA, &observations, sizeof(observations) / sizeof(uint32_t)))
+	    {
+#if LOG_COMPACT_SENSOR_DATA
+	      append_compact_record (sensor_data_codec, COMPACT_SENSOR_DATA, &observations);
+#else
+	      flex_file.append_record (
+		  BASIC_SENSOR_DATA, (uint32_t*) &observations, sizeof(observations) / sizeof(uint32_t));
+#endif
+	    }
+#if LOG_STATE_VECTOR
+	  if (log_rate_scheduler.due (LOG_CLASS_STATE_VECTOR, &state_vector, sizeof(state_vector) / sizeof(uint32_t)))
+	    append_compact_record (state_vector_codec, COMPACT_STATE_VECTOR, &state_vector);
+#endif
+
+	  if ((system_state & EXTERNAL_MAGNETOMETER_AVAILABLE)
+	      && log_rate_scheduler.due (
+		  LOG_CLASS_MAGNETOMETER, &external_magnetometer, sizeof(external_magnetometer) / sizeof(uint32_t)))
 	    {
 	      flex_file.append_record (
 		  MAGNETOMETER_DATA, (uint32_t*) &external_magnetometer,
@@ -406,26 +578,35 @@ communicator_runnable (void*)
 	    {
 	      GNSS_new_data_ready = false;
 
-	      switch (coordinates.sat_fix_type)
-		{
-		case SAT_FIX:
-		default:
-		  flex_file.append_record (
-		      GNSS_DATA, (uint32_t*) &coordinates,
-		      sizeof(GNSS_coordinates_t) / sizeof(uint32_t));
-		  break;
-		case SAT_FIX | SAT_HEADING:
-		  flex_file.append_record (
-		      D_GNSS_DATA, (uint32_t*) &coordinates,
-		      sizeof(D_GNSS_coordinates_t) / sizeof(uint32_t));
-		  break;
-		case SAT_FIX_NONE:
-		  flex_file.append_record (
-		      GNSS_DATA, (uint32_t*) &coordinates,
-		      sizeof(GNSS_coordinates_t) / sizeof(uint32_t));
-		  break;
-		}
+	      if (coordinates.sat_fix_type != SAT_FIX_NONE)
+		flex_file.index_time (gnss_time_key (coordinates));
+
+	      if (log_rate_scheduler.due (LOG_CLASS_GNSS, &coordinates, sizeof(GNSS_coordinates_t) / sizeof(uint32_t)))
+		switch (coordinates.sat_fix_type)
+		  {
+		  case SAT_FIX:
+		  default:
+		    flex_file.append_record (
+			GNSS_DATA, (uint32_t*) &coordinates,
+			sizeof(GNSS_coordinates_t) / sizeof(uint32_t));
+		    break;
+		  case SAT_FIX | SAT_HEADING:
+		    flex_file.append_record (
+			D_GNSS_DATA, (uint32_t*) &coordinates,
+			sizeof(D_GNSS_coordinates_t) / sizeof(uint32_t));
+		    break;
+		  case SAT_FIX_NONE:
+		    flex_file.append_record (
+			GNSS_DATA, (uint32_t*) &coordinates,
+			sizeof(GNSS_coordinates_t) / sizeof(uint32_t));
+		    break;
+		  }
 	    }
+#if ANALYZE_WRITE_PERFORMANCE // using debugger
+	  uint32_t logger_time = getTime_usec () - logger_start_time;
+	  if (logger_time > logger_max_time_usec)
+	    logger_max_time_usec = logger_time;
+#endif
 	}
     }
 }
@@ -440,7 +621,7 @@ static ROM TaskParameters_t p =
     {
       { COMMON_BLOCK, COMMON_SIZE,  portMPU_REGION_READ_WRITE },
       { (void *)0x080C0000, 0x00040000, portMPU_REGION_READ_WRITE}, // EEPROM
-      { &temporary_mag_calculation_data, 8192, portMPU_REGION_READ_WRITE}
+      { BLACK_BOX_REGION_START, BLACK_BOX_REGION_SIZE, portMPU_REGION_READ_WRITE} // black box + temporary_mag_calculation_data
     }
   };
 
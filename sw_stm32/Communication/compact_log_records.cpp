@@ -0,0 +1,50 @@
+/** *****************************************************************************
+ * @file    	compact_log_records.cpp
+ * @brief   	quantization tables for the compact log records
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "compact_log_records.h"
+#include "data_structures.h"
+#include "stddef.h"
+
+#define WORD_OFFSET( member) ( offsetof( measurement_data_t, member) / sizeof( uint32_t))
+
+/* Resolutions are chosen below the sensor noise.
+ * Members not listed here are logged losslessly. */
+const compact_field_t MEASUREMENT_DATA_FIELDS[] =
+{
+    { WORD_OFFSET( acc), 3,			1e-3f }, // m/s^2
+    { WORD_OFFSET( gyro), 3,			1e-5f }, // rad/s
+    { WORD_OFFSET( mag), 3,			1e-4f }, // normalized units
+    { WORD_OFFSET( static_pressure), 1,		1e-1f }, // Pa
+    { WORD_OFFSET( pitot_pressure), 1,		1e-2f }, // Pa
+    { WORD_OFFSET( static_sensor_temperature), 1, 1e-2f }, // degrees C
+    { WORD_OFFSET( supply_voltage), 1,		1e-3f }, // V
+};
+
+const unsigned MEASUREMENT_DATA_FIELD_COUNT = sizeof( MEASUREMENT_DATA_FIELDS) / sizeof( compact_field_t);
+
+const unsigned MEASUREMENT_DATA_WORDS = sizeof( measurement_data_t) / sizeof( uint32_t);
+const unsigned STATE_VECTOR_WORDS = sizeof( state_vector_t) / sizeof( uint32_t);
+
+static_assert( sizeof( measurement_data_t) / sizeof( uint32_t) <= compact_record_codec_t::MAX_RECORD_WORDS, "measurement_data_t too large");
+static_assert( sizeof( state_vector_t) / sizeof( uint32_t) <= compact_record_codec_t::MAX_RECORD_WORDS, "state_vector_t too large");
@@ -0,0 +1,38 @@
+/** *****************************************************************************
+ * @file    	compact_log_records.h
+ * @brief   	quantization tables for the compact log records
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef COMPACT_LOG_RECORDS_H_
+#define COMPACT_LOG_RECORDS_H_
+
+#include "compact_record_codec.h"
+
+// shared by the firmware (encoder) and the host tools (decoder)
+extern const compact_field_t MEASUREMENT_DATA_FIELDS[];
+extern const unsigned MEASUREMENT_DATA_FIELD_COUNT;
+
+//! words of the records, to be checked against the payload by the decoder
+extern const unsigned MEASUREMENT_DATA_WORDS;
+extern const unsigned STATE_VECTOR_WORDS;
+
+#endif /* COMPACT_LOG_RECORDS_H_ */
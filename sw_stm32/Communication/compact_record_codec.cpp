@@ -0,0 +1,164 @@
+/** *****************************************************************************
+ * @file    	compact_record_codec.cpp
+ * @brief   	delta / zig-zag varint encoding of high-rate log records
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "compact_record_codec.h"
+#include "my_assert.h"
+#include "string.h"
+#include "math.h"
+
+compact_record_codec_t::compact_record_codec_t(
+    unsigned _record_words, unsigned _keyframe_interval,
+    const compact_field_t * fields, unsigned n_fields)
+: record_words( _record_words),
+  keyframe_interval( _keyframe_interval),
+  records_to_keyframe( 0),
+  sequence( 0),
+  decoder_synchronized( false)
+{
+  ASSERT( record_words <= MAX_RECORD_WORDS);
+
+  for( unsigned i = 0; i < MAX_RECORD_WORDS; ++i)
+    {
+      inverse_resolution[i] = 0.0f;
+      previous[i] = 0;
+    }
+
+  for( unsigned f = 0; f < n_fields; ++f)
+    for( unsigned i = fields[f].word_offset; i < fields[f].word_offset + fields[f].words; ++i)
+      {
+	ASSERT( i < record_words);
+	inverse_resolution[i] = fields[f].resolution > 0.0f ? 1.0f / fields[f].resolution : 0.0f;
+      }
+}
+
+int32_t compact_record_codec_t::quantize( unsigned index, uint32_t word) const
+{
+  if( inverse_resolution[index] == 0.0f)
+    return (int32_t)word; // lossless: bit pattern
+
+  float value;
+  memcpy( &value, &word, sizeof( float));
+  if( not isfinite( value))
+    return COMPACT_INVALID_VALUE;
+
+  float scaled = value * inverse_resolution[index];
+  if( scaled >= 2147483520.0f) // largest float below 2^31
+    return INT32_MAX;
+  if( scaled <= -2147483520.0f)
+    return INT32_MIN + 1;
+  return (int32_t)lrintf( scaled);
+}
+
+uint32_t compact_record_codec_t::dequantize( unsigned index, int32_t value) const
+{
+  if( inverse_resolution[index] == 0.0f)
+    return (uint32_t)value;
+
+  float result = ( value == COMPACT_INVALID_VALUE) ? NAN : (float)value / inverse_resolution[index];
+  uint32_t word;
+  memcpy( &word, &result, sizeof( float));
+  return word;
+}
+
+unsigned compact_record_codec_t::encode( const uint32_t * record, uint32_t * out)
+{
+  bool keyframe = ( records_to_keyframe == 0);
+  records_to_keyframe = keyframe ? keyframe_interval : records_to_keyframe - 1;
+
+  uint8_t * p = (uint8_t *)out;
+  *p++ = keyframe ? COMPACT_KEYFRAME : 0;
+  *p++ = sequence++;
+  *p++ = (uint8_t)record_words;
+  *p++ = 0;
+
+  for( unsigned i = 0; i < record_words; ++i)
+    {
+      int32_t value = quantize( i, record[i]);
+      uint32_t delta = (uint32_t)value - (keyframe ? 0 : (uint32_t)previous[i]); // modulo 2^32
+      previous[i] = value;
+
+      uint32_t zigzag = ( delta << 1) ^ (uint32_t)( (int32_t)delta >> 31);
+      while( zigzag >= 0x80)
+	{
+	  *p++ = (uint8_t)( zigzag | 0x80);
+	  zigzag >>= 7;
+	}
+      *p++ = (uint8_t)zigzag;
+    }
+
+  while( ( p - (uint8_t *)out) & 3) // pad to whole words
+    *p++ = 0;
+
+  return ( p - (uint8_t *)out) / sizeof( uint32_t);
+}
+
+bool compact_record_codec_t::decode( const uint32_t * in, unsigned in_words, uint32_t * record)
+{
+  const uint8_t * p = (const uint8_t *)in;
+  const uint8_t * end = p + in_words * sizeof( uint32_t);
+  if( in_words * sizeof( uint32_t) < HEADER_BYTES)
+    return false;
+
+  bool keyframe = p[0] & COMPACT_KEYFRAME;
+  uint8_t record_sequence = p[1];
+  if( p[2] != record_words)
+    return false;
+
+  if( not keyframe && ( not decoder_synchronized || record_sequence != sequence))
+    {
+      decoder_synchronized = false; // wait for the next keyframe
+      return false;
+    }
+  p += HEADER_BYTES;
+
+  int32_t value[MAX_RECORD_WORDS];
+  for( unsigned i = 0; i < record_words; ++i)
+    {
+      uint32_t zigzag = 0;
+      unsigned shift = 0;
+      do
+	{
+	  if( p >= end || shift > 28)
+	    {
+	      decoder_synchronized = false;
+	      return false;
+	    }
+	  zigzag |= (uint32_t)( *p & 0x7f) << shift;
+	  shift += 7;
+	}
+      while( *p++ & 0x80);
+
+      uint32_t delta = ( zigzag >> 1) ^ ( 0 - ( zigzag & 1));
+      value[i] = (int32_t)( delta + ( keyframe ? 0 : (uint32_t)previous[i]));
+    }
+
+  for( unsigned i = 0; i < record_words; ++i)
+    {
+      previous[i] = value[i];
+      record[i] = dequantize( i, value[i]);
+    }
+  sequence = record_sequence + 1;
+  decoder_synchronized = true;
+  return true;
+}
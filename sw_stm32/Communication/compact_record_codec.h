@@ -0,0 +1,107 @@
+/** *****************************************************************************
+ * @file    	compact_record_codec.h
+ * @brief   	delta / zig-zag varint encoding of high-rate log records
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef COMPACT_RECORD_CODEC_H_
+#define COMPACT_RECORD_CODEC_H_
+
+#include "stdint.h"
+#include "log_record_types.h"
+
+/* Compact record payload, padded to whole words:
+ *
+ *   byte 0	flags, COMPACT_KEYFRAME
+ *   byte 1	sequence number modulo 256
+ *   byte 2	number of words of the decoded record
+ *   byte 3	reserved, 0
+ *   ...	one zig-zag varint per word: delta to the previous record
+ *		(to zero for a keyframe)
+ *
+ * Words with a resolution are quantized to multiples of it (lossy),
+ * all others are taken as their IEEE754 bit pattern (lossless).
+ * A record following a gap in the sequence can only be decoded if it is a keyframe.
+ */
+
+#define COMPACT_KEYFRAME	0x01
+#define COMPACT_INVALID_VALUE	INT32_MIN //!< quantized NaN or infinity
+
+//! quantization of a group of consecutive float words
+typedef struct
+{
+  uint16_t word_offset;
+  uint16_t words;
+  float resolution; //!< 0.0 means: lossless
+} compact_field_t;
+
+class compact_record_codec_t
+{
+public:
+  enum
+  {
+    MAX_RECORD_WORDS = 128,
+    HEADER_BYTES = 4,
+    MAX_ENCODED_WORDS = ( HEADER_BYTES + 5 * MAX_RECORD_WORDS + 3) / 4
+  };
+
+  compact_record_codec_t( unsigned _record_words, unsigned _keyframe_interval,
+			  const compact_field_t * fields = 0, unsigned n_fields = 0);
+
+  //! \return number of words written to out, at most MAX_ENCODED_WORDS
+  unsigned encode( const uint32_t * record, uint32_t * out);
+
+  /*! \brief expand a compact payload into the original record layout
+   *  \return false if the payload is corrupt or follows a gap without being a keyframe
+   */
+  bool decode( const uint32_t * in, unsigned in_words, uint32_t * record);
+
+  //! next record will be a keyframe, use this if the previous one could not be logged
+  void force_keyframe( void)
+  {
+    records_to_keyframe = 0;
+  }
+
+  unsigned get_record_words( void) const
+  {
+    return record_words;
+  }
+
+  //! upper limit of encode() for this record size
+  unsigned get_max_encoded_words( void) const
+  {
+    return ( HEADER_BYTES + 5 * record_words + 3) / 4;
+  }
+
+private:
+  int32_t quantize( unsigned index, uint32_t word) const;
+  uint32_t dequantize( unsigned index, int32_t value) const;
+
+  unsigned record_words;
+  unsigned keyframe_interval;
+  unsigned records_to_keyframe;
+  uint8_t sequence;
+  bool decoder_synchronized;
+  float inverse_resolution[MAX_RECORD_WORDS];
+  int32_t previous[MAX_RECORD_WORDS];
+};
+
+#endif /* COMPACT_RECORD_CODEC_H_ */
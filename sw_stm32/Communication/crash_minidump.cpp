@@ -0,0 +1,316 @@
+/** *****************************************************************************
+ * @file    	crash_minidump.cpp
+ * @brief   	binary crash dump written by the uSD task
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "system_configuration.h"
+#include "main.h"
+#include "FreeRTOS_wrapper.h"
+#include "queue.h"
+#include "fatfs.h"
+#include "common.h"
+#include "emergency.h"
+#include "stm32_crc.h"
+#include "system_state.h"
+#include "communicator.h"
+#include "uSD_helpers.h"
+#include "flexible_log_file_implementation.h"
+#include "crash_minidump.h"
+#include "black_box.h"
+#include "string.h"
+#include "stddef.h"
+
+uint64_t getTime_usec(void);
+extern uint32_t UNIQUE_ID[4];
+extern uint8_t mem_buffer[MEM_BUFSIZE];
+extern flexible_log_file_implementation_t flex_file;
+
+// freertos_tasks_c_additions.h
+extern "C" void vTaskGetStackRange( TaskHandle_t xTask, StackType_t ** ppxTopOfStack, StackType_t ** ppxEndOfStack);
+
+// layout of the queue registry in queue.c, as used by kernel aware debuggers
+typedef struct
+{
+  const char * pcQueueName;
+  QueueHandle_t xHandle;
+} queue_registry_item_t;
+extern "C" queue_registry_item_t xQueueRegistry[configQUEUE_REGISTRY_SIZE];
+
+#define MINIDUMP_MAX_TASKS	24
+#define MINIDUMP_LOG_PIECES	8
+
+static inline uint32_t padded( uint32_t bytes)
+{
+  return ( bytes + sizeof( uint32_t) - 1) & ~( sizeof( uint32_t) - 1);
+}
+
+//! collects the sections in mem_buffer and writes it in whole blocks
+class minidump_writer_t
+{
+public:
+  minidump_writer_t( FIL & _file)
+  : file( _file),
+    fill( 0),
+    crc( STM32_CRC_INIT),
+    ok( true)
+  {}
+
+  void section( uint32_t type, uint32_t bytes)
+  {
+    minidump_section_t header = { type, bytes };
+    put( &header, sizeof( header));
+  }
+
+  //! copy into the block buffer, padded to words
+  void put( const void * data, uint32_t bytes)
+  {
+    const uint8_t * source = (const uint8_t *) data;
+    uint32_t padding = padded( bytes) - bytes;
+    while( bytes > 0)
+      {
+	uint32_t chunk = MEM_BLOCK_BYTES - fill;
+	if( chunk > bytes)
+	  chunk = bytes;
+	memcpy( mem_buffer + fill, source, chunk); // also out of CCM RAM, which is no DMA source
+	fill += chunk;
+	source += chunk;
+	bytes -= chunk;
+	if( fill == MEM_BLOCK_BYTES)
+	  flush();
+      }
+    while( padding--)
+      {
+	mem_buffer[fill++] = 0;
+	if( fill == MEM_BLOCK_BYTES)
+	  flush();
+      }
+  }
+
+  //! write words from DMA capable RAM without copying, used while mem_buffer holds log data
+  void put_direct( const uint32_t * data, uint32_t words)
+  {
+    flush();
+    write( data, words * sizeof( uint32_t));
+  }
+
+  bool finish( void)
+  {
+    section( MINIDUMP_END, sizeof( uint32_t));
+    flush();
+    uint32_t file_crc = crc;
+    write( &file_crc, sizeof( file_crc));
+    return ok;
+  }
+
+private:
+  enum { MEM_BLOCK_BYTES = MEM_BUFSIZE };
+  static_assert( MEM_BLOCK_BYTES <= sizeof( mem_buffer), "minidump blocks are collected in mem_buffer");
+
+  void flush( void)
+  {
+    write( mem_buffer, fill);
+    fill = 0;
+  }
+
+  void write( const void * data, uint32_t bytes)
+  {
+    UINT written_bytes = 0;
+    if( bytes == 0)
+      return;
+    crc = stm32_crc( crc, (const uint32_t *) data, bytes / sizeof( uint32_t));
+    if( ( f_write( &file, data, bytes, &written_bytes) != FR_OK) || ( written_bytes != bytes))
+      ok = false;
+  }
+
+  FIL & file;
+  uint32_t fill;
+  uint32_t crc;
+  bool ok;
+};
+
+//! one black box stream, written directly from its ring
+template <class ring_type> static void put_black_box_stream( minidump_writer_t & writer, const ring_type & ring,
+							    black_box_stream stream, uint32_t sample_interval)
+{
+  const typename ring_type::slot_t * begin[2];
+  unsigned count[2];
+  unsigned pieces = ring.get_records( begin, count);
+
+  uint32_t __ALIGNED(4) header_buffer[ ( sizeof( minidump_section_t) + sizeof( minidump_black_box_t)) / sizeof( uint32_t)];
+  minidump_section_t * section = (minidump_section_t *) header_buffer;
+  minidump_black_box_t * header = (minidump_black_box_t *) ( section + 1);
+  header->stream = stream;
+  header->record_bytes = sizeof( typename ring_type::slot_t);
+  header->data_offset = offsetof( typename ring_type::slot_t, record);
+  header->records = 0;
+  for( unsigned i = 0; i < pieces; ++i)
+    header->records += count[i];
+  header->records_written = ring.get_records_written();
+  header->sample_interval = sample_interval;
+  header->current_sample = black_box.get_sample();
+  section->type = MINIDUMP_BLACK_BOX;
+  section->bytes = sizeof( minidump_black_box_t) + header->records * header->record_bytes;
+
+  writer.put_direct( header_buffer, sizeof( header_buffer) / sizeof( uint32_t));
+  for( unsigned i = 0; i < pieces; ++i)
+    writer.put_direct( (const uint32_t *) begin[i], count[i] * sizeof( typename ring_type::slot_t) / sizeof( uint32_t));
+}
+
+static void copy_name( char * target, const char * source, unsigned size)
+{
+  memset( target, 0, size);
+  if( source)
+    strncpy( target, source, size - 1);
+}
+
+bool write_crash_minidump( const char * file_name)
+{
+  FIL fp;
+  if( f_open (&fp, file_name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+    return false;
+
+  minidump_writer_t writer( fp);
+
+  // mem_buffer is part of the log ring, so the header is assembled on the stack
+  uint32_t __ALIGNED(4) header_buffer[ ( sizeof( minidump_file_header_t)
+					 + sizeof( minidump_section_t)
+					 + sizeof( minidump_log_tail_t)) / sizeof( uint32_t)];
+  minidump_file_header_t * header = (minidump_file_header_t *) header_buffer;
+  memset( header_buffer, 0, sizeof( header_buffer));
+  header->magic = MINIDUMP_MAGIC;
+  header->format_version = MINIDUMP_FORMAT_VERSION;
+  header->sw_version = GIT_TAG_DEC;
+  for( unsigned i = 0; i < 3; ++i)
+    header->unique_id[i] = UNIQUE_ID[i];
+  header->crash_line = crashline;
+  header->tick_count = xTaskGetTickCount();
+  header->time_usec = getTime_usec();
+  copy_name( header->crash_file, crashfile, sizeof( header->crash_file));
+  copy_name( header->git_tag, GIT_TAG_INFO, sizeof( header->git_tag));
+
+  // log tail first and directly from the ring
+  const uint32_t * log_piece[MINIDUMP_LOG_PIECES];
+  unsigned log_piece_words[MINIDUMP_LOG_PIECES];
+  unsigned log_pieces = flex_file.get_recent_data( log_piece, log_piece_words, MINIDUMP_LOG_PIECES,
+						   CRASH_DUMP_LOG_TAIL_BYTES / sizeof( uint32_t));
+  uint32_t log_words = 0;
+  for( unsigned i = 0; i < log_pieces; ++i)
+    log_words += log_piece_words[i];
+
+  minidump_section_t * section = (minidump_section_t *) ( header + 1);
+  section->type = MINIDUMP_LOG_TAIL;
+  section->bytes = sizeof( minidump_log_tail_t) + log_words * sizeof( uint32_t);
+  minidump_log_tail_t * log_tail = (minidump_log_tail_t *) ( section + 1);
+  log_record_framing_t framing;
+  if( flex_file.get_record_framing( framing))
+    {
+      log_tail->header_words = framing.header_words;
+      log_tail->trailer_words = framing.trailer_words;
+    }
+  log_tail->dropped_records = flex_file.get_statistics().dropped_records;
+
+  writer.put_direct( header_buffer, sizeof( header_buffer) / sizeof( uint32_t));
+  for( unsigned i = 0; i < log_pieces; ++i)
+    writer.put_direct( log_piece[i], log_piece_words[i]);
+
+  // the last seconds before the event, recorded independently of the log file
+  black_box.freeze();
+  put_black_box_stream( writer, black_box.sensor_data, BLACK_BOX_SENSOR_DATA, BLACK_BOX_SENSOR_DATA_DIVIDER);
+  put_black_box_stream( writer, black_box.GNSS_data, BLACK_BOX_GNSS, 10);
+  put_black_box_stream( writer, black_box.state_vectors, BLACK_BOX_STATE_VECTOR, BLACK_BOX_STATE_VECTOR_DIVIDER);
+
+  // from here on mem_buffer collects the blocks
+  writer.section( MINIDUMP_REGISTERS, sizeof( register_dump) + sizeof( FPU_register_dump));
+  writer.put( &register_dump, sizeof( register_dump));
+  writer.put( FPU_register_dump, sizeof( FPU_register_dump));
+
+  TaskStatus_t task_status[MINIDUMP_MAX_TASKS];
+  unsigned tasks = uxTaskGetSystemState( task_status, MINIDUMP_MAX_TASKS, 0);
+  for( unsigned i = 0; i < tasks; ++i)
+    {
+      const TaskStatus_t & status = task_status[i];
+      StackType_t * top_of_stack;
+      StackType_t * end_of_stack;
+      vTaskGetStackRange( status.xHandle, &top_of_stack, &end_of_stack);
+
+      minidump_task_t task;
+      memset( &task, 0, sizeof( task));
+      task.handle = (uint32_t) status.xHandle;
+      copy_name( task.name, status.pcTaskName, sizeof( task.name));
+      task.number = status.xTaskNumber;
+      task.state = status.eCurrentState;
+      task.current_priority = status.uxCurrentPriority;
+      task.base_priority = status.uxBasePriority;
+      task.run_time_counter = status.ulRunTimeCounter;
+      task.stack_base = (uint32_t) status.pxStackBase;
+      task.stack_end = (uint32_t) end_of_stack;
+      task.top_of_stack = (uint32_t) top_of_stack;
+      task.high_water_mark = status.usStackHighWaterMark;
+
+      // a corrupted stack pointer must not make us read somewhere else
+      if( ( top_of_stack >= status.pxStackBase) && ( top_of_stack <= end_of_stack))
+	task.stack_words = end_of_stack - top_of_stack + 1;
+
+      writer.section( MINIDUMP_TASK, sizeof( task) + task.stack_words * sizeof( uint32_t));
+      writer.put( &task, sizeof( task));
+      writer.put( top_of_stack, task.stack_words * sizeof( uint32_t));
+    }
+
+  for( unsigned i = 0; i < configQUEUE_REGISTRY_SIZE; ++i)
+    {
+      QueueHandle_t handle = xQueueRegistry[i].xHandle;
+      if( handle == 0)
+	continue;
+
+      minidump_queue_t queue;
+      memset( &queue, 0, sizeof( queue));
+      queue.handle = (uint32_t) handle;
+      copy_name( queue.name, xQueueRegistry[i].pcQueueName, sizeof( queue.name));
+      queue.type = ucQueueGetQueueType( handle);
+      queue.messages_waiting = uxQueueMessagesWaiting( handle);
+      queue.spaces_available = uxQueueSpacesAvailable( handle);
+      if( queue.type == queueQUEUE_TYPE_MUTEX)
+	queue.mutex_holder = (uint32_t) xQueueGetMutexHolder( handle);
+
+      writer.section( MINIDUMP_QUEUE, sizeof( queue));
+      writer.put( &queue, sizeof( queue));
+    }
+
+  minidump_snapshot_t snapshot =
+    {
+      sizeof( observations),
+      sizeof( coordinates),
+      sizeof( system_state),
+      sizeof( state_vector)
+    };
+  writer.section( MINIDUMP_SNAPSHOT, sizeof( snapshot)
+		  + padded( sizeof( observations)) + padded( sizeof( coordinates))
+		  + padded( sizeof( system_state)) + padded( sizeof( state_vector)));
+  writer.put( &snapshot, sizeof( snapshot));
+  writer.put( &observations, sizeof( observations));
+  writer.put( &coordinates, sizeof( coordinates));
+  writer.put( &system_state, sizeof( system_state));
+  writer.put( &state_vector, sizeof( state_vector));
+
+  bool success = writer.finish();
+  return ( f_close( &fp) == FR_OK) && success;
+}
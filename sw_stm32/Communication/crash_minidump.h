@@ -0,0 +1,132 @@
+/** *****************************************************************************
+ * @file    	crash_minidump.h
+ * @brief   	binary crash dump written by the uSD task
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef CRASH_MINIDUMP_H_
+#define CRASH_MINIDUMP_H_
+
+#include "stdint.h"
+
+/* A minidump file (*.MINIDUMP) holds everything known after a crash:
+ *
+ *   minidump_file_header_t
+ *   sections: minidump_section_t followed by its payload, each part padded to 32-bit words
+ *   MINIDUMP_END section, its payload is the stm32_crc() of the file up to there
+ *
+ * All values are little endian words as in RAM. The layouts are mirrored
+ * by scripts/decode_minidump.py, which symbolizes the addresses using the ELF file.
+ */
+
+#define MINIDUMP_MAGIC			0x444d524c // "LRMD"
+#define MINIDUMP_FORMAT_VERSION		1
+
+enum minidump_section_type
+{
+  MINIDUMP_LOG_TAIL = 1,	//!< minidump_log_tail_t, then the most recent log ring words
+  MINIDUMP_REGISTERS,		//!< register_dump_t, then FPU_register_dump
+  MINIDUMP_TASK,		//!< minidump_task_t, then the stack words from top_of_stack up to stack_end
+  MINIDUMP_QUEUE,		//!< minidump_queue_t, one section per queue registry entry
+  MINIDUMP_SNAPSHOT,		//!< minidump_snapshot_t, then observations, coordinates, system_state and state_vector
+  MINIDUMP_BLACK_BOX,		//!< minidump_black_box_t, then the records of one black box stream, oldest first
+  MINIDUMP_END = 0xffff
+};
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t format_version;
+  uint64_t time_usec;
+  uint32_t sw_version;		//!< GIT_TAG_DEC
+  uint32_t unique_id[3];
+  uint32_t crash_line;
+  uint32_t tick_count;
+  char crash_file[64];		//!< source file of the failed assertion, "EXCEPTION" or "WATCHDOG"
+  char git_tag[32];
+} minidump_file_header_t;
+
+typedef struct
+{
+  uint32_t type;
+  uint32_t bytes;		//!< payload
+} minidump_section_t;
+
+typedef struct
+{
+  uint32_t header_words;	//!< record framing, see log_record_reader.h
+  uint32_t trailer_words;
+  uint32_t dropped_records;
+} minidump_log_tail_t;
+
+typedef struct
+{
+  uint32_t handle;		//!< TCB address, register_dump.active_TCB for the crashed task
+  char name[16];
+  uint32_t number;
+  uint32_t state;		//!< eTaskState
+  uint32_t current_priority;
+  uint32_t base_priority;
+  uint32_t run_time_counter;
+  uint32_t stack_base;
+  uint32_t stack_end;		//!< highest stack word
+  uint32_t top_of_stack;	//!< saved context of a task not running, see port.c
+  uint32_t high_water_mark;	//!< words never used
+  uint32_t stack_words;		//!< dumped behind this structure
+} minidump_task_t;
+
+typedef struct
+{
+  uint32_t handle;
+  char name[16];
+  uint32_t type;		//!< queueQUEUE_TYPE_...
+  uint32_t messages_waiting;	//!< count for semaphores, 0 = taken for mutexes
+  uint32_t spaces_available;
+  uint32_t mutex_holder;	//!< TCB address
+} minidump_queue_t;
+
+typedef struct
+{
+  uint32_t observations_bytes;
+  uint32_t coordinates_bytes;
+  uint32_t system_state_bytes;
+  uint32_t state_vector_bytes;
+} minidump_snapshot_t;
+
+typedef struct
+{
+  uint32_t stream;		//!< black_box_stream
+  uint32_t record_bytes;	//!< 100 Hz sample number followed by the data ...
+  uint32_t data_offset;		//!< ... at this offset within the record
+  uint32_t records;
+  uint32_t records_written;	//!< since power-on
+  uint32_t sample_interval;	//!< nominal, in 100 Hz samples
+  uint32_t current_sample;	//!< when the black box has been frozen
+} minidump_black_box_t;
+
+#ifdef __cplusplus
+
+//! write the minidump, called by write_crash_dump() with privileges
+bool write_crash_minidump( const char * file_name);
+
+#endif
+
+#endif /* CRASH_MINIDUMP_H_ */
@@ -1,109 +1,466 @@
 #include "flexible_file_format.h"
 #include <flexible_log_file_implementation.h>
 #include "CRC16.h"
+#include "stm32_crc.h"
 #include "my_assert.h"
 #include "common.h"
 #include "system_configuration.h"
+#include "string.h"
 
-#if ANALYZE_WRITE_PERFORMANCE
-COMMON unsigned used_size;
-#endif
+uint64_t getTime_usec(void);
+
+#define SECTOR_SIZE_BYTES 512
+
+flexible_log_file_implementation_t::flexible_log_file_implementation_t (
+    uint32_t * buf, unsigned size_words, FPTR _signal,
+    unsigned _slot_size_words,
+    uint32_t * spill_buf, unsigned spill_size_words)
+: flexible_log_file_t( buf, size_words),
+  file_is_open( false),
+  capturing( false),
+  signal( _signal),
+  slot_size_words( _slot_size_words),
+  slot_count( 0),
+  slot_end( buf),
+  slots_filled( 0),
+  slots_written( 0),
+  statistics(),
+  allocated_size( 0),
+  bytes_since_sync( 0),
+  last_sync_usec( 0),
+  sync_interval_usec( (uint64_t)LOG_SYNC_INTERVAL_MS * 1000),
+  sync_interval_bytes( LOG_SYNC_INTERVAL_BYTES),
+  index(),
+  index_pending( false),
+  checkpoint(),
+  running_crc( STM32_CRC_INIT),
+  next_checkpoint_offset( 0),
+  open_marker( 0),
+  open_marker_written( false),
+  framing_probe( 0),
+  framing_known( false),
+  framing_data_seen( false),
+  header_words( 0),
+  trailer_words( 0),
+  reserved_type( FILE_FORMAT_VERSION),
+  reserved_size_words( 0),
+  reserved_span( 0)
+{
+  for( uint32_t * p = buf; (p + slot_size_words <= buf + size_words) && (slot_count < MAX_SLOTS); p += slot_size_words)
+    slot[slot_count++] = p;
+
+  for( uint32_t * p = spill_buf; (p + slot_size_words <= spill_buf + spill_size_words) && (slot_count < MAX_SLOTS); p += slot_size_words)
+    slot[slot_count++] = p;
+
+  ASSERT( slot_count >= 2);
+  ASSERT( (slot_size_words * sizeof( uint32_t)) % SECTOR_SIZE_BYTES == 0);
+  start_slot( 0);
+  current_file_name[0] = 0;
+}
+
+//!< reserve contiguous space for a complete flight, try smaller sizes if the card is fragmented
+void flexible_log_file_implementation_t::preallocate( void)
+{
+  allocated_size = 0;
+  for( FSIZE_t size = (FSIZE_t)LOG_EXPECTED_FLIGHT_MINUTES * 60 * LOG_DATA_RATE_BYTES_PER_SECOND;
+      size >= LOG_GROWTH_CHUNK_BYTES; size /= 2)
+    if( f_expand( &out_file, size, 1) == FR_OK)
+      {
+	allocated_size = size;
+	break;
+      }
+  statistics.preallocated_bytes = allocated_size;
+}
+
+//!< make sure the file is large enough, extend it by a big chunk otherwise
+bool flexible_log_file_implementation_t::ensure_allocation( FSIZE_t end_of_write)
+{
+  if( end_of_write <= allocated_size)
+    return true;
+
+  // seeking beyond the end of file allocates all clusters in one go
+  FSIZE_t position = f_tell( &out_file);
+  FSIZE_t new_size = allocated_size + LOG_GROWTH_CHUNK_BYTES;
+  if( new_size < end_of_write)
+    new_size = end_of_write;
+
+  if(( f_lseek( &out_file, new_size) != FR_OK) || ( f_tell( &out_file) != new_size))
+    {
+      // card full: let f_write allocate whatever is left
+      (void)f_lseek( &out_file, position);
+      return false;
+    }
+
+  allocated_size = new_size;
+  ++statistics.growth_steps;
+  return f_lseek( &out_file, position) == FR_OK;
+}
+
+//!< find out how many words the base class writes before and after the payload
+void flexible_log_file_implementation_t::measure_record_framing( void)
+{
+  uint32_t datum = 0;
+  header_words = trailer_words = 0;
+  framing_data_seen = false;
+
+  framing_probe = &datum; // write_block() will only count now
+  flexible_log_file_t::append_record( FILE_FORMAT_VERSION, &datum, 1);
+  framing_probe = 0;
+
+  // in-place serialization requires the payload to be passed through unchanged
+  framing_known = framing_data_seen && ( header_words + trailer_words <= RECORD_OVERHEAD_WORDS);
+}
+
+//!< empty ring, new index and journal, checkpoint 0 becomes the first record
+void flexible_log_file_implementation_t::begin_stream( void)
+{
+  slots_filled = slots_written = 0;
+  start_slot( 0);
+  log_index_start( index, LOG_INDEX_INTERVAL_SECONDS);
+  index_pending = true;
+  reserved_span = 0;
+  if( not framing_known)
+    measure_record_framing();
+
+  checkpoint.magic = LOG_CHECKPOINT_MAGIC;
+  checkpoint.file_id = (uint32_t)getTime_usec();
+  checkpoint.interval_bytes = LOG_CHECKPOINT_INTERVAL_BYTES;
+  checkpoint.previous_offset_bytes = 0;
+  running_crc = STM32_CRC_INIT;
+  next_checkpoint_offset = 0;
+  write_checkpoint();
+}
+
+void flexible_log_file_implementation_t::start_capture( void)
+{
+  if( file_is_open)
+    return;
+
+  begin_stream();
+  capturing = true;
+  file_is_open = true;
+}
+
+void flexible_log_file_implementation_t::write_open_marker( void)
+{
+  FIL marker;
+  UINT writtenBytes = 0;
+  open_marker_written = ( f_open( &marker, (const TCHAR*)open_marker, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+  if( open_marker_written)
+    {
+      f_write( &marker, current_file_name, strlen( current_file_name), &writtenBytes);
+      f_close( &marker);
+    }
+}
 
 bool flexible_log_file_implementation_t::open (char *file_name)
 {
+  if( strlen( file_name) >= sizeof( current_file_name))
+    return false;
+
   FRESULT fresult;
   fresult = f_open (&out_file, (const TCHAR*)file_name, FA_CREATE_ALWAYS | FA_WRITE);
   if( fresult == FR_OK)
     {
+      preallocate();
+      bytes_since_sync = 0;
+      last_sync_usec = getTime_usec();
+
+      if( capturing) // the records captured so far start the file
+	{
+	  statistics.captured_bytes = current_offset_bytes();
+	  statistics.captured_dropped_records = statistics.dropped_records;
+	  capturing = false;
+	}
+      else
+	begin_stream();
+
+      strcpy( current_file_name, file_name);
+      if( open_marker)
+	write_open_marker();
+
       file_is_open = true;
-      write_pointer = buffer;
-      status = FILLING_LOW;
       return true;
     }
   return false;
 }
 
+bool flexible_log_file_implementation_t::rename( const char * new_name)
+{
+  if( capturing || ( strlen( new_name) >= sizeof( current_file_name)))
+    return false;
+
+  // FatFs renames closed files only: re-open it, the preallocation is kept
+  FSIZE_t position = f_tell( &out_file);
+  bool renamed = ( f_close( &out_file) == FR_OK)
+      && ( f_rename( (const TCHAR*)current_file_name, (const TCHAR*)new_name) == FR_OK);
+  if( renamed)
+    strcpy( current_file_name, new_name);
+
+  bool reopened = ( f_open( &out_file, (const TCHAR*)current_file_name, FA_WRITE | FA_OPEN_EXISTING) == FR_OK)
+      && ( f_lseek( &out_file, position) == FR_OK);
+
+  if( renamed && open_marker_written)
+    write_open_marker();
+
+  return renamed && reopened;
+}
+
+//!< journal entry: CRC of everything since the last checkpoint record started
+void flexible_log_file_implementation_t::write_checkpoint( void)
+{
+  if( free_words() < sizeof( checkpoint) / sizeof( uint32_t) + RECORD_OVERHEAD_WORDS)
+    return; // try again in front of the next record
+
+  uint32_t offset = current_offset_bytes();
+  checkpoint.sequence = offset / LOG_CHECKPOINT_INTERVAL_BYTES;
+  checkpoint.crc = running_crc;
+  running_crc = STM32_CRC_INIT; // the next CRC starts with this record's header
+
+  flexible_log_file_t::append_record( LOG_CHECKPOINT, (uint32_t *)&checkpoint, sizeof( checkpoint) / sizeof( uint32_t));
+
+  checkpoint.previous_offset_bytes = offset;
+  next_checkpoint_offset = ( checkpoint.sequence + 1) * LOG_CHECKPOINT_INTERVAL_BYTES;
+  ++statistics.checkpoints;
+}
+
+void flexible_log_file_implementation_t::index_time( uint32_t time_key)
+{
+  if( file_is_open)
+    log_index_add( index, time_key, current_offset_bytes());
+}
+
+//!< append footer and locator, on failure the file just has no index
+void flexible_log_file_implementation_t::write_index( void)
+{
+  log_index_locator_t locator;
+  locator.magic = LOG_INDEX_MAGIC;
+  locator.footer_offset_bytes = current_offset_bytes();
+
+  uint32_t footer_words = log_index_size_words( index.entries);
+  if( free_words() < footer_words + sizeof( locator) / sizeof( uint32_t) + 2 * RECORD_OVERHEAD_WORDS)
+    return;
+
+  flexible_log_file_t::append_record( LOG_INDEX_FOOTER, (uint32_t *)&index, footer_words);
+  flexible_log_file_t::append_record( LOG_INDEX_LOCATOR, (uint32_t *)&locator, sizeof( locator) / sizeof( uint32_t));
+}
+
 bool flexible_log_file_implementation_t::close( void)
 {
-  UINT writtenBytes = 0;
-  if( status & FILLING_LOW)
-    f_write( &out_file, (const char *)flexible_log_file_t::buffer, (flexible_log_file_t::write_pointer - flexible_log_file_t::buffer) * sizeof( uint32_t), &writtenBytes);
-  else
-    f_write( &out_file, (const char *)second_part, (flexible_log_file_t::write_pointer - second_part) * sizeof( uint32_t), &writtenBytes);
+  if( capturing) // the file has never been created
+    {
+      capturing = false;
+      file_is_open = false;
+      index_pending = false;
+      return true;
+    }
+
+  if( index_pending)
+    write_index();
+  index_pending = false;
 
+  (void)flush_buffer(); // all completed slots
+
+  if( slots_filled - slots_written < slot_count) // the present slot is not pending
+    {
+      UINT writtenBytes = 0;
+      uint32_t * current_slot = slot[slots_filled % slot_count];
+      f_write( &out_file, (const char *)current_slot, (write_pointer - current_slot) * sizeof( uint32_t), &writtenBytes);
+    }
+
+  f_truncate( &out_file); // release the unused preallocated space
   f_close ( &out_file);
+  allocated_size = 0;
+
+  if( open_marker_written)
+    f_unlink( (const TCHAR*)open_marker);
+  open_marker_written = false;
 
-  status = 0;
   file_is_open = false;
   return true;
 }
 
+unsigned flexible_log_file_implementation_t::get_recent_data( const uint32_t * begin[], unsigned words[],
+								unsigned max_pieces, unsigned max_words) const
+{
+  if( max_pieces == 0)
+    return 0;
+
+  unsigned current = slots_filled % slot_count;
+  unsigned current_words = write_pointer - slot[current];
+
+  // completed slots which have not yet been re-used by the producer
+  unsigned older = slots_filled < slot_count - 1 ? slots_filled : slot_count - 1;
+  if( older > max_pieces - 1)
+    older = max_pieces - 1;
+  while( ( older > 0) && ( older * slot_size_words + current_words > max_words))
+    --older;
+
+  unsigned pieces = 0;
+  for( unsigned age = older; age > 0; --age)
+    {
+      begin[pieces] = slot[( slots_filled - age) % slot_count];
+      words[pieces] = slot_size_words;
+      ++pieces;
+    }
+
+  if( current_words > max_words)
+    current_words = max_words;
+  if( current_words > 0)
+    {
+      begin[pieces] = write_pointer - current_words;
+      words[pieces] = current_words;
+      ++pieces;
+    }
+  return pieces;
+}
+
 bool flexible_log_file_implementation_t::sync_file( void)
 {
   FRESULT fresult;
   fresult = f_sync (&out_file);
+  bytes_since_sync = 0;
+  last_sync_usec = getTime_usec();
+  ++statistics.syncs;
   return(fresult == FR_OK);
 }
 
+bool flexible_log_file_implementation_t::sync_file_if_due( void)
+{
+  if( ( bytes_since_sync < sync_interval_bytes)
+      && ( getTime_usec() - last_sync_usec < sync_interval_usec))
+    return true;
+
+  return sync_file();
+}
+
+//!< write all completed slots, called by the uSD task
 bool flexible_log_file_implementation_t::flush_buffer( void)
 {
   UINT writtenBytes = 0;
-  unsigned size_bytes = (second_part - buffer) * sizeof( uint32_t);
+  bool success = true;
 
-  if( status & WRITING_LOW)
+  while( slots_written != slots_filled)
     {
-      ASSERT( not( status & FILLING_LOW));
-      f_write( &out_file, (const char *)buffer, size_bytes, &writtenBytes);
+      // merge slots adjacent in memory into one multi-block write
+      unsigned first = slots_written % slot_count;
+      unsigned count = 1;
+      while( ( slots_written + count != slots_filled)
+	  && ( first + count < slot_count)
+	  && ( slot[first + count] == slot[first] + count * slot_size_words))
+	++count;
+
+      unsigned size_bytes = count * slot_size_words * sizeof( uint32_t);
+      (void)ensure_allocation( f_tell( &out_file) + size_bytes);
 
-#if ANALYZE_WRITE_PERFORMANCE // using debugger
-      used_size = (write_pointer - second_part) > used_size
-	  ? write_pointer - second_part : used_size;
+#if ANALYZE_WRITE_PERFORMANCE
+      uint64_t start = getTime_usec();
 #endif
-    }
-  else if( ( status & WRITING_HIGH))
-    {
-      ASSERT( not( status & FILLING_HIGH));
-      f_write( &out_file, (const char *)second_part, size_bytes, &writtenBytes);
+      FRESULT fresult = f_write( &out_file, (const char *)slot[first], size_bytes, &writtenBytes);
+      success &= ( fresult == FR_OK) && ( size_bytes == writtenBytes);
+
 #if ANALYZE_WRITE_PERFORMANCE
-      used_size = (write_pointer - buffer) > used_size
-	  ? write_pointer - buffer : used_size;
+      uint32_t write_time = getTime_usec() - start;
+      if( write_time > statistics.max_write_time_usec)
+	statistics.max_write_time_usec = write_time;
 #endif
+      bytes_since_sync += size_bytes;
+      slots_written += count; // slots may now be re-used by the producer
+      statistics.slots_written += count;
     }
 
-  status &= ~(WRITING_LOW | WRITING_HIGH);
+  return success;
+}
 
-  return ( size_bytes == writtenBytes);
+uint32_t * flexible_log_file_implementation_t::reserve( flexible_log_file_record_type type, uint32_t data_size_words)
+{
+  ASSERT( reserved_span == 0);
+
+  if( file_is_open)
+    checkpoint_if_due(); // must precede the span
+
+  // the free space is checked by commit() with the size actually used,
+  // here the present slot must only be ours
+  if( ( not file_is_open)
+      || ( data_size_words > MAX_RESERVE_WORDS)
+      || ( free_words() == 0))
+    {
+      ++statistics.dropped_records;
+      statistics.dropped_words += data_size_words;
+      return 0;
+    }
+
+  reserved_type = type;
+  reserved_size_words = data_size_words;
+
+  // serialize directly into the ring if the complete record fits into the present slot
+  if( framing_known && ( write_pointer + header_words + data_size_words + trailer_words <= slot_end))
+    reserved_span = write_pointer + header_words;
+  else
+    reserved_span = bounce_buffer;
+
+  return reserved_span;
 }
 
-bool flexible_log_file_implementation_t::write_block (uint32_t *p_data, uint32_t size_words)
+bool flexible_log_file_implementation_t::commit( uint32_t data_size_words)
 {
-  bool need_to_signal = false;
-  while( size_words --)
+  ASSERT( reserved_span != 0);
+  ASSERT( data_size_words <= reserved_size_words);
+  uint32_t * span = reserved_span;
+  reserved_span = 0;
+
+  if( free_words() < data_size_words + RECORD_OVERHEAD_WORDS)
     {
-	*write_pointer++ = *p_data++;
+      ++statistics.dropped_records;
+      statistics.dropped_words += data_size_words;
+      return false;
+    }
+
+  count_record( reserved_type);
 
-	if( write_pointer >= buffer_end)
-	  {
-	    ASSERT(not (status & WRITING_LOW) )
+  // the base class writes the header in front of the payload, write_block() recognizes
+  // a payload that is already in place and just steps over it
+  return flexible_log_file_t::append_record( reserved_type, span, data_size_words);
+}
 
-	    write_pointer = buffer;
+bool flexible_log_file_implementation_t::write_block (uint32_t *p_data, uint32_t size_words)
+{
+  if( framing_probe) // just measuring the record framing of the base class
+    {
+      if( p_data == framing_probe)
+	framing_data_seen = true;
+      else if( framing_data_seen)
+	trailer_words += size_words;
+      else
+	header_words += size_words;
+      return true;
+    }
 
-	    status &= ~FILLING_HIGH;
-	    status |= FILLING_LOW;
-	    status |= WRITING_HIGH;
+  bool need_to_signal = false;
+  while( size_words > 0)
+    {
+      unsigned segment = slot_end - write_pointer;
+      if( segment > size_words)
+	segment = size_words;
 
-	    need_to_signal = true;
-	  }
-	else if( write_pointer == second_part)
-	  {
-	    ASSERT( not (status & WRITING_HIGH) );
+      if( p_data != write_pointer) // otherwise: serialized in place by reserve() + commit()
+	memcpy( write_pointer, p_data, segment * sizeof( uint32_t));
+      running_crc = stm32_crc( running_crc, write_pointer, segment);
 
-	    status &= ~FILLING_LOW;
-	    status |= FILLING_HIGH;
-	    status |= WRITING_LOW;
+      write_pointer += segment;
+      p_data += segment;
+      size_words -= segment;
 
-	    need_to_signal = true;
-	  }
+      if( write_pointer >= slot_end)
+	{
+	  ++slots_filled; // hand the slot over to the uSD task
+	  unsigned pending = slots_filled - slots_written;
+	  ASSERT( pending <= slot_count);
+	  if( pending > statistics.max_pending_slots)
+	    statistics.max_pending_slots = pending;
+	  start_slot( slots_filled % slot_count);
+	  need_to_signal = true;
+	}
     }
   if( need_to_signal)
     signal();
@@ -4,21 +4,65 @@
 #include "stdint.h"
 #include "fatfs.h"
 #include "flexible_log_file.h"
+#include "log_file_index.h"
+#include "log_file_recovery.h"
 
 typedef void ( *FPTR)( void); // declare void -> void function pointer
 
+//! logger health information, readable at any time
+typedef struct
+{
+  uint32_t dropped_records;	//!< records rejected because the ring was full
+  uint32_t dropped_words;	//!< payload words of the rejected records
+  uint32_t max_pending_slots;	//!< high-water mark of slots waiting for the uSD card
+  uint32_t slots_written;	//!< total number of slots written to the uSD card
+  uint32_t max_write_time_usec;	//!< longest f_write of a single slot (ANALYZE_WRITE_PERFORMANCE only)
+  uint32_t preallocated_bytes;	//!< contiguous size reserved by f_expand when the file was opened
+  uint32_t growth_steps;	//!< number of times the file had to be extended during logging
+  uint32_t syncs;		//!< number of f_sync calls really executed
+  uint32_t checkpoints;		//!< LOG_CHECKPOINT records written
+  uint32_t captured_bytes;	//!< logged into the ring before the file was opened
+  uint32_t captured_dropped_records; //!< dropped before the file was opened: ring too small
+} log_file_statistics_t;
+
+/*! \brief log file writer using a ring of equally sized slots
+ *
+ *  The producer (communicator task) fills the slots one after the other.
+ *  A completed slot is handed over to the uSD task using the signal function.
+ *  The slots come from the main buffer plus an optional spill area
+ *  which may reside in a different RAM location.
+ *
+ *  If the uSD card stalls and all slots are pending complete records are dropped
+ *  and counted instead of overwriting data that has not yet been written.
+ *
+ *  The file is preallocated contiguously for an expected flight length and extended
+ *  in large chunks if necessary, so the FAT is not touched during normal logging.
+ *  Slots are always written as whole sector multiples, neighbouring slots are merged
+ *  into one multi-block write. At close() the file is truncated to the data written.
+ *
+ *  close() appends a seek index footer, see log_file_index.h.
+ *  Checkpoint records allow to recover the file after a power loss, see log_file_recovery.h.
+ *
+ *  start_capture() makes the ring accept records before the file exists (pre-trigger),
+ *  open() then writes them to the start of the file.
+ */
 class flexible_log_file_implementation_t : public flexible_log_file_t
 {
 public:
-
-  flexible_log_file_implementation_t ( uint32_t * buf, unsigned size_words, FPTR _signal)
-  : flexible_log_file_t( buf, size_words),
-    file_is_open( false),
-    status( FILLING_LOW),
-    second_part ( buffer + size_words / 2),
-    signal( _signal)
+  enum
   {
-  }
+    //! bumped for the compact record types, see compact_record_codec.h, only written if they are enabled
+    FLEXIBLE_LOG_FILE_FORMAT_VERSION = flexible_log_file_t::FLEXIBLE_LOG_FILE_FORMAT_VERSION + 1,
+    MAX_SLOTS = 32,
+    RECORD_OVERHEAD_WORDS = 2, //!< upper limit for the record header size
+    MAX_RESERVE_WORDS = 128, //!< largest record that can be reserved, see compact_record_codec_t::get_max_encoded_words()
+    MAX_FILE_NAME_SIZE = 40
+  };
+
+  flexible_log_file_implementation_t (
+      uint32_t * buf, unsigned size_words, FPTR _signal,
+      unsigned _slot_size_words,
+      uint32_t * spill_buf = 0, unsigned spill_size_words = 0);
 
   virtual ~flexible_log_file_implementation_t()
   {
@@ -35,13 +79,84 @@ public:
     if( not file_is_open)
       return true; // silently give up
 
+    checkpoint_if_due();
+
+    if( free_words() < data_size_words + RECORD_OVERHEAD_WORDS)
+      {
+	// uSD card too slow: drop the complete record, never corrupt the stream
+	++statistics.dropped_records;
+	statistics.dropped_words += data_size_words;
+	return false;
+      }
+
+    count_record( type);
+
     // delegate to base class
     return flexible_log_file_t::append_record(type, data, data_size_words);
   }
 
+  //! \brief note the present file position for a GNSS time, to be called before logging GNSS data
+  void index_time( uint32_t time_key);
+
+  /*! \brief reserve space for a record to be serialized in place
+   *
+   *  If the record fits into the present slot the span points into the ring,
+   *  otherwise it points to a bounce buffer which is copied into the ring on commit().
+   *  No other record must be appended between reserve() and commit().
+   *  data_size_words may be an upper limit, commit() drops the record if the ring
+   *  has not enough room for the size actually used.
+   *
+   *  \return pointer to data_size_words words or zero if the record must be dropped
+   */
+  uint32_t * reserve( flexible_log_file_record_type type, uint32_t data_size_words);
+
+  //! \brief finish the record started by reserve()
+  bool commit( void)
+  {
+    return commit( reserved_size_words);
+  }
+
+  //! \brief finish the record started by reserve() with the size used, at most the reserved size
+  bool commit( uint32_t data_size_words);
+
+  /*! \brief accept records before the file can be opened
+   *
+   *  The records are kept in the ring until open(), if it overflows new records are dropped.
+   */
+  void start_capture( void);
+
   bool open( char * file_name) override;
+
+  //! \brief give the open file its final name, logging continues
+  bool rename( const char * new_name);
+
+  //! \brief while a file is open the marker file contains its name, 0 = no marker
+  void set_open_marker( const char * marker_name)
+  {
+    open_marker = marker_name;
+  }
+
+  //! \brief record framing of the base class, as needed by the log file recovery
+  bool get_record_framing( log_record_framing_t & framing)
+  {
+    if( not framing_known)
+      measure_record_framing();
+    framing.header_words = header_words;
+    framing.trailer_words = trailer_words;
+    return framing_known;
+  }
+
   bool flush_buffer( void);
   bool sync_file( void);
+
+  //! \brief f_sync only if the configured time or byte interval has elapsed
+  bool sync_file_if_due( void);
+
+  void set_sync_interval( unsigned milliseconds, uint32_t bytes)
+  {
+    sync_interval_usec = (uint64_t)milliseconds * 1000;
+    sync_interval_bytes = bytes;
+  }
   bool close( void) override;
   void block_input( void)
   {
@@ -50,20 +165,115 @@ public:
 
   bool write_block( uint32_t * begin, uint32_t size_words);
 
+  const log_file_statistics_t & get_statistics( void) const
+  {
+    return statistics;
+  }
+
+  unsigned get_slot_count( void) const
+  {
+    return slot_count;
+  }
+
+  unsigned get_slot_size_words( void) const
+  {
+    return slot_size_words;
+  }
+
+  /*! \brief the most recent ring content in stream order, for the crash dump
+   *
+   *  Whole slots are taken, oldest first, so the first record may be cut.
+   *  \return number of pieces, piece i is words[i] words from begin[i]
+   */
+  unsigned get_recent_data( const uint32_t * begin[], unsigned words[],
+			    unsigned max_pieces, unsigned max_words) const;
+
 private:
-  enum {
-    FILLING_LOW=1,
-    FILLING_HIGH=2,
-    WRITING_LOW=4,
-    WRITING_HIGH=8
-  };
+  //! words that can be appended without touching slots pending for the uSD card
+  unsigned free_words( void) const
+  {
+    unsigned pending = slots_filled - slots_written;
+    if( pending >= slot_count)
+      return 0; // even the present slot is still waiting to be written
+    return (slot_end - write_pointer) + (slot_count - 1 - pending) * slot_size_words;
+  }
+
+  void start_slot( unsigned index)
+  {
+    write_pointer = slot[index];
+    slot_end = slot[index] + slot_size_words;
+  }
+
+  void measure_record_framing( void);
+
+  //! file offset of the next record
+  uint32_t current_offset_bytes( void) const
+  {
+    return ( slots_filled * slot_size_words + ( write_pointer - slot[slots_filled % slot_count])) * sizeof( uint32_t);
+  }
+
+  void count_record( flexible_log_file_record_type type)
+  {
+    if( (unsigned)type < LOG_RECORD_TYPES_COUNTED)
+      ++index.record_count[type];
+  }
+
+  void checkpoint_if_due( void)
+  {
+    if( current_offset_bytes() >= next_checkpoint_offset)
+      write_checkpoint();
+  }
+
+  void begin_stream( void);
+  void write_open_marker( void);
+  void write_checkpoint( void);
+  void write_index( void);
+  void preallocate( void);
+  bool ensure_allocation( FSIZE_t end_of_write);
 
-  void wrap_around( void);
   FIL out_file;
-  bool file_is_open;
-  uint32_t status;
-  uint32_t *second_part;
+  bool file_is_open;		//!< records are accepted
+  bool capturing;		//!< ... but the file does not exist yet
+  char current_file_name[MAX_FILE_NAME_SIZE];
   FPTR signal;
+  unsigned slot_size_words;
+  unsigned slot_count;
+  uint32_t * slot[MAX_SLOTS];
+  uint32_t * slot_end;
+  volatile uint32_t slots_filled;	//!< maintained by the producer only
+  volatile uint32_t slots_written;	//!< maintained by the uSD task only
+  log_file_statistics_t statistics;
+
+  // file allocation and f_sync policy
+  FSIZE_t allocated_size;		//!< present file size incl. unused preallocated space
+  uint32_t bytes_since_sync;
+  uint64_t last_sync_usec;
+  uint64_t sync_interval_usec;
+  uint32_t sync_interval_bytes;
+
+  // seek index, written as footer by close()
+  log_index_t index;
+  bool index_pending;		//!< footer still to be written, independent of block_input()
+
+  // checkpoint journal, see log_file_recovery.h
+  log_checkpoint_t checkpoint;
+  uint32_t running_crc;		//!< over all words since the start of the last checkpoint record
+  uint32_t next_checkpoint_offset;
+  const char * open_marker;
+  bool open_marker_written;
+
+  // record framing of the base class, learned once by measure_record_framing()
+  uint32_t * framing_probe;		//!< non-zero during measurement
+  bool framing_known;
+  bool framing_data_seen;
+  unsigned header_words;
+  unsigned trailer_words;
+
+  // state between reserve() and commit()
+  flexible_log_file_record_type reserved_type;
+  uint32_t reserved_size_words;
+  uint32_t * reserved_span;
+  uint32_t bounce_buffer[MAX_RESERVE_WORDS];
 };
 
 #endif
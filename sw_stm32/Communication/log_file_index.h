@@ -0,0 +1,117 @@
+/** *****************************************************************************
+ * @file    	log_file_index.h
+ * @brief   	seek index footer of the flexible log files
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef LOG_FILE_INDEX_H_
+#define LOG_FILE_INDEX_H_
+
+#include "stdint.h"
+#include "string.h"
+#include "log_record_types.h"
+
+/* A closed log file ends with
+ *
+ *   LOG_INDEX_FOOTER	log_index_t, truncated behind the last used entry
+ *   LOG_INDEX_LOCATOR	log_index_locator_t
+ *
+ * The locator has a fixed size, so a reader finds it at the end of the file
+ * and jumps to the footer directly. Files without a locator (power loss)
+ * have to be scanned linearly.
+ */
+
+#define LOG_INDEX_MAGIC		0x5844494c // "LIDX"
+#define LOG_INDEX_ENTRIES	256
+
+//! position of the first record logged for a GNSS time
+typedef struct
+{
+  uint32_t time_key;		//!< see gnss_time_key()
+  uint32_t offset_bytes;	//!< from the start of the file
+} log_index_entry_t;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t interval_seconds;	//!< time between entries, doubled whenever the table is full
+  uint32_t entries;
+  uint32_t counted_types;	//!< = LOG_RECORD_TYPES_COUNTED
+  uint32_t record_count[LOG_RECORD_TYPES_COUNTED]; //!< index = record type
+  log_index_entry_t entry[LOG_INDEX_ENTRIES];
+} log_index_t;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t footer_offset_bytes;
+} log_index_locator_t;
+
+//! words of a footer record with n entries
+inline uint32_t log_index_size_words( uint32_t entries)
+{
+  return ( sizeof( log_index_t) - ( LOG_INDEX_ENTRIES - entries) * sizeof( log_index_entry_t)) / sizeof( uint32_t);
+}
+
+inline void log_index_start( log_index_t & index, uint32_t interval_seconds)
+{
+  memset( &index, 0, sizeof( index));
+  index.magic = LOG_INDEX_MAGIC;
+  index.interval_seconds = interval_seconds;
+  index.counted_types = LOG_RECORD_TYPES_COUNTED;
+}
+
+/*! \brief add an entry if the interval since the last one has elapsed
+ *
+ *  If the table is full every second entry is dropped and the interval is doubled,
+ *  so the index covers flights of any length with constant memory.
+ *  Shared by the firmware and the host tools to get identical footers.
+ */
+inline void log_index_add( log_index_t & index, uint32_t time_key, uint32_t offset_bytes)
+{
+  if( index.entries > 0)
+    {
+      if( time_key < index.entry[index.entries - 1].time_key + index.interval_seconds)
+	return;
+
+      if( index.entries == LOG_INDEX_ENTRIES) // table full: thin it out
+	{
+	  for( unsigned i = 1; i < LOG_INDEX_ENTRIES / 2; ++i)
+	    index.entry[i] = index.entry[2 * i];
+	  index.entries = LOG_INDEX_ENTRIES / 2;
+	  index.interval_seconds *= 2;
+	  if( time_key < index.entry[index.entries - 1].time_key + index.interval_seconds)
+	    return;
+	}
+    }
+
+  index.entry[index.entries].time_key = time_key;
+  index.entry[index.entries].offset_bytes = offset_bytes;
+  ++index.entries;
+}
+
+//! monotonic GNSS time in seconds, valid within one month
+template <class GNSS_time> uint32_t gnss_time_key( const GNSS_time & t)
+{
+  return ( ( (uint32_t)t.day * 24 + t.hour) * 60 + t.minute) * 60 + t.second;
+}
+
+#endif /* LOG_FILE_INDEX_H_ */
@@ -0,0 +1,202 @@
+/** *****************************************************************************
+ * @file    	log_file_recovery.cpp
+ * @brief   	checkpoint journal and power loss recovery of log files
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "log_file_recovery.h"
+#include "stm32_crc.h"
+#include "common.h"
+
+#define RECOVERY_CHUNK_WORDS	128 // one sector
+#define CHECKPOINT_WORDS	( sizeof( log_checkpoint_t) / sizeof( uint32_t))
+
+COMMON uint32_t log_recovery_buffer[RECOVERY_CHUNK_WORDS];
+
+//!< read words at a file offset, returns the number of words read
+static unsigned read_words( FIL & file, uint32_t offset_bytes, uint32_t * target, unsigned words)
+{
+  UINT bytes_read = 0;
+  if( ( offset_bytes >= f_size( &file))
+      || ( f_lseek( &file, offset_bytes) != FR_OK)
+      || ( f_read( &file, target, words * sizeof( uint32_t), &bytes_read) != FR_OK))
+    return 0;
+  return bytes_read / sizeof( uint32_t);
+}
+
+//!< CRC of the file content [begin, end), false if not readable
+static bool crc_of_range( FIL & file, uint32_t begin, uint32_t end, uint32_t & crc)
+{
+  crc = STM32_CRC_INIT;
+  while( begin < end)
+    {
+      unsigned words = ( end - begin) / sizeof( uint32_t);
+      if( words > RECOVERY_CHUNK_WORDS)
+	words = RECOVERY_CHUNK_WORDS;
+      if( read_words( file, begin, log_recovery_buffer, words) != words)
+	return false;
+      crc = stm32_crc( crc, log_recovery_buffer, words);
+      begin += words * sizeof( uint32_t);
+    }
+  return true;
+}
+
+//!< search checkpoint "sequence" in [begin, end), file_id is not checked for checkpoint 0
+static bool locate_checkpoint( FIL & file, uint32_t begin, uint32_t end, uint32_t sequence, uint32_t file_id,
+			       log_checkpoint_t & checkpoint, uint32_t & payload_offset)
+{
+  for( uint32_t offset = begin; offset < end; offset += sizeof( log_recovery_buffer))
+    {
+      unsigned words = read_words( file, offset, log_recovery_buffer, RECOVERY_CHUNK_WORDS);
+      for( unsigned i = 0; ( i < words) && ( offset + i * sizeof( uint32_t) < end); ++i)
+	{
+	  if( log_recovery_buffer[i] != LOG_CHECKPOINT_MAGIC)
+	    continue;
+
+	  uint32_t candidate = offset + i * sizeof( uint32_t);
+	  if( ( read_words( file, candidate, (uint32_t *)&checkpoint, CHECKPOINT_WORDS) == CHECKPOINT_WORDS)
+	      && ( checkpoint.sequence == sequence)
+	      && ( ( sequence == 0) || ( checkpoint.file_id == file_id)))
+	    {
+	      payload_offset = candidate;
+	      return true;
+	    }
+	}
+      if( words < RECOVERY_CHUNK_WORDS)
+	break; // end of file
+    }
+  return false;
+}
+
+//!< check checkpoint k, reference = checkpoint 0, returns the end of the checkpoint record
+static bool probe_checkpoint( FIL & file, uint32_t k, const log_checkpoint_t & reference,
+			      const log_record_framing_t & framing, log_recovery_result_t & result, uint32_t & record_end)
+{
+  ++result.probes;
+
+  uint32_t begin = k * reference.interval_bytes;
+  uint32_t end = k == 0 ? sizeof( log_recovery_buffer) : begin + reference.interval_bytes;
+  log_checkpoint_t checkpoint;
+  uint32_t payload_offset;
+  if( not locate_checkpoint( file, begin, end, k, reference.file_id, checkpoint, payload_offset))
+    return false;
+
+  uint32_t record_start = payload_offset - framing.header_words * sizeof( uint32_t);
+  if( ( payload_offset < framing.header_words * sizeof( uint32_t))
+      || ( k > 0 && checkpoint.interval_bytes != reference.interval_bytes)
+      || ( checkpoint.previous_offset_bytes > record_start)
+      || ( k > 0 && checkpoint.previous_offset_bytes == record_start))
+    return false;
+
+  uint32_t crc;
+  if( ( not crc_of_range( file, checkpoint.previous_offset_bytes, record_start, crc))
+      || ( crc != checkpoint.crc))
+    return false;
+
+  record_end = payload_offset + ( CHECKPOINT_WORDS + framing.trailer_words) * sizeof( uint32_t);
+  return record_end <= f_size( &file);
+}
+
+bool find_log_recovery_point( FIL & file, const log_record_framing_t & framing, log_recovery_result_t & result)
+{
+  result.original_bytes = f_size( &file);
+  result.recovered_bytes = 0;
+  result.last_sequence = 0;
+  result.interval_bytes = 0;
+  result.probes = 0;
+
+  // checkpoint 0 is the first record and tells the interval and the file id
+  log_checkpoint_t reference;
+  uint32_t payload_offset;
+  if( not locate_checkpoint( file, 0, sizeof( log_recovery_buffer), 0, 0, reference, payload_offset))
+    return false;
+  if( ( reference.interval_bytes < sizeof( log_recovery_buffer))
+      || ( reference.interval_bytes % sizeof( uint32_t) != 0))
+    return false;
+
+  uint32_t good = 0, good_end = 0;
+  if( not probe_checkpoint( file, 0, reference, framing, result, good_end))
+    return false;
+
+  // valid checkpoints form a prefix: binary search for its end
+  uint32_t bad = result.original_bytes / reference.interval_bytes + 1;
+  while( bad - good > 1)
+    {
+      uint32_t middle = good + ( bad - good) / 2;
+      uint32_t middle_end;
+      if( probe_checkpoint( file, middle, reference, framing, result, middle_end))
+	{
+	  good = middle;
+	  good_end = middle_end;
+	}
+      else
+	bad = middle;
+    }
+
+  // checkpoints may be missing if records had to be dropped: look a bit further
+  for( uint32_t k = good + 1;
+      ( k <= good + LOG_CHECKPOINT_LOOKAHEAD) && ( k * reference.interval_bytes < result.original_bytes);
+      ++k)
+    {
+      uint32_t k_end;
+      if( probe_checkpoint( file, k, reference, framing, result, k_end))
+	{
+	  good = k;
+	  good_end = k_end;
+	}
+    }
+
+  result.last_sequence = good;
+  result.interval_bytes = reference.interval_bytes;
+  result.recovered_bytes = good_end;
+  return true;
+}
+
+bool recover_log_file( const char * file_name, const log_record_framing_t & framing, log_recovery_result_t & result)
+{
+  FIL file;
+  if( f_open( &file, (const TCHAR*)file_name, FA_READ | FA_WRITE) != FR_OK)
+    return false;
+
+  bool success = find_log_recovery_point( file, framing, result);
+  if( success && ( result.recovered_bytes < result.original_bytes))
+    success = ( f_lseek( &file, result.recovered_bytes) == FR_OK) && ( f_truncate( &file) == FR_OK);
+
+  success &= ( f_close( &file) == FR_OK);
+  return success;
+}
+
+bool recover_unclosed_log_file( const char * marker_name, const log_record_framing_t & framing, log_recovery_result_t & result)
+{
+  FIL marker;
+  if( f_open( &marker, (const TCHAR*)marker_name, FA_READ) != FR_OK)
+    return false; // the last log file has been closed properly
+
+  char file_name[64];
+  UINT bytes_read = 0;
+  FRESULT fresult = f_read( &marker, file_name, sizeof( file_name) - 1, &bytes_read);
+  f_close( &marker);
+  file_name[ fresult == FR_OK ? bytes_read : 0] = 0;
+
+  bool success = ( file_name[0] != 0) && recover_log_file( file_name, framing, result);
+  f_unlink( (const TCHAR*)marker_name);
+  return success;
+}
@@ -0,0 +1,88 @@
+/** *****************************************************************************
+ * @file    	log_file_recovery.h
+ * @brief   	checkpoint journal and power loss recovery of log files
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef LOG_FILE_RECOVERY_H_
+#define LOG_FILE_RECOVERY_H_
+
+#include "stdint.h"
+#include "fatfs.h"
+#include "log_record_types.h"
+
+/* While logging a LOG_CHECKPOINT record is written at the first record boundary
+ * behind every multiple of LOG_CHECKPOINT_INTERVAL_BYTES, checkpoint 0 is the
+ * first record of the file. Each checkpoint carries the CRC of all bytes from
+ * the start of the previous checkpoint record up to its own record start.
+ *
+ * After a power loss the file still has its preallocated size and contains
+ * stale data behind the last sector written. Checkpoint k can only be found
+ * in [k * interval, (k+1) * interval), so the last intact checkpoint is found
+ * by a binary search over k, reading a few KBytes per step.
+ * The file is truncated behind that checkpoint record.
+ *
+ * The same code is used by the firmware at boot and by Host_Tools/lrsx_salvage.
+ */
+
+#define LOG_CHECKPOINT_MAGIC		0x504b434c // "LCKP"
+#define LOG_CHECKPOINT_LOOKAHEAD	4 //!< checkpoints skipped by record drops that are bridged
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t file_id;		//!< per file, tells stale data of older files apart
+  uint32_t sequence;		//!< = record offset / interval_bytes
+  uint32_t interval_bytes;
+  uint32_t previous_offset_bytes; //!< record start of the previous checkpoint, 0 for checkpoint 0
+  uint32_t crc;			//!< stm32_crc() of [previous_offset_bytes, own record start)
+} log_checkpoint_t;
+
+//! words the base class writes before and after a record payload
+typedef struct
+{
+  unsigned header_words;
+  unsigned trailer_words;
+} log_record_framing_t;
+
+typedef struct
+{
+  uint32_t original_bytes;	//!< file size found
+  uint32_t recovered_bytes;	//!< file size after truncation
+  uint32_t last_sequence;	//!< of the last valid checkpoint
+  uint32_t interval_bytes;	//!< checkpoint spacing used by the file
+  uint32_t probes;		//!< checkpoints examined
+} log_recovery_result_t;
+
+/*! \brief find the end of the last intact checkpoint record
+ *  \return false if the file has no valid checkpoint 0
+ */
+bool find_log_recovery_point( FIL & file, const log_record_framing_t & framing, log_recovery_result_t & result);
+
+//! truncate the file behind the last intact checkpoint, false if not possible
+bool recover_log_file( const char * file_name, const log_record_framing_t & framing, log_recovery_result_t & result);
+
+/*! \brief recover the log file named in the marker file and remove the marker
+ *  \return false if there was nothing to recover
+ */
+bool recover_unclosed_log_file( const char * marker_name, const log_record_framing_t & framing, log_recovery_result_t & result);
+
+#endif /* LOG_FILE_RECOVERY_H_ */
@@ -0,0 +1,204 @@
+/** *****************************************************************************
+ * @file    	log_rate_scheduler.cpp
+ * @brief   	flight phase dependent decimation of log records
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "system_configuration.h"
+#include "embedded_memory.h"
+#include "embedded_math.h"
+#include "log_rate_scheduler.h"
+#include "EEPROM_data_file_implementation.h"
+#include "stm32_crc.h"
+#include "ascii_support.h"
+#include "string.h"
+#include "stdlib.h"
+
+#define TICKS_PER_SECOND 10 // update_phase() rate
+#define AIR_DENSITY_SEA_LEVEL 1.225f
+
+ROM log_rate_policy_t DEFAULT_LOG_RATE_POLICY =
+{
+  {
+    // sensor, state vector, magnetometer, GNSS
+    { 1, 10, LOG_RATE_ON_CHANGE, 10 },	// ground idle: full rate sensor data for the alignment, 1 Hz GNSS
+    { 1, 1, LOG_RATE_ON_CHANGE, 1 },	// launch
+    { 1, 1, LOG_RATE_ON_CHANGE, 1 },	// flight
+    { 1, 1, LOG_RATE_ON_CHANGE, 1 }	// post landing
+  }
+};
+
+//! names used in the configuration file, order of flight_phase_t
+static ROM char * const PHASE_NAMES[FLIGHT_PHASES] = { "GROUND", "LAUNCH", "FLIGHT", "LANDED" };
+
+log_rate_scheduler_t::log_rate_scheduler_t( void)
+: policy( DEFAULT_LOG_RATE_POLICY),
+  phase( PHASE_GROUND_IDLE),
+  phase_time( 0),
+  idle_time( 0),
+  counter(),
+  last_record_crc()
+{}
+
+void log_rate_scheduler_t::load_policy( void)
+{
+  if( not read_blob( LOG_RATE_POLICY_EEPROM_ID, sizeof( policy) / sizeof( uint32_t), &policy))
+    policy = DEFAULT_LOG_RATE_POLICY;
+}
+
+void log_rate_scheduler_t::enter( flight_phase_t new_phase)
+{
+  phase = new_phase;
+  phase_time = idle_time = 0;
+  memset( counter, 0, sizeof( counter)); // start with a record of every class
+}
+
+bool log_rate_scheduler_t::update_phase( float dynamic_pressure, float ground_speed, bool landing_detected)
+{
+  float IAS = dynamic_pressure > 0.0f ? SQRT( 2.0f * dynamic_pressure / AIR_DENSITY_SEA_LEVEL) : 0.0f;
+  bool moving = ( IAS > LOG_PHASE_LAUNCH_IAS) || ( ground_speed > LOG_PHASE_TAXI_GROUND_SPEED);
+  flight_phase_t old_phase = phase;
+
+  switch( phase)
+    {
+    case PHASE_GROUND_IDLE:
+      if( moving)
+	enter( PHASE_LAUNCH);
+      break;
+    case PHASE_LAUNCH:
+      if( IAS > LOG_PHASE_FLIGHT_IAS)
+	{
+	  idle_time = 0;
+	  if( ++phase_time >= LOG_PHASE_FLIGHT_CONFIRM_S * TICKS_PER_SECOND)
+	    enter( PHASE_FLIGHT);
+	}
+      else
+	{
+	  phase_time = 0;
+	  if( moving)
+	    idle_time = 0;
+	  else if( ++idle_time >= LOG_PHASE_LAUNCH_ABORT_S * TICKS_PER_SECOND)
+	    enter( PHASE_GROUND_IDLE);
+	}
+      break;
+    case PHASE_FLIGHT:
+      if( landing_detected)
+	enter( PHASE_POST_LANDING);
+      break;
+    case PHASE_POST_LANDING:
+    default:
+      if( IAS > LOG_PHASE_FLIGHT_IAS)
+	enter( PHASE_LAUNCH);
+      else if( ++phase_time >= LOG_PHASE_POST_LANDING_S * TICKS_PER_SECOND)
+	enter( PHASE_GROUND_IDLE);
+      break;
+    }
+
+  return phase != old_phase;
+}
+
+bool log_rate_scheduler_t::due( log_rate_class_t log_class, const void * record, unsigned size_words)
+{
+  uint8_t ratio = policy.decimation[phase][log_class];
+  switch( ratio)
+    {
+    case LOG_RATE_OFF:
+      return false;
+    case LOG_RATE_ON_CHANGE:
+      {
+	uint32_t crc = stm32_crc( STM32_CRC_INIT, (const uint32_t *)record, size_words);
+	bool changed = crc != last_record_crc[log_class];
+	last_record_crc[log_class] = crc;
+	return changed;
+      }
+    default:
+      {
+	bool result = counter[log_class] == 0;
+	if( ++counter[log_class] >= ratio)
+	  counter[log_class] = 0;
+	return result;
+      }
+    }
+}
+
+void log_rate_scheduler_t::get_record( log_rate_record_t & record) const
+{
+  record.phase = phase;
+  memcpy( record.decimation, policy.decimation[phase], sizeof( record.decimation));
+}
+
+bool configure_log_rate_policy( const char * line)
+{
+  static ROM char PREFIX[] = "LOG_RATE_";
+  if( strncmp( line, PREFIX, sizeof( PREFIX) - 1) != 0)
+    return false;
+  line += sizeof( PREFIX) - 1;
+
+  unsigned phase = 0;
+  while( ( phase < FLIGHT_PHASES) && ( strncmp( line, PHASE_NAMES[phase], strlen( PHASE_NAMES[phase])) != 0))
+    ++phase;
+  if( phase == FLIGHT_PHASES)
+    return false;
+  line += strlen( PHASE_NAMES[phase]);
+
+  while( ( *line == ' ') || ( *line == '\t'))
+    ++line;
+  if( *line++ != '=')
+    return false;
+
+  uint8_t decimation[LOG_RATE_CLASSES];
+  for( unsigned log_class = 0; log_class < LOG_RATE_CLASSES; ++log_class)
+    {
+      char * end;
+      long value = strtol( line, &end, 10);
+      if( ( end == line) || ( value < 0) || ( value > LOG_RATE_ON_CHANGE))
+	return false;
+      decimation[log_class] = (uint8_t)value;
+      line = end;
+    }
+
+  log_rate_policy_t policy;
+  if( not read_blob( LOG_RATE_POLICY_EEPROM_ID, sizeof( policy) / sizeof( uint32_t), &policy))
+    policy = DEFAULT_LOG_RATE_POLICY;
+  if( memcmp( policy.decimation[phase], decimation, sizeof( decimation)) == 0)
+    return true; // save EEPROM write cycles
+
+  memcpy( policy.decimation[phase], decimation, sizeof( decimation));
+  return write_blob( LOG_RATE_POLICY_EEPROM_ID, sizeof( policy) / sizeof( uint32_t), &policy);
+}
+
+char * format_log_rate_policy( char * next, flight_phase_t phase)
+{
+  log_rate_policy_t policy;
+  if( not read_blob( LOG_RATE_POLICY_EEPROM_ID, sizeof( policy) / sizeof( uint32_t), &policy))
+    policy = DEFAULT_LOG_RATE_POLICY;
+
+  append_string( next, "LOG_RATE_");
+  append_string( next, PHASE_NAMES[phase]);
+  append_string( next, " =");
+  for( unsigned log_class = 0; log_class < LOG_RATE_CLASSES; ++log_class)
+    {
+      *next++ = ' ';
+      next = my_itoa( next, policy.decimation[phase][log_class]);
+    }
+  *next = 0;
+  return next;
+}
@@ -0,0 +1,123 @@
+/** *****************************************************************************
+ * @file    	log_rate_scheduler.h
+ * @brief   	flight phase dependent decimation of log records
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef LOG_RATE_SCHEDULER_H_
+#define LOG_RATE_SCHEDULER_H_
+
+#include "stdint.h"
+#include "log_record_types.h"
+
+typedef enum
+{
+  PHASE_GROUND_IDLE,
+  PHASE_LAUNCH,		//!< taxi, ground roll and launch
+  PHASE_FLIGHT,
+  PHASE_POST_LANDING,
+  FLIGHT_PHASES
+} flight_phase_t;
+
+//! record groups sharing one decimation ratio
+typedef enum
+{
+  LOG_CLASS_SENSOR_DATA,	//!< BASIC_SENSOR_DATA or COMPACT_SENSOR_DATA @ 100 Hz
+  LOG_CLASS_STATE_VECTOR,	//!< COMPACT_STATE_VECTOR @ 100 Hz
+  LOG_CLASS_MAGNETOMETER,	//!< MAGNETOMETER_DATA @ 100 Hz
+  LOG_CLASS_GNSS,		//!< GNSS_DATA or D_GNSS_DATA @ GNSS rate
+  LOG_RATE_CLASSES
+} log_rate_class_t;
+
+enum
+{
+  LOG_RATE_OFF = 0,		//!< never logged
+  LOG_RATE_ON_CHANGE = 255	//!< logged if different from the last one, other values: every n-th record
+};
+
+//! stored in the EEPROM file system as LOG_RATE_POLICY_EEPROM_ID
+typedef struct
+{
+  uint8_t decimation[FLIGHT_PHASES][LOG_RATE_CLASSES];
+} log_rate_policy_t;
+
+//! LOG_RATE_POLICY record, logged at the file start and on every phase change
+typedef struct
+{
+  uint32_t phase;		//!< flight_phase_t
+  uint8_t decimation[LOG_RATE_CLASSES]; //!< now in effect
+} log_rate_record_t;
+
+/*! \brief decides which records are logged, depending on the flight phase
+ *
+ *  The phase is derived at 10 Hz from the indicated airspeed, the GNSS ground speed
+ *  and the organizer's landing detection.
+ *  The decimation ratios per phase come from the EEPROM, see load_policy().
+ */
+class log_rate_scheduler_t
+{
+public:
+  log_rate_scheduler_t( void);
+
+  //! use the EEPROM policy if there is one, the default policy otherwise
+  void load_policy( void);
+
+  /*! \brief phase state machine, to be called @ 10 Hz
+   *  \return true if the phase has changed
+   */
+  bool update_phase( float dynamic_pressure, float ground_speed, bool landing_detected);
+
+  flight_phase_t get_phase( void) const
+  {
+    return phase;
+  }
+
+  //! \brief true if this record shall be logged
+  bool due( log_rate_class_t log_class, const void * record, unsigned size_words);
+
+  //! the LOG_RATE_POLICY record describing the present state
+  void get_record( log_rate_record_t & record) const;
+
+private:
+  void enter( flight_phase_t new_phase);
+
+  log_rate_policy_t policy;
+  flight_phase_t phase;
+  unsigned phase_time;		//!< 10 Hz ticks, meaning depends on the phase
+  unsigned idle_time;		//!< 10 Hz ticks without motion during PHASE_LAUNCH
+  uint8_t counter[LOG_RATE_CLASSES];
+  uint32_t last_record_crc[LOG_RATE_CLASSES];
+};
+
+//! default policy: full rate sensor data always, other records reduced on the ground
+extern const log_rate_policy_t DEFAULT_LOG_RATE_POLICY;
+
+/*! \brief configuration file line "LOG_RATE_<phase> = sensor state_vector magnetometer GNSS"
+ *
+ *  <phase> is GROUND, LAUNCH, FLIGHT or LANDED, 255 means "on change".
+ *  \return false if the line is not a log rate line
+ */
+bool configure_log_rate_policy( const char * line);
+
+//! the configuration file line for this phase, \return end of the line
+char * format_log_rate_policy( char * next, flight_phase_t phase);
+
+#endif /* LOG_RATE_SCHEDULER_H_ */
@@ -0,0 +1,44 @@
+/** *****************************************************************************
+ * @file    	log_record_types.h
+ * @brief   	record types beyond the ones defined in flexible_file_format.h
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef LOG_RECORD_TYPES_H_
+#define LOG_RECORD_TYPES_H_
+
+#include "flexible_file_format.h"
+
+// keep clear of the library's record types, which are allocated from 1 upwards
+#define COMPACT_SENSOR_DATA	((flexible_log_file_record_type)0x40) //!< compact measurement_data_t
+#define COMPACT_STATE_VECTOR	((flexible_log_file_record_type)0x41) //!< compact state_vector_t
+#define DECODED_STATE_VECTOR	((flexible_log_file_record_type)0x42) //!< plain state_vector_t, written by the host decoder only
+#define LOG_INDEX_FOOTER	((flexible_log_file_record_type)0x43) //!< log_index_t, written by close()
+#define LOG_INDEX_LOCATOR	((flexible_log_file_record_type)0x44) //!< last record: where the footer starts
+#define LOG_CHECKPOINT		((flexible_log_file_record_type)0x45) //!< log_checkpoint_t, journal for power loss recovery
+#define LOG_RATE_POLICY		((flexible_log_file_record_type)0x46) //!< log_rate_record_t, flight phase and decimation
+#define WARM_RESTART_REPORT	((flexible_log_file_record_type)0x47) //!< warm_restart_report_t, how the sensor has been started
+
+#define LOG_RECORD_TYPES_COUNTED 0x48 //!< record types below this are counted in the index footer
+
+#define BOOT_TIMELINE		((flexible_log_file_record_type)0x48) //!< boot_timeline_t, once, not counted
+
+#endif /* LOG_RECORD_TYPES_H_ */
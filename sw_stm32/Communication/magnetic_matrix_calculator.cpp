@@ -6,6 +6,7 @@
 
 #include "compass_calibrator_3D.h"
 #include "magnetic_matrix_calculator.h"
+#include "EEPROM_data_file_implementation.h"
 
 #define MAG_CALC_DATA_SIZE 8192
 magnetic_calculation_data_t __attribute__((section(".mag_calc_data"))) temporary_mag_calculation_data;
@@ -25,10 +26,20 @@ static void magnetic_calculator_runnable ( void *)
   while( true)
     {
       calculation_request.receive( do_calculate_external_mag);
+
+      // the calibration is saved as a whole or not at all
+      // calculate() saves its result itself, the transaction collects it in RAM,
+      // the EEPROM lock is taken by the commit only, not during the fit
+      begin_EEPROM_transaction();
+      bool success;
       if( do_calculate_external_mag)
-	(void) external_compass_calibrator_3D.calculate();
+	success = external_compass_calibrator_3D.calculate();
+      else
+	success = compass_calibrator_3D.calculate();
+      if( success)
+	(void) commit_EEPROM_transaction();
       else
-	(void) compass_calibrator_3D.calculate();
+	abort_EEPROM_transaction();
     }
 }
 
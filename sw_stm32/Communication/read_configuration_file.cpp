@@ -32,11 +32,14 @@
 #include "embedded_math.h"
 #include "read_configuration_file.h"
 #include "persistent_data.h"
+#include "log_rate_scheduler.h"
+#include "EEPROM_data_file_implementation.h"
 #include "stdlib.h"
+#include "string.h"
 
 #define TEST_MODULE 0
 
-#define LINELEN 50
+#define PARAMETER_HASH_SLOTS 64 // power of two, plenty of room makes a perfect hash easy to find
 
 bool is_white( char c)
 {
@@ -48,78 +51,197 @@ bool is_number_start( char c)
   return (( c >= '0') && ( c <='9')) || ( c =='-') || ( c =='+');
 }
 
-class ASCII_file_reader
+static bool is_name_end( char c)
 {
-  enum { BUFLEN = 512 *2};
+  return is_white( c) || ( c == '=') || ( c == 0);
+}
+
+//! reads the file chunk by chunk and returns it line by line, any file size
+class ASCII_line_reader
+{
+  enum { CHUNKLEN = 512, LINELEN = 128 };
 public:
-  ASCII_file_reader( char * filename)
-    : current(0),
-      end(0),
+  ASCII_line_reader( const char * filename)
+    : chunk_position(0),
+      chunk_end(0),
+      truncated_lines(0),
       eof(true)
   {
-    FRESULT fresult;
-    fresult = f_open(&infile, filename, FA_READ);
-    if( fresult != FR_OK)
-      return;
-
-    UINT bytesread;
-    fresult = f_read(&infile, file_buffer, BUFLEN, &bytesread);
-    if( (fresult != FR_OK) || (bytesread == 0))
-      return;
+    eof = f_open( &infile, (char *)filename, FA_READ) != FR_OK;
+  }
 
-    f_close( &infile);
+  ~ASCII_line_reader( void)
+  {
+    if( not eof)
+      f_close( &infile);
+  }
 
-    end = file_buffer + bytesread;
-    current = file_buffer;
-    eof=false;
+  bool is_open( void) const
+  {
+    return not eof;
   }
 
-  // return true if next line read, false if EOF
+  /*! \brief next line without the line end
+   *
+   *  Characters beyond LINELEN are dropped, the name and the value are in front.
+   *  \return false at the end of the file
+   */
   bool read_line( char * &target)
   {
     if( eof)
       return false;
-    target = current;
-    while( (current < end) && (*current != '\n'))
-      ++current;
-    while( (current < end) && (*current <= ' '))
-      ++current;
-    eof = current >= end;
+
+    unsigned length = 0;
+    bool truncated = false;
+    while( true)
+      {
+	if( chunk_position == chunk_end && not fill_chunk())
+	  break;
+	char c = chunk[chunk_position++];
+	if( c == '\n')
+	  break;
+	if( c == '\r')
+	  continue;
+	if( length < LINELEN)
+	  line[length++] = c;
+	else
+	  truncated = true;
+      }
+
+    if( length == 0 && chunk_position == chunk_end && eof)
+      return false;
+
+    if( truncated)
+      ++truncated_lines;
+    line[length] = 0;
+    target = line;
     return true;
   }
-  bool is_eof( void)
+
+  unsigned get_truncated_lines( void) const
   {
-    return eof;
+    return truncated_lines;
   }
+
 private:
+  bool fill_chunk( void)
+  {
+    UINT bytesread;
+    FRESULT fresult = f_read( &infile, chunk, CHUNKLEN, &bytesread);
+    chunk_position = 0;
+    chunk_end = ( fresult == FR_OK) ? bytesread : 0;
+    if( chunk_end == 0)
+      {
+	f_close( &infile);
+	eof = true;
+      }
+    return chunk_end != 0;
+  }
+
   FIL infile;
-  char file_buffer[BUFLEN];
-  char * current;
-  char * end;
+  char chunk[CHUNKLEN];
+  unsigned chunk_position;
+  unsigned chunk_end;
+  char line[LINELEN + 1];
+  unsigned truncated_lines;
   bool eof;
 };
 
+/*! \brief perfect hash: parameter mnemonic -> PERSISTENT_DATA entry
+ *
+ *  PERSISTENT_DATA is defined in the library, so the seed which maps all
+ *  mnemonics onto distinct slots is searched here once per configuration file.
+ *  A lookup costs one hash and one string compare.
+ */
+class parameter_name_hash_t
+{
+public:
+  parameter_name_hash_t( void)
+  : seed( 0)
+  {
+    ASSERT( PERSISTENT_DATA_ENTRIES < 255);
+    for( uint32_t candidate = 1; candidate < 10000; ++candidate)
+      if( try_seed( candidate))
+	{
+	  seed = candidate;
+	  break;
+	}
+  }
+
+  //! \return the parameter whose mnemonic starts the line or 0, length = mnemonic length
+  const persistent_data_t * find( const char * name, unsigned & length) const
+  {
+    if( seed == 0) // no perfect hash, should never happen
+      {
+	const persistent_data_t * parameter = find_parameter_from_name( (char *)name);
+	if( parameter)
+	  length = strlen( parameter->mnemonic);
+	return parameter;
+      }
+
+    uint8_t index = slot[ hash( name, seed, length)];
+    if( index == 0)
+      return 0;
+    const persistent_data_t * parameter = PERSISTENT_DATA + index - 1;
+    if( strncmp( name, parameter->mnemonic, length) != 0 || parameter->mnemonic[length] != 0)
+      return 0;
+    return parameter;
+  }
+
+private:
+  //! FNV-1a of the name up to a blank or '='
+  static unsigned hash( const char * name, uint32_t seed, unsigned & length)
+  {
+    uint32_t h = 0x811c9dc5 ^ seed;
+    for( length = 0; not is_name_end( name[length]); ++length)
+      h = ( h ^ (uint8_t)name[length]) * 0x01000193;
+    return ( h ^ ( h >> 16)) & ( PARAMETER_HASH_SLOTS - 1);
+  }
+
+  bool try_seed( uint32_t candidate)
+  {
+    memset( slot, 0, sizeof( slot));
+    for( unsigned index = 0; index < PERSISTENT_DATA_ENTRIES; ++index)
+      {
+	unsigned length;
+	unsigned h = hash( PERSISTENT_DATA[index].mnemonic, candidate, length);
+	if( slot[h] != 0)
+	  return false;
+	slot[h] = index + 1;
+      }
+    return true;
+  }
+
+  uint32_t seed;
+  uint8_t slot[PARAMETER_HASH_SLOTS]; //!< PERSISTENT_DATA index + 1, 0 = unused
+};
+
 bool read_init_file( const char * filename)
 {
-  ASCII_file_reader file_reader((char *)filename);
-  if( file_reader.is_eof())
+  ASCII_line_reader file_reader( filename);
+  if( not file_reader.is_open())
     return false;
 
+  parameter_name_hash_t parameters;
   char *position;
 
-  // get all readable configuration lines and program data into EEPROM
+  // get all readable configuration lines and program changed data into EEPROM
   while( file_reader.read_line( position))
     {
       // skip blanks and tabs
       while( is_white( *position))
 	++position;
 
-      const persistent_data_t *persistent_parameter = find_parameter_from_name( position);
+      unsigned length;
+      const persistent_data_t *persistent_parameter = parameters.find( position, length);
 
       if( persistent_parameter == 0) // unable to find parameter name
-	continue;
+	{
+	  (void) configure_log_rate_policy( position); // not in the EEPROM parameter table
+	  continue;
+	}
 
-      position += strlen( persistent_parameter->mnemonic);
+      position += length;
 
       // skip blanks and tabs
       while( is_white( *position))
@@ -149,9 +271,60 @@ bool read_init_file( const char * filename)
 	  while( value < -M_PI_F)
 	    value += M_PI_F * 2.0f;
 	}
+
+      float present_value;
+      if( ( not read_EEPROM_value( persistent_parameter->id, present_value))
+	  && ( memcmp( &present_value, &value, sizeof( float)) == 0))
+	continue; // save EEPROM write cycles
+
       bool success = write_EEPROM_value( persistent_parameter->id, value);
       ASSERT( success);
     }
 
   return true;
 }
+
+//! write one line, false on error
+static bool write_line( FIL & file, const char * line, unsigned length)
+{
+  UINT written;
+  FRESULT fresult = f_write( &file, line, length, &written);
+  return ( fresult == FR_OK) && ( written == length);
+}
+
+bool write_configuration_file( const char * filename)
+{
+  FIL file;
+  if( f_open( &file, (char *)filename, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+    return false;
+
+  char buffer[80];
+  char * next;
+  bool success = true;
+
+  for( unsigned index = 0; success && index < PERSISTENT_DATA_ENTRIES; ++index)
+    {
+      float value;
+      if( read_EEPROM_value( PERSISTENT_DATA[index].id, value)) // error
+	continue; // not a float parameter
+
+      if( PERSISTENT_DATA[index].is_an_angle)
+	value *= 180.0 / M_PI_F; // format it human readable
+
+      next = buffer;
+      append_string( next, PERSISTENT_DATA[index].mnemonic);
+      append_string( next, " = ");
+      next = my_ftoa( next, value);
+      newline( next);
+      success = write_line( file, buffer, next - buffer);
+    }
+
+  for( unsigned phase = 0; success && phase < FLIGHT_PHASES; ++phase)
+    {
+      next = format_log_rate_policy( buffer, (flight_phase_t)phase);
+      newline( next);
+      success = write_line( file, buffer, next - buffer);
+    }
+
+  return ( f_close( &file) == FR_OK) && success;
+}
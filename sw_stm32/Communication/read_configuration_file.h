@@ -25,6 +25,10 @@
 #ifndef SRC___READ_CONFIGURATION_FILE_H_
 #define SRC___READ_CONFIGURATION_FILE_H_
 
+//! program the parameters found in the file into the EEPROM, only changed ones are written
 bool read_init_file( const char * filename);
 
+//! export the present configuration in the format read_init_file() reads
+bool write_configuration_file( const char * filename);
+
 #endif /* SRC___READ_CONFIGURATION_FILE_H_ */
@@ -0,0 +1,201 @@
+/** *****************************************************************************
+ * @file    	trace_stream_sink.cpp
+ * @brief   	streaming trace: RAM sink between the trace recorder and the uSD card
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "system_configuration.h"
+#include "main.h"
+#include "FreeRTOS_wrapper.h"
+#include "fatfs.h"
+#include "common.h"
+#include "trace_stream_sink.h"
+#include "string.h"
+
+#if TRACE_STREAMING_TO_SD
+
+static_assert( ( TRACE_SINK_BYTES & ( TRACE_SINK_BYTES - 1)) == 0, "sink size must be a power of 2");
+static_assert( TRACE_SINK_BYTES % TRACE_SINK_CHUNK_BYTES == 0, "sink size must be a multiple of the chunk size");
+
+void sync_logger( void); // wakes up the uSD task
+extern "C" uint32_t DroppedEventCounter; // trcStreamingRecorder.c
+
+COMMON trace_sink_statistics_t trace_sink_statistics;
+
+static uint8_t __ALIGNED(4) sink[TRACE_SINK_BYTES]; // not in CCM RAM: read by the SDIO DMA
+static volatile uint32_t head; //!< bytes accepted since power-on, written by the TzCtrl task
+static volatile uint32_t tail; //!< bytes taken by the uSD task
+static volatile bool accepting;
+// the sink lives in privileged RAM, all access by the uSD task is done with privileges
+
+static FIL trace_file;
+static bool file_open;
+static char file_name[32];
+static traceString sink_channel;
+static uint32_t drops_reported;
+
+//!< stream port, called by the TzCtrl task with a page of trace data
+extern "C" int32_t trace_sink_write( void * data, uint32_t size, int32_t * bytes_written)
+{
+  if( bytes_written)
+    *bytes_written = (int32_t)size; // always: the recorder retries a partial write immediately
+
+  if( not accepting)
+    return 0; // left over from the previous file
+
+  if( size > TRACE_SINK_BYTES - ( head - tail))
+    {
+      ++trace_sink_statistics.dropped_pages;
+      trace_sink_statistics.dropped_bytes += size;
+      return 0;
+    }
+
+  uint32_t offset = head % TRACE_SINK_BYTES;
+  uint32_t first = size < TRACE_SINK_BYTES - offset ? size : TRACE_SINK_BYTES - offset;
+  memcpy( sink + offset, data, first);
+  memcpy( sink, (uint8_t *)data + first, size - first);
+  __asm volatile ("" ::: "memory"); // data first, then the head
+  head += size;
+
+  trace_sink_statistics.accepted_bytes += size;
+  if( head - tail >= TRACE_SINK_CHUNK_BYTES)
+    sync_logger(); // wake up the uSD task
+  return 0;
+}
+
+//!< write the contiguous part of at most max_bytes
+static bool write_chunk( uint32_t max_bytes)
+{
+  uint32_t offset = tail % TRACE_SINK_BYTES;
+  uint32_t bytes = head - tail;
+  if( bytes > TRACE_SINK_BYTES - offset)
+    bytes = TRACE_SINK_BYTES - offset;
+  if( bytes > max_bytes)
+    bytes = max_bytes;
+
+  UINT written = 0;
+  FRESULT fresult = f_write( &trace_file, sink + offset, bytes, &written);
+  tail += written;
+  trace_sink_statistics.written_bytes += written;
+  return ( fresult == FR_OK) && ( written == bytes);
+}
+
+static void report_drops( void)
+{
+  trace_sink_statistics.recorder_dropped_events = DroppedEventCounter;
+  uint32_t drops = trace_sink_statistics.dropped_pages + DroppedEventCounter;
+  if( drops == drops_reported)
+    return;
+  drops_reported = drops;
+  vTracePrintF( sink_channel, "%d pages dropped, %d events dropped",
+		(int)trace_sink_statistics.dropped_pages, (int)DroppedEventCounter);
+}
+
+static void close_file( void)
+{
+  vTraceStop();
+  accepting = false;
+  (void) f_close( &trace_file);
+  file_open = false;
+}
+
+//!< log file name with the extension replaced by ".psf"
+static bool make_file_name( const char * log_file_name, char * name)
+{
+  const char * extension = strrchr( log_file_name, '.');
+  unsigned length = extension ? extension - log_file_name : strlen( log_file_name);
+  if( length + sizeof( ".psf") > sizeof( file_name))
+    return false;
+  memcpy( name, log_file_name, length);
+  strcpy( name + length, ".psf");
+  return true;
+}
+
+bool trace_sink_open( const char * log_file_name)
+{
+  acquire_privileges();
+  file_open = make_file_name( log_file_name, file_name)
+      && ( f_open( &trace_file, file_name, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+  if( file_open)
+    {
+      tail = head;
+      accepting = true;
+      if( sink_channel == 0)
+	sink_channel = xTraceRegisterString( "#SD sink");
+      vTraceEnable( TRC_START); // header and symbol table first
+    }
+  bool result = file_open;
+  drop_privileges();
+  return result;
+}
+
+void trace_sink_flush( void)
+{
+  acquire_privileges();
+  if( file_open && ( head - tail >= TRACE_SINK_CHUNK_BYTES))
+    {
+      if( write_chunk( TRACE_SINK_CHUNK_BYTES))
+	report_drops();
+      else
+	close_file(); // give up, the log file has priority
+    }
+  drop_privileges();
+}
+
+void trace_sink_rename( const char * log_file_name)
+{
+  char new_name[sizeof( file_name)];
+  acquire_privileges();
+  if( not file_open || not make_file_name( log_file_name, new_name))
+    {
+      drop_privileges();
+      return;
+    }
+
+  // FatFs renames closed files only
+  FSIZE_t position = f_tell( &trace_file);
+  if( ( f_close( &trace_file) == FR_OK) && ( f_rename( file_name, new_name) == FR_OK))
+    strcpy( file_name, new_name);
+  if( ( f_open( &trace_file, file_name, FA_WRITE | FA_OPEN_EXISTING) != FR_OK)
+      || ( f_lseek( &trace_file, position) != FR_OK))
+    {
+      vTraceStop();
+      accepting = false;
+      file_open = false;
+    }
+  drop_privileges();
+}
+
+void trace_sink_close( void)
+{
+  acquire_privileges();
+  if( file_open)
+    {
+      vTraceStop();
+      accepting = false;
+      while( ( head != tail) && write_chunk( TRACE_SINK_CHUNK_BYTES))
+	;
+      close_file();
+    }
+  drop_privileges();
+}
+
+#endif
@@ -0,0 +1,86 @@
+/** *****************************************************************************
+ * @file    	trace_stream_sink.h
+ * @brief   	streaming trace: RAM sink between the trace recorder and the uSD card
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef TRACE_STREAM_SINK_H_
+#define TRACE_STREAM_SINK_H_
+
+#include "system_configuration.h"
+#include "FreeRTOS.h"
+
+/* With TRACE_STREAMING_TO_SD (FreeRTOSConfig.h) the trace recorder runs in
+ * streaming mode. Its low priority TzCtrl task hands over full pages of
+ * trace data, they are copied into this sink. The uSD task writes at most
+ * TRACE_SINK_CHUNK_BYTES per cycle into a .psf file next to the log file,
+ * to be opened with Tracealyzer. A page not fitting into the sink is
+ * dropped and counted, the drops are reported into the trace on the
+ * "#SD sink" channel. The recorder starts with the file and stops when it
+ * is closed.
+ */
+
+typedef struct
+{
+  uint32_t accepted_bytes;
+  uint32_t written_bytes;
+  uint32_t dropped_pages;	//!< sink full, uSD card too slow
+  uint32_t dropped_bytes;
+  uint32_t recorder_dropped_events; //!< paged buffer full, TzCtrl task starved
+} trace_sink_statistics_t;
+
+#if TRACE_STREAMING_TO_SD
+
+extern trace_sink_statistics_t trace_sink_statistics;
+
+// called by the unprivileged uSD task
+
+//! create the .psf file named after the log file and start the recorder
+bool trace_sink_open( const char * log_file_name);
+
+//! write one chunk if available, the trace is closed on write errors
+void trace_sink_flush( void);
+
+//! follow the log file renamed at the first GNSS fix
+void trace_sink_rename( const char * log_file_name);
+
+//! stop the recorder, write the remaining data and close the file
+void trace_sink_close( void);
+
+#else
+
+inline bool trace_sink_open( const char *)
+{
+  return false;
+}
+inline void trace_sink_flush( void)
+{
+}
+inline void trace_sink_rename( const char *)
+{
+}
+inline void trace_sink_close( void)
+{
+}
+
+#endif
+
+#endif /* TRACE_STREAM_SINK_H_ */
@@ -38,10 +38,15 @@
 #include "uSD_handler.h"
 #include "watchdog_handler.h"
 #include "magnetic_induction_report.h"
+#include "trace_stream_sink.h"
 #include "persistent_data_file.h"
 #include "system_state.h"
 #include "reminder_flag.h"
 #include "uSD_helpers.h"
+#include "log_file_recovery.h"
+#include "black_box.h"
+#include "warm_restart.h"
+#include "string.h"
 
 COMMON reminder_flag perform_after_landing_actions;
 
@@ -57,9 +62,62 @@ extern uint64_t FAT_time; //!< DOS FAT time for file usage
 
 extern RestrictedTask uSD_handler_task;
 
+//!< log file name after the present GNSS time
+static void name_file_by_GNSS_time( char * out_filename)
+{
+  char * next = out_filename;
+  append_string( next, "logger/");
+  next = format_date_time( next, coordinates);
+  append_string( next, ".lrsx");
+}
+
+//!< the EEPROM dump is named like its log file: "logger/x.lrsx" -> "eeprom/x.EEPROM"
+static void EEPROM_dump_name( char * out_filename, const char * log_filename, bool with_extension)
+{
+  char * next = out_filename;
+  append_string( next, "eeprom/");
+  append_string( next, log_filename + sizeof( "logger/") - 1);
+  next -= sizeof( ".lrsx") - 1;
+  *next = 0;
+  if( with_extension)
+    append_string( next, ".EEPROM");
+}
+
+//!< write the EEPROM dump belonging to a log file, before logging into the file
+static void write_EEPROM_dump_for_log_file( const char * log_filename)
+{
+  FILINFO filinfo;
+  FRESULT fresult = f_stat("eeprom", &filinfo);
+  if( (fresult != FR_OK) || ((filinfo.fattrib & AM_DIR)!=0))
+    {
+      char dump_filename[40];
+      EEPROM_dump_name( dump_filename, log_filename, false);
+      acquire_privileges(); //reading sensitive flash sections
+      write_EEPROM_dump( dump_filename);
+      drop_privileges();
+    }
+}
+
+//!< log file name used until the first GNSS fix, kept if there is none
+static void fallback_log_file_name( char * out_filename)
+{
+  FILINFO filinfo;
+  for( unsigned number = 0; number < 10000; ++number)
+    {
+      char * next = out_filename;
+      append_string( next, "logger/nofix_");
+      format_2_digits( next, number / 100);
+      format_2_digits( next, number % 100);
+      append_string( next, ".lrsx");
+      if( f_stat( out_filename, &filinfo) != FR_OK)
+	return;
+    }
+}
+
 //!< this executable takes care of all uSD reading and writing
 void uSD_handler_runnable (void*)
 {
+  unsigned insertion_delay = 0; // at power-up the card has been supplied already
 restart:
 
   HAL_SD_DeInit (&hsd);
@@ -78,7 +136,8 @@ restart:
 	}
     }
 
-  delay(500); // ensure that there is some wait time after inserting a sd-card
+  delay( insertion_delay); // ensure that there is some wait time after inserting a sd-card
+  insertion_delay = 500;
   HAL_StatusTypeDef hresult = HAL_SD_Init (&hsd);
   if( hresult != HAL_OK)
     goto restart;
@@ -131,10 +190,17 @@ restart:
 
   (void) ensure_EEPROM_parameter_integrity();
 
+  // the configuration in effect, rename it to larus_sensor_config.ini to program another sensor
+  (void) write_configuration_file( "larus_sensor_config.ini.current");
+
+  prepare_EEPROM_dump(); // the program checksum takes its time, logging must not wait for it
+
   drop_privileges(); // go protected
 
   watchdog_activator.signal(); // now start the watchdog
 
+  flex_file.start_capture(); // keep the data from the first record on
+
   setup_file_handling_completed.signal();
 
   delay( 100); // give communicator a moment to initialize
@@ -148,45 +214,40 @@ restart:
   FILINFO filinfo;
   fresult = f_stat("logger", &filinfo);
   if( (fresult != FR_OK) || ((filinfo.fattrib & AM_DIR)==0))
-    while( 1)
+    {
+      flex_file.close(); // no logging: stop capturing
+      while( 1)
 	{
 	notify_take (true); // wait for synchronization by crash detection
 	if( crashfile && ! user_initiated_reset)
 	  write_crash_dump();
 	}
+    }
 
-  char out_filename[30];
+  // a log file left open by a power loss: cut it behind its last intact checkpoint
+  log_record_framing_t framing;
+  log_recovery_result_t recovery;
+  if( flex_file.get_record_framing( framing))
+    (void) recover_unclosed_log_file( LOG_OPEN_MARKER, framing, recovery);
+  flex_file.set_open_marker( LOG_OPEN_MARKER);
 
-  // wait until a GNSS timestamp is available.
-  while ( coordinates.sat_fix_type == 0)
-    {
-      if( crashfile && ! user_initiated_reset)
-	  write_crash_dump();
-      delay (100);
-    }
+  char out_filename[30];
+  char fixed_filename[30];
 
   // repeat writing log files for all successive flights
   while(true)
     {
-      // generate filename based on timestamp
-      char * next = out_filename;
-
-      fresult = f_stat("eeprom", &filinfo);
-      if( (fresult != FR_OK) || ((filinfo.fattrib & AM_DIR)!=0))
-	{
-	  append_string( next, "eeprom/");
-	  next = format_date_time( next, coordinates);
-	  acquire_privileges(); //reading sensitive flash sections
-	  write_EEPROM_dump( out_filename); // now we have date+time, start logging
-	  drop_privileges();
-	}
-
-      next = out_filename;
-      append_string( next, "logger/");
-      next = format_date_time( next, coordinates);
-      append_string( next, ".lrsx");
+      // without GNSS timestamp: log from power-on anyway, rename the file at the first fix
+      bool named_by_time = ( coordinates.sat_fix_type != 0);
+      if( named_by_time)
+	name_file_by_GNSS_time( out_filename);
+      else
+	fallback_log_file_name( out_filename);
+      write_EEPROM_dump_for_log_file( out_filename); // not within the logging loop: it takes some 10 ms
 
       bool success = flex_file.open(out_filename);
+      if( success)
+	(void) trace_sink_open( out_filename); // optional, see FreeRTOSConfig.h
       if ( not success)
 	{
 	  while( true)
@@ -205,17 +266,21 @@ restart:
 
 	  if( crashfile && ! user_initiated_reset)
 	    {
+	      trace_sink_close();
 	      flex_file.close();
 	      write_crash_dump();
 	    }
 
 	  HAL_GPIO_WritePin (LED_STATUS1_GPIO_Port, LED_STATUS2_Pin, GPIO_PIN_SET);
 	  success = flex_file.flush_buffer();
-	  success &= flex_file.sync_file();
+	  success &= flex_file.sync_file_if_due();
+	  if( success)
+	    trace_sink_flush(); // bounded: one chunk per cycle at most
 	  HAL_GPIO_WritePin (LED_STATUS1_GPIO_Port, LED_STATUS2_Pin, GPIO_PIN_RESET);
 
 	  if( not success)
 	      {
+	      trace_sink_close();
 	      flex_file.close(); // at least: try to ...
 
 	      HAL_GPIO_WritePin (LED_STATUS1_GPIO_Port, LED_STATUS2_Pin, GPIO_PIN_RESET);
@@ -227,9 +292,26 @@ restart:
 		}
 	      }
 
+	  // first fix: renaming only, the ring bridges LOG_SD_STALL_BUDGET_MS, see Host_Tools/log_file_benchmark -F
+	  if( not named_by_time && ( coordinates.sat_fix_type != 0))
+	    {
+	      name_file_by_GNSS_time( fixed_filename);
+	      if( flex_file.rename( fixed_filename)) // the fallback name is kept on failure
+		{
+		  char old_dump_filename[40], new_dump_filename[40];
+		  EEPROM_dump_name( old_dump_filename, out_filename, true);
+		  EEPROM_dump_name( new_dump_filename, fixed_filename, true);
+		  (void) f_rename( old_dump_filename, new_dump_filename);
+		  strcpy( out_filename, fixed_filename);
+		}
+	      trace_sink_rename( out_filename);
+	      named_by_time = true;
+	    }
+
 	  if( perform_after_landing_actions.test_and_reset())
 	    {
 	      flex_file.block_input(); // avoid buffer overrun
+	      trace_sink_close();
 	      flex_file.close();
 
 	      delay(250); // just to be sure everything is written
@@ -265,6 +347,8 @@ void sync_logger(void)
 extern "C" void emergency_write_crashdump( char * file, int line)
   {
   acquire_privileges();
+  black_box.freeze();
+  prepare_watchdog_reset();
   crashfile=file;
   crashline=line;
   extern void * pxCurrentTCB;
@@ -302,6 +386,7 @@ RestrictedTask amok_running_task_killer( kill_amok_running_task, "ANTI_AMOK", co
 //!< this function is called in exception context
 extern "C" void finish_crash_handling( void)
 {
+  black_box.freeze(); // keep the data up to the event
   extern void * pxCurrentTCB;
   register_dump.active_TCB = pxCurrentTCB;
 
@@ -317,6 +402,8 @@ extern "C" void finish_crash_handling( void)
 //!< this function is called if the watchdog has been woken up
 extern "C" void handle_watchdog_trigger( void)
 {
+  black_box.freeze(); // keep the data up to the event
+  prepare_watchdog_reset();
   extern void * pxCurrentTCB;
   register_dump.active_TCB = pxCurrentTCB;
 
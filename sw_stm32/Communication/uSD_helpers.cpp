@@ -29,12 +29,16 @@
 #include "common.h"
 #include "ascii_support.h"
 #include "SHA256.h"
+#include "stm32_crc.h"
+#include "boot_slots.h"
 #include "GNSS.h"
 #include "persistent_data_file.h"
+#include "EEPROM_data_file_implementation.h"
 #include "flexible_log_file_implementation.h"
 #include "communicator.h"
 #include "system_state.h"
 #include "uSD_helpers.h"
+#include "crash_minidump.h"
 
 COMMON char *crashfile;
 COMMON unsigned crashline;
@@ -42,15 +46,28 @@ COMMON unsigned crashline;
 ROM uint8_t SHA_INITIALIZATION[] = "presently a well-known string";
 
 void sync_logger(void);
+uint64_t getTime_usec(void);
 extern  uint32_t UNIQUE_ID[4];
 extern SD_HandleTypeDef hsd;
 
-#define MEM_BUFSIZE 4096 // bytes
 COMMON uint8_t __ALIGNED(16) mem_buffer[MEM_BUFSIZE];
+
+// the log ring must bridge the longest uSD write stall plus one slot being written,
+// at boot it holds the data logged until the file is open
+#define LOG_RING_MS ( LOG_SD_STALL_BUDGET_MS > LOG_PRETRIGGER_MS ? LOG_SD_STALL_BUDGET_MS : LOG_PRETRIGGER_MS)
+#define LOG_RING_BYTES ( LOG_RING_MS * LOG_DATA_RATE_BYTES_PER_SECOND / 1000 + 2 * LOG_SLOT_SIZE_BYTES)
+#define LOG_SPILL_SLOTS ( LOG_RING_BYTES > MEM_BUFSIZE ? ( LOG_RING_BYTES - MEM_BUFSIZE + LOG_SLOT_SIZE_BYTES - 1) / LOG_SLOT_SIZE_BYTES : 0)
+#define LOG_SPILL_BUFSIZE ( LOG_SPILL_SLOTS * LOG_SLOT_SIZE_BYTES)
+
+COMMON uint32_t __ALIGNED(16) log_spill_buffer[ LOG_SPILL_BUFSIZE / sizeof( uint32_t) + 1];
+
 COMMON flexible_log_file_implementation_t flex_file(
     (uint32_t *)mem_buffer,
     MEM_BUFSIZE / sizeof( uint32_t),
-    sync_logger
+    sync_logger,
+    LOG_SLOT_SIZE_BYTES / sizeof( uint32_t),
+    log_spill_buffer,
+    LOG_SPILL_BUFSIZE / sizeof( uint32_t)
     );
 
 bool write_block( uint32_t * begin, uint32_t size_words)
@@ -90,6 +107,16 @@ void write_crash_dump( void)
   vTraceStop(); // don't trace ourselves ...
 #endif
 
+  // the complete picture: registers, all tasks and stacks, queues, log tail, system state
+  // mem_buffer still holds log data, so the name goes elsewhere
+  char minidump_name[32];
+  next = format_date_time( minidump_name, coordinates);
+  append_string (next, ".MINIDUMP");
+  (void) write_crash_minidump( minidump_name);
+
+  delay( 100);
+
+  // summary for a quick look, decode the minidump with scripts/decode_minidump.py
   next = format_date_time( buffer, coordinates);
   append_string (next, ".CRASHDUMP");
 
@@ -101,39 +128,19 @@ void write_crash_dump( void)
   append_string( next, (char*)"Firmware: ");
   append_string( next, GIT_TAG_INFO);
   newline( next);
-
-  f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  next = buffer;
   append_string( next, (char*)"Hardware: ");
   utox( next, UNIQUE_ID[0], 8);
   newline( next);
-
-  f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  next = buffer;
   append_string( next, crashfile);
   append_string( next, (char*)" Line: ");
   next = my_itoa( next, crashline);
   newline( next);
-
-  f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  next = buffer;
   append_string( next, (char*)"Task:     ");
   append_string( next, pcTaskGetName( (TaskHandle_t)(register_dump.active_TCB)));
   newline( next);
-
-  f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  next = buffer;
   append_string( next, (char*)"IPSR:     ");
   utox( next, register_dump.IPSR);
   newline( next);
-
-  f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  next = buffer;
   append_string( next, (char*)"PC:       ");
   utox( next, register_dump.stacked_pc);
   newline( next);
@@ -142,69 +149,13 @@ void write_crash_dump( void)
   newline( next);
 
   f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  next = buffer;
-  append_string( next, (char*)"BusFA:    ");
-  utox(  next, register_dump.Bus_Fault_Address);
-  newline( next);
-
-  f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  next = buffer;
-  append_string( next, (char*)"MemA:     ");
-  utox( next, register_dump.Bad_Memory_Address);
-  newline( next);
-
-  append_string( next, (char*)"MemFS:    ");
-  utox( next, register_dump.Memory_Fault_status);
-  newline( next);
-
-  f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  next = buffer;
-  append_string( next, (char*)"FPU_S:    ");
-  utox( next, register_dump.FPU_StatusControlRegister);
-  newline( next);
-
-  append_string( next, (char*)"UsgFS:    ");
-  utox( next, register_dump.Usage_Fault_Status_Register);
-  newline( next);
-
-  f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  next = buffer;
-  append_string( next, (char*)"HardFS:   ");
-  utox( next, register_dump.Hard_Fault_Status);
-  newline( next);
-
-  f_write (&fp, buffer, next-buffer, &writtenBytes);
-
-  for( unsigned i=0; i<32; ++i)
-    {
-
-    // only if the dump is populated
-      if( FPU_register_dump[i] != 0x00)
-	{
-	  next = buffer;
-	  append_string( next, (char*)"FPU dump:");
-	  newline( next);
-
-	  for( unsigned i=0; i<32; ++i)
-	    {
-	      utox( next, FPU_register_dump[i]);
-	      newline( next);
-	    }
-	  f_write (&fp, buffer, next-buffer, &writtenBytes);
-	  break;
-	}
-    }
   fresult = f_close(&fp);
   if (fresult != FR_OK)
     goto emergency_exit;
 
   delay( 100);
 
-#if configUSE_TRACE_FACILITY // ************************************************
+#if configUSE_TRACE_FACILITY && ! TRACE_STREAMING_TO_SD // *********************
 
 extern RecorderDataType myTraceBuffer;
 
@@ -233,22 +184,6 @@ extern RecorderDataType myTraceBuffer;
 
 #endif // ************************************************************************
 
-  // log one complete set of output data independent of data logging status
-  next = format_date_time( buffer, coordinates);
-  *next++ = '.';
-  *next++  = 'f';
-  format_2_digits( next, sizeof( state_vector_t) / sizeof(float));
-
-  fresult = f_open ( &fp, buffer, FA_CREATE_ALWAYS | FA_WRITE);
-  if (fresult != FR_OK)
-    goto emergency_exit;
-
-  fresult = f_write (&fp, (uint8_t*) &observations, sizeof( observations), &writtenBytes);
-  fresult = f_write (&fp, (uint8_t*) &coordinates,  sizeof( coordinates), &writtenBytes);
-  fresult = f_write (&fp, (uint8_t*) &system_state, sizeof( system_state), &writtenBytes);
-  fresult = f_write (&fp, (uint8_t*) &state_vector,  sizeof( state_vector), &writtenBytes);
-  f_close( &fp);
-
 emergency_exit:
   f_mount ( 0, "", 0); // unmount uSD
   delay( 100);
@@ -259,6 +194,28 @@ emergency_exit:
     /* wake watchdog */;
 }
 
+COMMON static uint8_t program_digest[32];
+COMMON static bool program_digest_valid;
+
+void prepare_EEPROM_dump( void)
+{
+  SHA256 sha;
+  sha.update( SHA_INITIALIZATION, sizeof( SHA_INITIALIZATION));
+
+  extern uint8_t * __fini_array_end;
+  unsigned block_size = 1024;
+  for( uint8_t * block_start = (uint8_t *)g_pfnVectors;  block_start < __fini_array_end; block_start += block_size)
+    {
+      uint8_t * block_end = block_start + block_size;
+      if( block_end > __fini_array_end)
+	block_end = __fini_array_end;
+      sha.update( block_start, block_end - block_start);
+      delay(1); // beware of our watchdog !
+    }
+  sha.make_digest( program_digest);
+  program_digest_valid = true;
+}
+
 bool write_EEPROM_dump( const char * file_path)
 {
   FRESULT fresult;
@@ -268,6 +225,10 @@ bool write_EEPROM_dump( const char * file_path)
   SHA256 sha;
   int32_t writtenBytes = 0;
 
+  if( not program_digest_valid)
+    prepare_EEPROM_dump();
+  const uint8_t * digest = program_digest;
+
   append_string (next, file_path);
   append_string (next, ".EEPROM");
 
@@ -277,24 +238,6 @@ bool write_EEPROM_dump( const char * file_path)
 
   sha.update( SHA_INITIALIZATION, sizeof( SHA_INITIALIZATION));
 
-  extern uint8_t * __fini_array_end;
-  unsigned block_size = 1024;
-  for( uint8_t * block_start = (uint8_t *)0x08000000;  block_start < __fini_array_end; block_start += block_size)
-    {
-      uint8_t * block_end = block_start + block_size;
-      if( block_end > __fini_array_end)
-	block_end = __fini_array_end;
-      sha.update( block_start, block_end - block_start);
-      delay(1); // beware of our watchdog !
-    }
-  uint8_t digest[32];
-  sha.make_digest(digest);
-
-  delay(1); // watchdog ...
-
-  sha.reset();
-  sha.update( SHA_INITIALIZATION, sizeof( SHA_INITIALIZATION));
-
   newline(next); // first line = my filename (incl. time)
   append_string( next, "SHA256(Flash Program) = \r\n");
 
@@ -354,7 +297,7 @@ bool write_EEPROM_dump( const char * file_path)
 
   float32_t mag_calib_param[4*3];
 
-  if( permanent_data_file.retrieve_data( MAG_SENSOR_XFER_MATRIX, 4*3, (uint32_t *)mag_calib_param))
+  if( read_blob( MAG_SENSOR_XFER_MATRIX, 4*3, mag_calib_param))
     {
       for( unsigned i=0; i< 4*3; ++i)
 	{
@@ -374,7 +317,7 @@ bool write_EEPROM_dump( const char * file_path)
 	}
     }
 
-  if( permanent_data_file.retrieve_data( EXT_MAG_SENSOR_XFER_MATRIX, 4*3, (uint32_t *)mag_calib_param))
+  if( read_blob( EXT_MAG_SENSOR_XFER_MATRIX, 4*3, mag_calib_param))
     {
       for( unsigned i=0; i< 4*3; ++i)
 	{
@@ -425,6 +368,608 @@ bool write_EEPROM_dump( const char * file_path)
   return fresult;
 }
 
+// software image layout as produced by scripts/pack.py, 32-bit words
+#define IMAGE_MAGIC_NUMBER	0x1c8073ab20853579ULL
+#define IMAGE_CRC		2 // stm32_crc() from IMAGE_META_DATA_VERSION up to the end
+#define IMAGE_META_DATA_VERSION	3
+#define IMAGE_STORAGE_ADDRESS	4
+#define IMAGE_NEW_APP		8
+#define IMAGE_NEW_APP_LENGTH	9
+
+#define UPDATE_STORAGE_ADDRESS	0x08060000 // flash sectors 7 - 9, BOOT_SLOT_B_ADDRESS with the boot selector
+#define UPDATE_STORAGE_BYTES	0x60000
+#define UPDATE_BLOCK_BYTES	( MEM_BUFSIZE / 2) // one half of mem_buffer is read while the other one is programmed
+
+typedef struct
+{
+  const uint32_t * data;
+  uint32_t address;
+  uint32_t words;
+} flash_program_request_t;
+
+COMMON Queue <flash_program_request_t> flash_program_request( 1);
+COMMON Queue <bool> flash_program_result( 1);
+
+//! flash session shared with the EEPROM writer, which may be erasing one of its sectors
+static bool begin_update_flash_session( void)
+{
+  if( not begin_flash_session( MAXIMUM_PAGE_ERASE_TIME + FLASH_ERASE_TIMEOUT))
+    return false;
+
+  // for an unknown reason error flags need to be reset
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP);
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPERR);
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_WRPERR);
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_PGAERR);
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_PGPERR);
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_PGSERR);
+  return true;
+}
+
+//! programs the blocks handed over by read_software_update() while it reads the next block
+static void flash_programmer_runnable( void *)
+{
+  flash_program_request_t request;
+  while( true)
+    {
+      flash_program_request.receive( request);
+      bool success = begin_update_flash_session();
+      if( success)
+	{
+	  for( uint32_t i = 0; success && ( i < request.words); ++i)
+	    success = HAL_OK == HAL_FLASH_Program( TYPEPROGRAM_WORD,
+						   request.address + i * sizeof( uint32_t),
+						   (uint64_t) request.data[i]);
+	  end_flash_session();
+	}
+      flash_program_result.send( success);
+    }
+}
+
+#define PROGRAMMER_STACKSIZE 128
+static uint32_t __ALIGNED(PROGRAMMER_STACKSIZE*sizeof(uint32_t)) flash_programmer_stack[PROGRAMMER_STACKSIZE];
+
+// below the uSD task, so programming runs while the uSD task waits for the DMA
+static TaskParameters_t flash_programmer_parameters =
+{
+  flash_programmer_runnable,
+  "FW_PROG",
+  PROGRAMMER_STACKSIZE,
+  0,
+  FLASH_PROGRAMMER_PRIORITY + portPRIVILEGE_BIT,
+  flash_programmer_stack,
+    {
+      { COMMON_BLOCK, COMMON_SIZE, portMPU_REGION_READ_WRITE },
+      { 0, 0, 0},
+      { 0, 0, 0}
+    }
+};
+
+static RestrictedTask flash_programmer_task( flash_programmer_parameters);
+
+//! erase the update storage or boot slot A
+static bool erase_update_storage( uint32_t destination)
+{
+  uint32_t SectorError = 0;
+  FLASH_EraseInitTypeDef pEraseInit;
+  pEraseInit.TypeErase = FLASH_TYPEERASE_SECTORS;
+  pEraseInit.NbSectors = 1;
+  pEraseInit.VoltageRange = VOLTAGE_RANGE_3;
+
+  uint32_t first_sector = ( destination == BOOT_SLOT_A_ADDRESS) ? FLASH_SECTOR_1 : FLASH_SECTOR_7;
+  uint32_t last_sector  = ( destination == BOOT_SLOT_A_ADDRESS) ? FLASH_SECTOR_6 : FLASH_SECTOR_9;
+
+  for( uint32_t sector = first_sector; sector <= last_sector; ++sector)
+    {
+      // one session per sector, EEPROM writes may go in between
+      if( not begin_update_flash_session())
+	return false;
+      pEraseInit.Sector = sector;
+      unsigned status = HAL_FLASHEx_Erase (&pEraseInit, &SectorError);
+      end_flash_session();
+      if ((status != HAL_OK) || (SectorError != 0xffffffff))
+	return false;
+    }
+  return true;
+}
+
+/*! \brief check the programmed image against its CRC, then make it valid by programming the header
+ *
+ *  For boot slots the sequence number is programmed in between, it is not covered by the CRC.
+ */
+static bool commit_update_image( const uint32_t * header, uint32_t destination,
+				 uint32_t image_bytes, uint32_t image_crc, uint32_t sequence)
+{
+  bool programmed = true;
+
+  if( image_crc != stm32_crc( STM32_CRC_INIT, (uint32_t*) destination + IMAGE_META_DATA_VERSION,
+			      image_bytes / sizeof( uint32_t) - IMAGE_META_DATA_VERSION))
+    return false;
+
+  if( sequence != BOOT_SLOT_ERASED)
+    {
+      flash_program_request_t request = { &sequence, destination + BOOT_SLOT_SEQUENCE * sizeof( uint32_t), 1 };
+      flash_program_request.send( request);
+      flash_program_result.receive( programmed);
+    }
+  if( not programmed)
+    return false;
+
+  flash_program_request_t request = { header, destination, IMAGE_META_DATA_VERSION };
+  flash_program_request.send( request);
+  flash_program_result.receive( programmed);
+  return programmed;
+}
+
+//! pass one: stream the image and check size and CRC without touching the flash
+static bool verify_update_image( FIL &the_file, uint32_t &image_bytes, uint32_t &image_crc)
+{
+  UINT bytes_read;
+  uint32_t *header = (uint32_t*) mem_buffer;
+
+  FRESULT fresult = f_read (&the_file, mem_buffer, MEM_BUFSIZE, &bytes_read);
+  if ((fresult != FR_OK) || (bytes_read < MEM_BUFSIZE))
+    return false;
+
+  if( header[IMAGE_NEW_APP] < header[IMAGE_STORAGE_ADDRESS] + MEM_BUFSIZE)
+    return false;
+  image_bytes = header[IMAGE_NEW_APP] - header[IMAGE_STORAGE_ADDRESS];
+  if( ( image_bytes > UPDATE_STORAGE_BYTES) || ( header[IMAGE_NEW_APP_LENGTH] > UPDATE_STORAGE_BYTES - image_bytes))
+    return false;
+  image_bytes += header[IMAGE_NEW_APP_LENGTH];
+  if( ( image_bytes % sizeof( uint32_t) != 0) || ( image_bytes != f_size( &the_file)))
+    return false;
+
+  image_crc = header[IMAGE_CRC];
+  uint32_t crc = stm32_crc( STM32_CRC_INIT, header + IMAGE_META_DATA_VERSION,
+			    MEM_BUFSIZE / sizeof( uint32_t) - IMAGE_META_DATA_VERSION);
+  uint32_t bytes_verified = MEM_BUFSIZE;
+
+  while( bytes_verified < image_bytes)
+    {
+      fresult = f_read (&the_file, mem_buffer, MEM_BUFSIZE, &bytes_read);
+      if ((fresult != FR_OK) || (bytes_read == 0))
+	return false;
+      crc = stm32_crc( crc, (uint32_t*) mem_buffer, bytes_read / sizeof( uint32_t));
+      bytes_verified += bytes_read;
+    }
+
+  return ( bytes_verified == image_bytes) && ( crc == image_crc);
+}
+
+/*! \brief pass one for boot slot images
+ *
+ *  The file holds the image for slot A followed by the image for slot B,
+ *  each one exactly as it is programmed into its slot.
+ */
+static bool verify_slot_image( FIL &the_file, uint32_t slot,
+			       uint32_t &image_offset, uint32_t &image_bytes, uint32_t &image_crc)
+{
+  UINT bytes_read;
+  FRESULT fresult;
+  uint32_t *header = (uint32_t*) mem_buffer;
+  image_offset = 0;
+
+  for( unsigned variant = 0; variant < 2; ++variant)
+    {
+      if( f_lseek (&the_file, image_offset) != FR_OK)
+	return false;
+      fresult = f_read (&the_file, mem_buffer, MEM_BUFSIZE, &bytes_read);
+      if ((fresult != FR_OK) || (bytes_read < MEM_BUFSIZE))
+	return false;
+
+      image_bytes = header[BOOT_SLOT_IMAGE_BYTES];
+      if( ( (header[0] | ((uint64_t) header[1] << 32)) != BOOT_SLOT_MAGIC_NUMBER)
+	  || ( header[BOOT_SLOT_HEADER_VERSION] != 1)
+	  || ( image_bytes < MEM_BUFSIZE) || ( image_bytes > BOOT_SLOT_BYTES)
+	  || ( image_bytes % sizeof( uint32_t) != 0)
+	  || ( image_bytes > f_size( &the_file) - image_offset))
+	return false;
+
+      if( header[BOOT_SLOT_LINK_ADDRESS] == slot)
+	break;
+
+      image_offset += image_bytes;
+      if( variant == 1)
+	return false; // no image for this slot
+    }
+
+  // the device programs the state words, they must be erased in the file
+  for( unsigned i = 0; i < BOOT_SLOT_STATE_WORDS; ++i)
+    if( header[BOOT_SLOT_SEQUENCE + i] != BOOT_SLOT_ERASED)
+      return false;
+
+  image_crc = header[BOOT_SLOT_CRC];
+  uint32_t crc = stm32_crc( STM32_CRC_INIT, header + IMAGE_META_DATA_VERSION,
+			    MEM_BUFSIZE / sizeof( uint32_t) - IMAGE_META_DATA_VERSION);
+  uint32_t bytes_verified = MEM_BUFSIZE;
+
+  while( bytes_verified < image_bytes)
+    {
+      uint32_t bytes_to_read = image_bytes - bytes_verified;
+      if( bytes_to_read > MEM_BUFSIZE)
+	bytes_to_read = MEM_BUFSIZE;
+      fresult = f_read (&the_file, mem_buffer, bytes_to_read, &bytes_read);
+      if ((fresult != FR_OK) || (bytes_read != bytes_to_read))
+	return false;
+      crc = stm32_crc( crc, (uint32_t*) mem_buffer, bytes_read / sizeof( uint32_t));
+      bytes_verified += bytes_read;
+    }
+
+  return crc == image_crc;
+}
+
+/*! \brief pass two: program a verified image with double-buffered reads
+ *
+ *  The magic number and the CRC are programmed last, only after the flash content
+ *  has been checked against the CRC. An interrupted update never looks like a valid image.
+ *  Reading starts at the current file position and stops after image_bytes.
+ */
+static bool program_update_image( FIL &the_file, uint32_t destination,
+				  uint32_t image_bytes, uint32_t image_crc, uint32_t sequence)
+{
+  const uint32_t *buffer[2] = { (uint32_t*) mem_buffer, (uint32_t*) (mem_buffer + UPDATE_BLOCK_BYTES) };
+  uint32_t header[IMAGE_META_DATA_VERSION];
+  unsigned active = 0;
+  uint32_t offset = 0;
+  uint32_t crc = STM32_CRC_INIT;
+  bool programmed;
+  UINT bytes_read;
+
+  if( not erase_update_storage( destination))
+    return false;
+
+  FRESULT fresult = f_read (&the_file, (void*) buffer[active], UPDATE_BLOCK_BYTES, &bytes_read);
+  if ((fresult != FR_OK) || (bytes_read < UPDATE_BLOCK_BYTES))
+    return false;
+
+  for( unsigned i = 0; i < IMAGE_META_DATA_VERSION; ++i)
+    header[i] = buffer[active][i];
+
+  while( bytes_read > 0)
+    {
+      uint32_t skip = ( offset == 0) ? IMAGE_META_DATA_VERSION : 0;
+      flash_program_request_t request =
+	{
+	  buffer[active] + skip,
+	  destination + offset + skip * sizeof( uint32_t),
+	  bytes_read / sizeof( uint32_t) - skip
+	};
+      flash_program_request.send( request);
+      crc = stm32_crc( crc, request.data, request.words);
+      offset += bytes_read;
+
+      active ^= 1;
+      uint32_t bytes_to_read = ( offset < image_bytes) ? image_bytes - offset : 0;
+      if( bytes_to_read > UPDATE_BLOCK_BYTES)
+	bytes_to_read = UPDATE_BLOCK_BYTES;
+      fresult = f_read (&the_file, (void*) buffer[active], bytes_to_read, &bytes_read);
+
+      flash_program_result.receive( programmed);
+      if( (fresult != FR_OK) || not programmed)
+	return false;
+    }
+
+  // the file must not have changed since pass one
+  if( ( offset != image_bytes) || ( crc != image_crc))
+    return false;
+
+  return commit_update_image( header, destination, image_bytes, image_crc, sequence);
+}
+
+/* Delta image as produced by scripts/pack.py --delta, 32-bit words.
+ * It rebuilds the complete software image from the installed application
+ * and literal data. Header fields at the same places as in a software image
+ * are used in the same way, so that the image search handles both kinds.
+ */
+#define DELTA_MAGIC_NUMBER	0x1c8073ab2085d17aULL
+#define DELTA_CRC		2 // stm32_crc() from DELTA_FORMAT_VERSION up to the end
+#define DELTA_FORMAT_VERSION	3
+#define DELTA_BASE_SW_VERSION	4 // installed software version required
+#define DELTA_BASE_BYTES	7 // length of the installed application covered by the hash
+#define DELTA_TARGET_BYTES	8 // software image to be rebuilt
+#define DELTA_TARGET_CRC	9
+#define DELTA_FILE_BYTES	10
+#define DELTA_BASE_SHA256	12 // 8 words
+#define DELTA_OPS		20
+
+#define DELTA_OP_MASK		0xc0000000
+#define DELTA_OP_COPY		0x40000000 // | words, followed by the source offset in the installed application
+#define DELTA_OP_ADD		0x80000000 // | words, followed by the literal words
+
+#define INSTALLED_APPLICATION	0x08000000
+#define INSTALLED_APPLICATION_BYTES 0x60000
+
+//! sequential word access to an image file with a running CRC
+class image_file_reader_t
+{
+public:
+  image_file_reader_t( FIL &_file)
+  : file( _file), crc( STM32_CRC_INIT), bytes( 0), position( 0), fill( 0)
+  {}
+
+  //! \return false at the end of the file or on read errors
+  bool get( uint32_t &word)
+  {
+    if( position == fill)
+      {
+	UINT bytes_read;
+	if( (f_read (&file, buffer, sizeof( buffer), &bytes_read) != FR_OK) || (bytes_read < sizeof( uint32_t)))
+	  return false;
+	fill = bytes_read / sizeof( uint32_t);
+	position = 0;
+      }
+    word = buffer[position++];
+    if( bytes >= IMAGE_META_DATA_VERSION * sizeof( uint32_t))
+      crc = stm32_crc( crc, &word, 1);
+    bytes += sizeof( uint32_t);
+    return true;
+  }
+
+  bool rewind( void)
+  {
+    crc = STM32_CRC_INIT;
+    bytes = position = fill = 0;
+    return f_lseek( &file, 0) == FR_OK;
+  }
+
+  uint32_t get_crc( void) const
+  {
+    return crc;
+  }
+  uint32_t get_bytes( void) const
+  {
+    return bytes;
+  }
+
+private:
+  FIL &file;
+  uint32_t crc;
+  uint32_t bytes;
+  unsigned position;
+  unsigned fill;
+  uint32_t __ALIGNED(4) buffer[128]; // one uSD sector
+};
+
+/*! \brief sink for the rebuilt software image
+ *
+ *  Without programming only the CRC is computed. When programming, the two halves
+ *  of mem_buffer are filled alternately while the other one is being programmed.
+ *  The header words are kept aside and programmed last by commit_update_image().
+ */
+class image_flash_writer_t
+{
+public:
+  image_flash_writer_t( bool _program)
+  : program( _program), failed( false), busy( false), active( 0), fill( 0),
+    block_start( 0), bytes( 0), crc( STM32_CRC_INIT)
+  {}
+
+  void put( uint32_t word)
+  {
+    if( bytes < IMAGE_META_DATA_VERSION * sizeof( uint32_t))
+      header[ bytes / sizeof( uint32_t)] = word;
+    else
+      crc = stm32_crc( crc, &word, 1);
+    bytes += sizeof( uint32_t);
+
+    if( not program)
+      return;
+    half( active)[fill++] = word;
+    if( fill == UPDATE_BLOCK_BYTES / sizeof( uint32_t))
+      hand_over();
+  }
+
+  //! \return false if programming failed
+  bool finish( void)
+  {
+    if( program && fill > 0)
+      hand_over();
+    wait_for_programmer();
+    return not failed;
+  }
+
+  uint32_t get_bytes( void) const
+  {
+    return bytes;
+  }
+  uint32_t get_crc( void) const
+  {
+    return crc;
+  }
+  const uint32_t * get_header( void) const
+  {
+    return header;
+  }
+
+private:
+  uint32_t * half( unsigned index)
+  {
+    return (uint32_t*) (mem_buffer + index * UPDATE_BLOCK_BYTES);
+  }
+
+  void wait_for_programmer( void)
+  {
+    bool programmed;
+    if( not busy)
+      return;
+    flash_program_result.receive( programmed);
+    busy = false;
+    failed |= not programmed;
+  }
+
+  void hand_over( void)
+  {
+    wait_for_programmer(); // for the other half
+    uint32_t skip = ( block_start == 0) ? IMAGE_META_DATA_VERSION : 0;
+    flash_program_request_t request =
+      {
+	half( active) + skip,
+	UPDATE_STORAGE_ADDRESS + block_start + skip * sizeof( uint32_t),
+	fill - skip
+      };
+    flash_program_request.send( request);
+    busy = true;
+    block_start += fill * sizeof( uint32_t);
+    active ^= 1;
+    fill = 0;
+  }
+
+  bool program;
+  bool failed;
+  bool busy;
+  unsigned active;
+  uint32_t fill;
+  uint32_t block_start;
+  uint32_t bytes;
+  uint32_t crc;
+  uint32_t header[IMAGE_META_DATA_VERSION];
+};
+
+/*! \brief rebuild the software image from a delta file
+ *
+ *  Pass one (program == false) checks the whole delta including the hash of the
+ *  installed application and the CRC of the result without touching the flash.
+ *  Pass two rebuilds the image into the update storage.
+ *  Legacy layout only: with the boot selector the update storage is slot B and
+ *  a slot image is linked for its slot, read_software_update() rejects deltas.
+ */
+static bool apply_delta_image( FIL &the_file, bool program, uint32_t &image_bytes, uint32_t &image_crc)
+{
+  uint32_t header[DELTA_OPS];
+  uint8_t digest[32];
+  image_file_reader_t reader( the_file);
+
+  for( unsigned i = 0; i < DELTA_OPS; ++i)
+    if( not reader.get( header[i]))
+      return false;
+
+  uint64_t magic_number = header[0] | ((uint64_t) header[1] << 32);
+  if( ( magic_number != DELTA_MAGIC_NUMBER) || ( header[DELTA_FORMAT_VERSION] != 1)
+      || ( header[DELTA_FILE_BYTES] != f_size( &the_file))
+      || ( header[DELTA_BASE_BYTES] > INSTALLED_APPLICATION_BYTES)
+      || ( header[DELTA_TARGET_BYTES] > UPDATE_STORAGE_BYTES)
+      || ( header[DELTA_TARGET_BYTES] < MEM_BUFSIZE))
+    return false;
+
+  // the delta is only good for exactly the installed application
+  SHA256 sha;
+  sha.update( (uint8_t*) INSTALLED_APPLICATION, header[DELTA_BASE_BYTES]);
+  sha.make_digest( digest);
+  if( memcmp( digest, header + DELTA_BASE_SHA256, sizeof( digest)) != 0)
+    return false;
+
+  image_bytes = header[DELTA_TARGET_BYTES];
+  image_crc = header[DELTA_TARGET_CRC];
+
+  if( program)
+    {
+      if( not erase_update_storage( UPDATE_STORAGE_ADDRESS))
+	return false;
+      if( not reader.rewind())
+	return false;
+      for( unsigned i = 0; i < DELTA_OPS; ++i)
+	if( not reader.get( header[i]))
+	  return false;
+    }
+
+  image_flash_writer_t writer( program);
+  uint32_t op, word;
+  bool delta_is_consistent = true;
+
+  while( delta_is_consistent && reader.get( op))
+    {
+      uint32_t words = op & ~DELTA_OP_MASK;
+      if( writer.get_bytes() + words * sizeof( uint32_t) > image_bytes)
+	{
+	  delta_is_consistent = false;
+	  break;
+	}
+
+      switch( op & DELTA_OP_MASK)
+      {
+	case DELTA_OP_COPY:
+	  {
+	    uint32_t source;
+	    if( ( not reader.get( source)) || ( source % sizeof( uint32_t) != 0)
+		|| ( source > header[DELTA_BASE_BYTES])
+		|| ( words > ( header[DELTA_BASE_BYTES] - source) / sizeof( uint32_t)))
+	      {
+		delta_is_consistent = false;
+		break;
+	      }
+	    const uint32_t *from = (const uint32_t*) (INSTALLED_APPLICATION + source);
+	    while( words--)
+	      writer.put( *from++);
+	  }
+	  break;
+	case DELTA_OP_ADD:
+	  while( words--)
+	    {
+	      if( not reader.get( word))
+		{
+		  delta_is_consistent = false;
+		  break;
+		}
+	      writer.put( word);
+	    }
+	  break;
+	default:
+	  delta_is_consistent = false;
+	  break;
+      }
+    }
+
+  if( not writer.finish() || not delta_is_consistent)
+    return false;
+
+  if( ( reader.get_bytes() != header[DELTA_FILE_BYTES]) || ( reader.get_crc() != header[DELTA_CRC])
+      || ( writer.get_bytes() != image_bytes) || ( writer.get_crc() != image_crc)
+      || ( writer.get_header()[0] != (uint32_t) IMAGE_MAGIC_NUMBER)
+      || ( writer.get_header()[1] != (uint32_t) (IMAGE_MAGIC_NUMBER >> 32))
+      || ( writer.get_header()[IMAGE_CRC] != image_crc))
+    return false;
+
+  if( not program)
+    return true;
+
+  return commit_update_image( writer.get_header(), UPDATE_STORAGE_ADDRESS, image_bytes, image_crc, BOOT_SLOT_ERASED);
+}
+
+//! record the outcome of a software update attempt on the uSD card
+static void write_update_report( const char * image_name, const char * result,
+				 uint32_t image_bytes, uint64_t verify_usec, uint64_t program_usec)
+{
+  FIL fp;
+  UINT writtenBytes;
+  char buffer[200];
+  char *next = buffer;
+
+  append_string( next, "Image: ");
+  append_string( next, image_name);
+  newline( next);
+  append_string( next, "Result: ");
+  append_string( next, result);
+  newline( next);
+  append_string( next, "Size: ");
+  next = my_itoa( next, image_bytes);
+  append_string( next, " bytes");
+  newline( next);
+  append_string( next, "Verify: ");
+  next = my_itoa( next, (uint32_t)( verify_usec / 1000));
+  append_string( next, " ms");
+  newline( next);
+  append_string( next, "Program: ");
+  next = my_itoa( next, (uint32_t)( program_usec / 1000));
+  append_string( next, " ms");
+  newline( next);
+
+  if( f_open (&fp, "larus_update_report.txt", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+    return;
+  f_write (&fp, buffer, next-buffer, &writtenBytes);
+  f_close (&fp);
+}
+
 //!< find software image file and load it if applicable
 bool read_software_update (void)
 {
@@ -436,12 +981,18 @@ bool read_software_update (void)
 
   uint32_t highest_sw_version_found = 0;
   char highest_sw_version_fname[_MAX_LFN + 1];
+  bool highest_sw_version_is_delta = false;
+  char rejected_delta_fname[_MAX_LFN + 1];
+  rejected_delta_fname[0] = rejected_delta_fname[_MAX_LFN] = 0;
+
+  // a new slot must prove its health before it may be replaced
+  if( boot_slot_on_trial())
+    return false;
 
-  uint32_t flash_address = 0x60000;
-  unsigned status;
-  bool last_block_read = false;
+  // with the boot selector only slot images fit, the legacy layout takes software images and deltas
+  uint32_t update_slot = inactive_boot_slot();
 
-  // find all *.bin files which could be software update images
+  // find all *.bin files which could be software update images or deltas
   fresult = f_findfirst (&dj, &fno, "", "????*.bin");
   if (fresult != FR_OK)
     return false;
@@ -468,18 +1019,33 @@ bool read_software_update (void)
 	  file_magic_number |= (uint64_t) mem_buffer[i];
 	}
 
-      if ((file_hw_version == 0x01010100)
-	  && (file_magic_number == 0x1c8073ab20853579))
+      // a delta can only be applied to the software version it has been made for
+      uint32_t file_base_sw_version = mem_buffer[19] | (mem_buffer[18] << 8)
+	  | (mem_buffer[17] << 16) | (mem_buffer[16] << 24);
+      bool file_is_delta = (file_magic_number == DELTA_MAGIC_NUMBER)
+	  && (file_base_sw_version == GIT_TAG_DEC);
+      bool file_fits_layout = (update_slot != 0) ?
+	  (file_magic_number == BOOT_SLOT_MAGIC_NUMBER) :
+	  ((file_magic_number == IMAGE_MAGIC_NUMBER) || file_is_delta);
+
+      // a delta patches the application at INSTALLED_APPLICATION, there is none with boot slots
+      if ((update_slot != 0) && (file_magic_number == DELTA_MAGIC_NUMBER))
+	for (int i = 0; i < _MAX_LFN; i++)
+	  rejected_delta_fname[i] = fno.fname[i];
+
+      if ((file_hw_version == 0x01010100) && file_fits_layout)
 	{
 	  // The files hw version is for the larus sensor and the larus magic number is correct.
 
 	  uint32_t file_sw_version = mem_buffer[27] | (mem_buffer[26] << 8)
 	      | (mem_buffer[25] << 16) | (mem_buffer[24] << 24);
-	  if (file_sw_version > highest_sw_version_found)
+	  if ((file_sw_version > highest_sw_version_found)
+	      || (file_is_delta && (file_sw_version == highest_sw_version_found)))
 	    {
 
-	      // Search for the highest version and copy filename
+	      // Search for the highest version and copy filename, prefer the delta
 	      highest_sw_version_found = file_sw_version;
+	      highest_sw_version_is_delta = file_is_delta;
 	      for (int i = 0; i < _MAX_LFN; i++)
 		{
 		  highest_sw_version_fname[i] = fno.fname[i];
@@ -492,12 +1058,35 @@ bool read_software_update (void)
 	break; // now more files found, break loop-
     }
 
+  // tell why nothing happens instead of ignoring the delta silently
+  if ((highest_sw_version_found == 0) && (rejected_delta_fname[0] != 0))
+    {
+      write_update_report( rejected_delta_fname, "delta rejected: boot slots need an _ab.bin image", 0, 0, 0);
+      return false;
+    }
+
 #if DISALLOW_DOWNGRADE
   if (highest_sw_version_found <= GIT_TAG_DEC)
       return false; //The firmware image with the highest version is it nothing new. Finishing here.
 
 #endif
 
+  if (highest_sw_version_found == 0)
+    return false;
+
+  // the running slot tells its own software version, the sensor already runs it
+  if ((update_slot != 0)
+      && (highest_sw_version_found == __REV( ((const uint32_t*) running_boot_slot())[BOOT_SLOT_SW_VERSION])))
+    return false;
+
+  // a version which has failed its trial is not tried again,
+  // unless it has been confirmed when started as the last resort by the boot selector
+  if ((update_slot != 0)
+      && (((const uint32_t*) update_slot)[BOOT_SLOT_REVOKED_MARK] == BOOT_SLOT_MARKED)
+      && (((const uint32_t*) update_slot)[BOOT_SLOT_CONFIRMED_MARK] == BOOT_SLOT_ERASED)
+      && (highest_sw_version_found == __REV( ((const uint32_t*) update_slot)[BOOT_SLOT_SW_VERSION])))
+    return false;
+
   // try to open new software image file
   fresult = f_open (&the_file, highest_sw_version_fname, FA_READ);
   if (fresult != FR_OK)
@@ -516,7 +1105,7 @@ bool read_software_update (void)
   uint32_t *flash_ptr;
   bool image_is_equal = true;
 
-  for (mem_ptr = (uint32_t*) mem_buffer, flash_ptr = (uint32_t*) flash_address;
+  for (mem_ptr = (uint32_t*) mem_buffer, flash_ptr = (uint32_t*) UPDATE_STORAGE_ADDRESS;
       mem_ptr < (uint32_t*) (mem_buffer + MEM_BUFSIZE); ++mem_ptr, ++flash_ptr)
     if (*mem_ptr != *flash_ptr)
       {
@@ -524,75 +1113,84 @@ bool read_software_update (void)
 	break;
       }
 
-  if (image_is_equal)
-    return false;
-
-  status = HAL_FLASH_Unlock ();
-  if (status != HAL_OK)
-    return false;
-
-  // for an unknown reason error flags need to be reset
-  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP);
-  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPERR);
-  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_WRPERR);
-  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_PGAERR);
-  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_PGPERR);
-  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_PGSERR);
+  if (image_is_equal && not highest_sw_version_is_delta && (update_slot == 0))
+    {
+      f_close (&the_file);
+      return false;
+    }
 
-  // erase flash range 0x08080000 - 0x080DFFFF
-  uint32_t SectorError = 0;
-  FLASH_EraseInitTypeDef pEraseInit;
-  pEraseInit.TypeErase = FLASH_TYPEERASE_SECTORS;
-  pEraseInit.NbSectors = 1;
-  pEraseInit.VoltageRange = VOLTAGE_RANGE_3;
-  pEraseInit.Sector = FLASH_SECTOR_7;
-  status = HAL_FLASHEx_Erase (&pEraseInit, &SectorError);
-  if ((status != HAL_OK) || (SectorError != 0xffffffff))
-    return false;
-  pEraseInit.Sector = FLASH_SECTOR_8;
-  status = HAL_FLASHEx_Erase (&pEraseInit, &SectorError);
-  if ((status != HAL_OK) || (SectorError != 0xffffffff))
-    return false;
-  pEraseInit.Sector = FLASH_SECTOR_9;
-  status = HAL_FLASHEx_Erase (&pEraseInit, &SectorError);
-  if ((status != HAL_OK) || (SectorError != 0xffffffff))
-    return false;
+  // pass one: nothing is erased before the complete image has been verified
+  uint64_t start_time = getTime_usec();
+  uint32_t image_offset = 0;
+  uint32_t image_bytes = 0;
+  uint32_t image_crc = 0;
+  bool image_is_valid;
+  if (update_slot != 0)
+    image_is_valid = verify_slot_image (the_file, update_slot, image_offset, image_bytes, image_crc);
+  else
+    image_is_valid = (f_lseek (&the_file, 0) == FR_OK)
+      && (highest_sw_version_is_delta ?
+	  apply_delta_image (the_file, false, image_bytes, image_crc) :
+	  verify_update_image (the_file, image_bytes, image_crc));
+  uint64_t verify_time = getTime_usec() - start_time;
+
+  if( not image_is_valid)
+    {
+      f_close (&the_file);
+      write_update_report( highest_sw_version_fname, "corrupt image rejected", image_bytes, verify_time, 0);
+
+      // rename it so that it is not verified again on every boot
+      char bad_image_fname[_MAX_LFN + 5];
+      char *next = bad_image_fname;
+      append_string( next, highest_sw_version_fname);
+      append_string( next, ".bad");
+      f_rename (highest_sw_version_fname, bad_image_fname);
+      return false;
+    }
 
-  for (;;)
+  // pass two: erase flash range 0x08060000 - 0x080BFFFF or the inactive slot and program
+  start_time = getTime_usec();
+  bool image_programmed;
+  if (update_slot != 0)
     {
-      for (uint32_t *data_pointer = (uint32_t*) mem_buffer;
-	  data_pointer < (uint32_t*) (mem_buffer + bytes_read); ++data_pointer)
-	{
-	  status = HAL_FLASH_Program ( TYPEPROGRAM_WORD, flash_address,
-				      (uint64_t) *data_pointer);
-	  if (status != HAL_OK)
-	    break;
-	  flash_address += sizeof(uint32_t);
-	}
+      // the boot selector prefers the highest sequence number
+      uint32_t sequence = ((const uint32_t*) running_boot_slot())[BOOT_SLOT_SEQUENCE];
+      sequence = (sequence == BOOT_SLOT_ERASED) ? 1 : sequence + 1;
+      image_programmed = (f_lseek (&the_file, image_offset) == FR_OK)
+	  && program_update_image (the_file, update_slot, image_bytes, image_crc, sequence);
+    }
+  else
+    image_programmed = (f_lseek (&the_file, 0) == FR_OK)
+      && (highest_sw_version_is_delta ?
+	  apply_delta_image (the_file, true, image_bytes, image_crc) :
+	  program_update_image (the_file, UPDATE_STORAGE_ADDRESS, image_bytes, image_crc, BOOT_SLOT_ERASED));
+  uint64_t program_time = getTime_usec() - start_time;
+  f_close (&the_file);
+
+  if( not image_programmed)
+    {
+      // leave no partial image behind
+      (void) erase_update_storage( (update_slot != 0) ? update_slot : UPDATE_STORAGE_ADDRESS);
+      write_update_report( highest_sw_version_fname, "programming failed", image_bytes, verify_time, program_time);
+      return false;
+    }
 
-      if (last_block_read)
-	{
-	  HAL_FLASH_Lock ();
-	  delay (100); // wait until uSD operations are finished
-	  fresult = f_mount (0, "", 0); // unmount file system
-	  delay (100); // wait until uSD operations are finished
-	  return true;
-	}
+  write_update_report( highest_sw_version_fname,
+		       highest_sw_version_is_delta ? "programmed from delta" : "programmed",
+		       image_bytes, verify_time, program_time);
 
-      fresult = f_read (&the_file, mem_buffer, MEM_BUFSIZE, &bytes_read);
-      if (fresult != FR_OK)
-	{
-	  f_close (&the_file);
-	  break;
-	}
+  delay (100); // wait until uSD operations are finished
+  fresult = f_mount (0, "", 0); // unmount file system
+  delay (100); // wait until uSD operations are finished
 
-      if (bytes_read < MEM_BUFSIZE)
-	{
-	  f_close (&the_file);
-	  last_block_read = true;
-	}
+  // the boot selector starts the new slot on trial
+  if (update_slot != 0)
+    {
+      // parameters received via CAN, the new slot is started at the next reset anyway
+      for (unsigned retry = 0; retry < 10 && not flush_deferred_EEPROM_values (); ++retry)
+	delay (100);
+      NVIC_SystemReset ();
     }
-  HAL_FLASH_Lock ();
-  return false;
-}
 
+  return true;
+}
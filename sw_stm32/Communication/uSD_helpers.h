@@ -30,6 +30,8 @@ extern unsigned crashline;
 
 bool read_software_update (void);
 void write_crash_dump( void);
+//! SHA256 of the program image for the EEPROM dump, takes some 100 ms: call before logging starts
+void prepare_EEPROM_dump( void);
 bool write_EEPROM_dump( const char * file_path);
 char * format_date_time( char * target, const D_GNSS_coordinates_t &coordinates);
 
@@ -69,6 +69,7 @@ extern uint64_t getTime_usec_privileged(void);
 
 #define INCLUDE_uxTaskGetStackHighWaterMark	1
 #define configRECORD_STACK_HIGH_ADDRESS		1
+#define configINCLUDE_FREERTOS_TASK_C_ADDITIONS_H 1 // freertos_tasks_c_additions.h: stack range for the crash minidump
 
 #define configENFORCE_SYSTEM_CALLS_FROM_KERNEL_ONLY 0
 #define configALLOW_UNPRIVILEGED_CRITICAL_SECTIONS 0
@@ -85,9 +86,10 @@ extern uint64_t getTime_usec_privileged(void);
 #define configTOTAL_HEAP_SIZE                    ((size_t)15360)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY		 1 // needed for the tracealyzer
+#define TRACE_STREAMING_TO_SD			 0 // 1: stream the trace into a .psf file next to the log file
 #define configUSE_16_BIT_TICKS                   0
 #define configUSE_MUTEXES                        1
-#define configQUEUE_REGISTRY_SIZE                8
+#define configQUEUE_REGISTRY_SIZE                16 // queues, semaphores and mutexes in the crash minidump
 #define configUSE_RECURSIVE_MUTEXES              0
 #define configUSE_COUNTING_SEMAPHORES            1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION  1
@@ -121,7 +123,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelay                   1
 #define INCLUDE_xTaskGetSchedulerState       1
 #define INCLUDE_xTimerPendFunctionCall       0
-#define INCLUDE_xQueueGetMutexHolder         0
+#define INCLUDE_xQueueGetMutexHolder         1
 #define INCLUDE_eTaskGetState                1
 
 /* 
@@ -0,0 +1,89 @@
+/** *****************************************************************************
+ * @file    	boot_slots.h
+ * @brief   	flash layout and state of the A/B application slots
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef BOOT_SLOTS_H_
+#define BOOT_SLOTS_H_
+
+#include "stdint.h"
+
+/* A resident boot selector occupies flash sector 0. It starts one of two
+ * application slots, each linked for its own address. A new software version
+ * is programmed into the inactive slot and started on trial. The application
+ * confirms its health, otherwise the boot selector returns to the other slot.
+ *
+ * Slot layout: slot header (BOOT_SLOT_HEADER_BYTES), then the vector table.
+ * The state words of the header are erased in the image file and are programmed
+ * on the device, one way only (1 -> 0), so no erase cycle is needed.
+ */
+
+#define BOOT_SELECTOR_ADDRESS		0x08000000 // sector 0
+#define BOOT_SLOT_A_ADDRESS		0x08004000 // sectors 1 - 6
+#define BOOT_SLOT_B_ADDRESS		0x08060000 // sectors 7 - 9, the former update storage
+#define BOOT_SLOT_BYTES			0x5C000 // limited by slot A
+#define BOOT_SLOT_HEADER_BYTES		0x200 // keeps the vector table aligned for VTOR
+
+#define BOOT_SLOT_MAGIC_NUMBER		0x1c8073ab2085510bULL
+
+// slot header, 32-bit words
+#define BOOT_SLOT_CRC			2 // stm32_crc() from BOOT_SLOT_HEADER_VERSION up to the end, state words erased
+#define BOOT_SLOT_HEADER_VERSION	3
+#define BOOT_SLOT_LINK_ADDRESS		4 // slot the application has been linked for
+#define BOOT_SLOT_HW_VERSION		5 // as in the software image
+#define BOOT_SLOT_SW_VERSION		6
+#define BOOT_SLOT_IMAGE_BYTES		7 // header included
+#define BOOT_SLOT_SEQUENCE		16 // ~ number of updates, programmed by the updater
+#define BOOT_SLOT_TRIAL_MARK		17 // programmed by the boot selector when starting a new slot
+#define BOOT_SLOT_CONFIRMED_MARK	18 // programmed by the application when it is healthy
+#define BOOT_SLOT_REVOKED_MARK		19 // programmed by the boot selector after a failed trial
+#define BOOT_SLOT_STATE_WORDS		4
+
+#define BOOT_SLOT_ERASED		0xffffffff
+#define BOOT_SLOT_MARKED		0x00000000
+
+#define BOOT_TRIAL_TIMEOUT_S		30 // independent watchdog, at most 32 s
+#define BOOT_CONFIRM_SENSOR_LOOPS	100 // 1 s of sensor loops without watchdog alarm
+
+#ifdef __cplusplus
+
+//! vector table from the startup file, it follows the slot header with the boot selector
+extern "C" uint32_t g_pfnVectors[];
+
+//! slot the application runs from, 0 if it is linked without boot selector
+uint32_t running_boot_slot( void);
+
+//! the slot to program an update into, 0 without boot selector
+uint32_t inactive_boot_slot( void);
+
+//! the running slot has been started on trial and is not yet confirmed
+bool boot_slot_on_trial( void);
+
+//! called once per sensor loop by the communicator
+void report_sensor_loop_running( void);
+
+//! called by the watchdog task, never blocks: confirms a trial boot once healthy, keeps the trial watchdog alive
+void supervise_boot_slot( void);
+
+#endif
+
+#endif /* BOOT_SLOTS_H_ */
@@ -0,0 +1,77 @@
+/** *****************************************************************************
+ * @file    	boot_timeline.h
+ * @brief   	boot time profiler: milestones and readiness events
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef BOOT_TIMELINE_H_
+#define BOOT_TIMELINE_H_
+
+#include "system_configuration.h"
+#include "FreeRTOS_wrapper.h"
+
+/* Each milestone of the start-up is stamped once with getTime_usec(),
+ * i.e. the time since the scheduler start, and set as event bit.
+ * Tasks depending on another part of the system wait for these events
+ * instead of fixed delays. The timeline is logged as BOOT_TIMELINE
+ * record and printed once via USB.
+ */
+enum boot_milestone_t
+{
+  BOOT_CONFIGURATION_READ,	//!< uSD card and EEPROM, the communicator starts
+  BOOT_MTI_MEASURING,		//!< IMU data arrive @ 100 Hz
+  BOOT_STATIC_PRESSURE_READY,
+  BOOT_PITOT_PRESSURE_READY,
+  BOOT_SENSORS_SETTLED,
+  BOOT_NAVIGATION_INITIALIZED,	//!< the communicator enters its main loop
+  BOOT_FIRST_NMEA_OUTPUT,
+  BOOT_FIRST_CAN_OUTPUT,
+  BOOT_LOG_FILE_OPEN,
+  BOOT_MILESTONES
+};
+
+#define BOOT_EVENT( milestone)	( 1 << ( milestone))
+
+//! the sensors the navigation has to wait for
+#define BOOT_SENSORS_REQUIRED ( \
+    ( RUN_MTi_1_MODULE ? BOOT_EVENT( BOOT_MTI_MEASURING) : 0) \
+  | ( RUN_MS5611_MODULE ? BOOT_EVENT( BOOT_STATIC_PRESSURE_READY) : 0) \
+  | ( RUN_PITOT_MODULE ? BOOT_EVENT( BOOT_PITOT_PRESSURE_READY) : 0))
+
+typedef struct
+{
+  uint32_t time_usec[BOOT_MILESTONES]; //!< since the scheduler start, 0 = not reached yet
+} boot_timeline_t;
+
+extern event_group boot_events; //!< BOOT_EVENT( milestone) set when reached
+
+//! stamp the milestone, only the first call counts
+void boot_milestone( boot_milestone_t milestone);
+
+//! wait until all of the events are set, return false on timeout
+bool wait_for_boot_milestones( EventBits_t events, unsigned timeout_ms);
+
+const boot_timeline_t & get_boot_timeline( void);
+
+//! one text line per milestone
+char * format_boot_timeline( char * next);
+
+#endif /* BOOT_TIMELINE_H_ */
@@ -0,0 +1,46 @@
+/** *****************************************************************************
+ * @file    	freertos_tasks_c_additions.h
+ * @brief   	kernel extensions included at the end of tasks.c
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef FREERTOS_TASKS_C_ADDITIONS_H_
+#define FREERTOS_TASKS_C_ADDITIONS_H_
+
+/* This file is included by tasks.c if configINCLUDE_FREERTOS_TASK_C_ADDITIONS_H is set,
+ * so the functions below can see the TCB without patching the kernel.
+ */
+
+/*! \brief stack range of a task for the crash minidump
+ *
+ *  For a task which is not running *ppxTopOfStack is its saved context, see port.c.
+ */
+void vTaskGetStackRange( TaskHandle_t xTask, StackType_t ** ppxTopOfStack, StackType_t ** ppxEndOfStack ) PRIVILEGED_FUNCTION;
+
+void vTaskGetStackRange( TaskHandle_t xTask, StackType_t ** ppxTopOfStack, StackType_t ** ppxEndOfStack )
+{
+    TCB_t * pxTCB = prvGetTCBFromHandle( xTask );
+
+    *ppxTopOfStack = ( StackType_t * ) pxTCB->pxTopOfStack;
+    *ppxEndOfStack = pxTCB->pxEndOfStack;
+}
+
+#endif /* FREERTOS_TASKS_C_ADDITIONS_H_ */
@@ -0,0 +1,39 @@
+/** *****************************************************************************
+ * @file    	stm32_crc.h
+ * @brief   	software CRC32 compatible with the STM32 CRC unit
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef STM32_CRC_H_
+#define STM32_CRC_H_
+
+#include "stdint.h"
+
+#define STM32_CRC_INIT 0xffffffff
+
+/*! \brief polynomial 0x04C11DB7, 32-bit words MSB first, no reflection, no final XOR
+ *
+ *  Same result as the CRC unit and as stm32_crc() in scripts/pack.py.
+ *  Usage: crc = stm32_crc( STM32_CRC_INIT, data, words), may be continued.
+ */
+uint32_t stm32_crc( uint32_t crc, const uint32_t * data, uint32_t words);
+
+#endif /* STM32_CRC_H_ */
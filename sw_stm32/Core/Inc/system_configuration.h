@@ -29,7 +29,9 @@
 #include "git-commit-version.h"
 
 #define RUN_FLASH_WRITE_TESTER		0
+#ifndef ANALYZE_WRITE_PERFORMANCE // may be enabled from the command line (host benchmark)
 #define ANALYZE_WRITE_PERFORMANCE	0
+#endif
 
 #define USE_HARDWARE_EEPROM		1
 #define MEASURE_GNSS_REFRESH_TIME	0
@@ -76,6 +78,7 @@
 
 #define MAG_CALCULATOR_PRIORITY		STANDARD_TASK_PRIORITY
 #define EEPROM_WRITER_PRIORITY	 	STANDARD_TASK_PRIORITY
+#define FLASH_PROGRAMMER_PRIORITY	STANDARD_TASK_PRIORITY // below LOGGER_PRIORITY: programs while the uSD task reads
 
 // ISR priorities
 
@@ -92,6 +95,57 @@
 #define FLASH_ERASE_TIMEOUT		2000
 #define FLASH_ACCESS_TIMEOUT		10
 #define MAXIMUM_PAGE_ERASE_TIME 	2000
+#define FLASH_WRITE_BATCH_WORDS		16 // programmed in one unlocked session: node header + 3x3 matrix + spare
+#define FLASH_WRITE_QUEUE_LENGTH	4
+#define EEPROM_PAGE_SWAP_STEP_INTERVAL	100 // idle time in ticks before the next background compaction step
+#define EEPROM_PAGE_SWAP_THRESHOLD_WORDS 0x400 // compact when less space is left in the active page
+#define EEPROM_WRITE_BEHIND_DEPTH	8 // pending parameter changes from CAN, 0 = write synchronously
+#define EEPROM_TRANSACTION_ID		0x81 // EEPROM file record holding the last multi-parameter update
+#define EEPROM_TRANSACTION_WORDS	32 // staged entries incl. commit marker, one record header word per entry
+#define EEPROM_TRANSACTION_STAGES	2 // tasks staging a transaction at the same time: communicator, magnetic calculator
+
+// log file ring sizing, see Host_Tools/log_file_benchmark to measure
+#define MEM_BUFSIZE			4096 // bytes, uSD transfer buffer mem_buffer: log ring, update blocks, minidump blocks
+#define LOG_SLOT_SIZE_BYTES		1024 // multiple of the uSD sector size
+#define LOG_SD_STALL_BUDGET_MS		250  // longest uSD write latency to survive (garbage collection)
+#define LOG_PRETRIGGER_MS		250  // data kept in RAM from power-on until the log file is open
+#define LOG_DATA_RATE_BYTES_PER_SECOND	13000 // 100 Hz logging incl. D-GNSS and external magnetometer
+#define LOG_EXPECTED_FLIGHT_MINUTES	360  // contiguous preallocation at file creation
+#define LOG_GROWTH_CHUNK_BYTES		(4*1024*1024) // extension step if the flight takes longer
+#define LOG_SYNC_INTERVAL_MS		2000 // f_sync period ...
+#define LOG_SYNC_INTERVAL_BYTES		(64*1024) // ... or amount of data, whatever comes first
+#define LOG_COMPACT_SENSOR_DATA		0 // 1: delta / varint encoded sensor records, see compact_record_codec.h
+#define LOG_STATE_VECTOR		0 // compact state vector records @ 100 Hz
+#define LOG_COMPACT_KEYFRAME_INTERVAL	100 // records between two full keyframes
+#define LOG_INDEX_INTERVAL_SECONDS	4 // initial seek index resolution, coarsened for long flights
+#define LOG_CHECKPOINT_INTERVAL_BYTES	4096 // journal checkpoint spacing = data lost at most on power failure
+#define LOG_OPEN_MARKER			"logger/open.txt" // holds the name of the log file being written
+#define CRASH_DUMP_LOG_TAIL_BYTES	8192 // most recent log ring data in the crash minidump
+
+// black box: most recent data in RAM for crash and watchdog dumps, see black_box.h
+#define BLACK_BOX_SECONDS		5  // kept for each of the data streams
+#define BLACK_BOX_SENSOR_DATA_DIVIDER	5  // 20 Hz
+#define BLACK_BOX_STATE_VECTOR_DIVIDER	20 // 5 Hz, GNSS data @ 10 Hz
+
+// warm restart from the backup SRAM after an unplanned reset, see warm_restart.h
+#define WARM_RESTART_MAX_IN_A_ROW	2
+#define WARM_RESTART_STABLE_SECONDS	60 // until warm restarts in a row are forgotten
+
+// flight phase dependent log rates, see log_rate_scheduler.h
+#define LOG_RATE_POLICY_EEPROM_ID	0x80 // EEPROM file record, clear of the EEPROM_PARAMETER_ID range
+#define LOG_PHASE_LAUNCH_IAS		8.0f  // m/s: ground roll, winch or aero-tow launch
+#define LOG_PHASE_TAXI_GROUND_SPEED	3.0f  // m/s: moved on the ground
+#define LOG_PHASE_FLIGHT_IAS		20.0f // m/s: airborne ...
+#define LOG_PHASE_FLIGHT_CONFIRM_S	5     // ... for this time
+#define LOG_PHASE_LAUNCH_ABORT_S	60    // back to ground idle without taking off
+#define LOG_PHASE_POST_LANDING_S	120   // full rate logging after the landing
+
+#define SENSOR_SETTLE_CYCLES		100 // 100 Hz cycles after all sensors are ready, shorten only based on boot timeline data
+#define BOOT_TIMELINE_REPORT_SECONDS	10 // after the first output: print the boot timeline via USB
+
+// streaming trace into the uSD card, see trace_stream_sink.h
+#define TRACE_SINK_BYTES		16384 // power of 2, bridges uSD write stalls
+#define TRACE_SINK_CHUNK_BYTES		4096 // written per uSD task cycle at most
 
 #define NMEA_REPORTING_PERIOD		250 // period in clock ticks for NMEA output
 #define NMEA_DECIMATION_RATIO		6  // slow-down factor for the slow properties
@@ -0,0 +1,104 @@
+/** *****************************************************************************
+ * @file    	warm_restart.h
+ * @brief   	checkpoint in the backup SRAM to resume after an unplanned reset
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef WARM_RESTART_H_
+#define WARM_RESTART_H_
+
+#include "stdint.h"
+
+/* Once per second the communicator saves the state it needs to resume its
+ * work into the battery-backed SRAM: the organizer with its filters and
+ * calibration, the last GNSS fix and the flight phase. After an unplanned
+ * reset (watchdog or brown-out) the firmware starts from this checkpoint and
+ * skips the MTi reset and configuration and the filter initialization.
+ *
+ * The checkpoint is a memory image of objects on the communicator's stack.
+ * It is only used by exactly the build that wrote it, checked by the git
+ * version, the slot and the code size. Planned resets invalidate it, a reset
+ * cause is read once at start-up. After WARM_RESTART_MAX_IN_A_ROW warm
+ * restarts without WARM_RESTART_STABLE_SECONDS of operation in between the
+ * next start is a cold one: the checkpoint itself may be the problem.
+ */
+
+#define BACKUP_SRAM_BYTES	4096
+
+#define WARM_RESTART_MAGIC	0x5752534d // "MSRW"
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t vector_table;	//!< boot slot of the application
+  uint32_t code_end;		//!< __fini_array_end
+  char git_tag[32];		//!< GIT_TAG_INFO incl. commit hash
+  uint32_t payload_bytes;
+  uint32_t sequence;		//!< checkpoints since the start of the application
+  uint32_t warm_restarts;	//!< in a row, including the one of the present run
+  uint32_t crc;			//!< stm32_crc() of the header from vector_table up to here and the payload
+} warm_restart_header_t;
+
+//! one object saved and restored
+typedef struct
+{
+  void * data;
+  uint32_t bytes;
+} warm_restart_piece_t;
+
+//! reported as WARM_RESTART_REPORT log record
+typedef struct
+{
+  uint32_t warm_restart;	//!< 0 = cold start
+  uint32_t warm_restarts;	//!< in a row
+  uint32_t reset_flags;		//!< RCC->CSR at start-up
+  uint32_t checkpoint_sequence;	//!< of the checkpoint used
+  uint32_t time_to_valid_output_usec; //!< scheduler start until the first output of the navigation data
+} warm_restart_report_t;
+
+#define WARM_RESTART_PAYLOAD_BYTES ( BACKUP_SRAM_BYTES - sizeof( warm_restart_header_t))
+
+#ifdef __cplusplus
+
+//! a checkpoint of this build has survived an unplanned reset
+bool warm_restart_available( void);
+
+//! copy the checkpoint into the pieces, with privileges
+bool warm_restart_restore( const warm_restart_piece_t pieces[], unsigned count);
+
+//! write a checkpoint of the pieces, with privileges
+void warm_restart_save( const warm_restart_piece_t pieces[], unsigned count);
+
+//! the reset coming next shall result in a cold start
+void request_cold_restart( void);
+
+//! called by the watchdog ISR and the crash handler, invalidates the checkpoint if requested
+void prepare_watchdog_reset( void);
+
+//! reset flags, warm restarts in a row and checkpoint used at start-up
+const warm_restart_report_t & get_warm_restart_report( void);
+
+//! called when the navigation data is output for the first time
+void report_valid_output( uint32_t time_usec);
+
+#endif
+
+#endif /* WARM_RESTART_H_ */
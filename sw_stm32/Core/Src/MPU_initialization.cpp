@@ -98,7 +98,7 @@ extern "C" void MPU_initialization(void)
   test = 1.0f / test;
 #endif
 
-#if configUSE_TRACE_FACILITY == 1
+#if configUSE_TRACE_FACILITY == 1 && ! TRACE_STREAMING_TO_SD // streaming starts with the log file
 	vTraceEnable(TRC_START);
 #endif
   HAL_Init();
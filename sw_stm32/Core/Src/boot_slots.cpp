@@ -0,0 +1,121 @@
+/** *****************************************************************************
+ * @file    	boot_slots.cpp
+ * @brief   	application side of the A/B slot boot process
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "system_configuration.h"
+#include "main.h"
+#include "FreeRTOS_wrapper.h"
+#include "stm32f4xx_hal.h"
+#include "common.h"
+#include "boot_slots.h"
+#include "EEPROM_data_file_implementation.h"
+
+extern unsigned watchdog_counter;
+
+COMMON static volatile uint32_t sensor_loops;
+COMMON static bool boot_slot_confirmed;
+COMMON static bool confirm_mark_ordered;
+COMMON static flash_write_ticket_t confirm_mark_ticket;
+
+uint32_t running_boot_slot( void)
+{
+  switch( (uint32_t) g_pfnVectors - BOOT_SLOT_HEADER_BYTES)
+  {
+    case BOOT_SLOT_A_ADDRESS:
+      return BOOT_SLOT_A_ADDRESS;
+    case BOOT_SLOT_B_ADDRESS:
+      return BOOT_SLOT_B_ADDRESS;
+    default:
+      return 0;
+  }
+}
+
+uint32_t inactive_boot_slot( void)
+{
+  switch( running_boot_slot())
+  {
+    case BOOT_SLOT_A_ADDRESS:
+      return BOOT_SLOT_B_ADDRESS;
+    case BOOT_SLOT_B_ADDRESS:
+      return BOOT_SLOT_A_ADDRESS;
+    default:
+      return 0;
+  }
+}
+
+//! the slot header is part of the privileged flash region
+bool boot_slot_on_trial( void)
+{
+  uint32_t slot = running_boot_slot();
+  if( slot == 0)
+    return false;
+
+  const uint32_t *header = (const uint32_t*) slot;
+  return ( header[BOOT_SLOT_TRIAL_MARK] == BOOT_SLOT_MARKED)
+      && ( header[BOOT_SLOT_CONFIRMED_MARK] == BOOT_SLOT_ERASED);
+}
+
+void report_sensor_loop_running( void)
+{
+  if( sensor_loops < BOOT_CONFIRM_SENSOR_LOOPS)
+    ++sensor_loops;
+}
+
+/*! \brief confirm a trial boot once healthy
+ *
+ *  This runs on the watchdog task, it must neither block nor touch the flash controller.
+ *  The confirm mark is programmed by the EEPROM writer, the ticket is polled here.
+ *  The slot is confirmed as soon as the header shows the mark.
+ */
+void supervise_boot_slot( void)
+{
+  if( boot_slot_confirmed)
+    {
+      IWDG->KR = 0xAAAA; // refresh, no effect if the boot selector did not start the trial watchdog
+      return;
+    }
+
+  if( sensor_loops < BOOT_CONFIRM_SENSOR_LOOPS || watchdog_counter != 0)
+    return; // the boot selector's watchdog will decide
+
+  bool order_pending = confirm_mark_ordered && not FLASH_write_done( confirm_mark_ticket);
+
+  acquire_privileges();
+  bool on_trial = boot_slot_on_trial();
+  drop_privileges();
+
+  if( on_trial)
+    {
+      if( not order_pending) // again if the EEPROM writer has been busy or the mark did not stick
+	{
+	  uint32_t mark = BOOT_SLOT_MARKED;
+	  confirm_mark_ordered = FLASH_write_try_async(
+	      (uint32_t *)( running_boot_slot() + BOOT_SLOT_CONFIRMED_MARK * sizeof( uint32_t)),
+	      &mark, 1, confirm_mark_ticket);
+	}
+      return;
+    }
+
+  boot_slot_confirmed = true;
+  IWDG->KR = 0xAAAA;
+}
@@ -0,0 +1,88 @@
+/** *****************************************************************************
+ * @file    	boot_timeline.cpp
+ * @brief   	boot time profiler: milestones and readiness events
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "system_configuration.h"
+#include "main.h"
+#include "FreeRTOS_wrapper.h"
+#include "common.h"
+#include "ascii_support.h"
+#include "boot_timeline.h"
+
+uint64_t getTime_usec( void);
+
+COMMON event_group boot_events;
+COMMON static boot_timeline_t timeline;
+
+static ROM char * const MILESTONE_NAMES[BOOT_MILESTONES] =
+  {
+    "CONFIGURATION_READ",
+    "MTI_MEASURING",
+    "STATIC_PRESSURE_READY",
+    "PITOT_PRESSURE_READY",
+    "SENSORS_SETTLED",
+    "NAVIGATION_INITIALIZED",
+    "FIRST_NMEA_OUTPUT",
+    "FIRST_CAN_OUTPUT",
+    "LOG_FILE_OPEN"
+  };
+
+void boot_milestone( boot_milestone_t milestone)
+{
+  if( timeline.time_usec[milestone] != 0)
+    return;
+
+  uint32_t time = getTime_usec();
+  timeline.time_usec[milestone] = time ? time : 1;
+  boot_events.set_bits( BOOT_EVENT( milestone));
+}
+
+bool wait_for_boot_milestones( EventBits_t events, unsigned timeout_ms)
+{
+  return ( boot_events.wait_bits( events, false, true, timeout_ms) & events) == events;
+}
+
+const boot_timeline_t & get_boot_timeline( void)
+{
+  return timeline;
+}
+
+char * format_boot_timeline( char * next)
+{
+  for( unsigned milestone = 0; milestone < BOOT_MILESTONES; ++milestone)
+    {
+      append_string( next, "# boot ");
+      append_string( next, MILESTONE_NAMES[milestone]);
+      *next++ = ' ';
+      if( timeline.time_usec[milestone] == 0)
+	*next++ = '-';
+      else
+	{
+	  next = my_itoa( next, timeline.time_usec[milestone] / 1000);
+	  append_string( next, " ms");
+	}
+      newline( next);
+    }
+  *next = 0;
+  return next;
+}
@@ -0,0 +1,47 @@
+/** *****************************************************************************
+ * @file    	stm32_crc.cpp
+ * @brief   	software CRC32 compatible with the STM32 CRC unit
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "stm32_crc.h"
+
+// the hardware unit is not used as it is not accessible from unprivileged tasks
+
+//! table for 4 bits at a time: small enough for flash, fast enough for logging
+static const uint32_t crc_table[16] =
+{
+  0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
+  0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
+  0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
+  0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
+};
+
+uint32_t stm32_crc( uint32_t crc, const uint32_t * data, uint32_t words)
+{
+  while( words--)
+    {
+      crc ^= *data++;
+      for( unsigned nibble = 0; nibble < 8; ++nibble)
+	crc = ( crc << 4) ^ crc_table[ crc >> 28];
+    }
+  return crc;
+}
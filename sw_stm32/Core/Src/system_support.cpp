@@ -29,7 +29,7 @@
 
 #if configUSE_TRACE_FACILITY == 1
 #include "trcConfig.h"
-PRIVILEGED_DATA RecorderDataType myTraceBuffer;
+PRIVILEGED_DATA TRC_ALLOC_CUSTOM_BUFFER( myTraceBuffer) // snapshot or streaming pages
 #endif
 
 extern uint32_t _s_system_ram[]; // provided by linker description file
@@ -0,0 +1,187 @@
+/** *****************************************************************************
+ * @file    	warm_restart.cpp
+ * @brief   	checkpoint in the backup SRAM to resume after an unplanned reset
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "system_configuration.h"
+#include "main.h"
+#include "FreeRTOS_wrapper.h"
+#include "stm32f4xx_hal.h"
+#include "common.h"
+#include "stm32_crc.h"
+#include "boot_slots.h"
+#include "warm_restart.h"
+#include "stddef.h"
+#include "string.h"
+
+extern uint8_t __fini_array_end[];
+
+#define BACKUP_SRAM ( (warm_restart_header_t *) BKPSRAM_BASE)
+
+// read by unprivileged tasks
+COMMON static bool checkpoint_available;
+COMMON static bool cold_restart_requested;
+COMMON static warm_restart_report_t report;
+
+static uint32_t warm_restarts_in_a_row;
+static uint32_t sequence;
+
+static inline uint32_t padded( uint32_t bytes)
+{
+  return ( bytes + sizeof( uint32_t) - 1) & ~( sizeof( uint32_t) - 1);
+}
+
+static uint32_t payload_bytes( const warm_restart_piece_t pieces[], unsigned count)
+{
+  uint32_t bytes = 0;
+  for( unsigned i = 0; i < count; ++i)
+    bytes += padded( pieces[i].bytes);
+  return bytes;
+}
+
+//! the magic number is written last and therefore not part of the CRC
+static uint32_t checkpoint_crc( const warm_restart_header_t * header)
+{
+  uint32_t crc = stm32_crc( STM32_CRC_INIT, &header->vector_table,
+			    ( offsetof( warm_restart_header_t, crc) - offsetof( warm_restart_header_t, vector_table))
+			    / sizeof( uint32_t));
+  return stm32_crc( crc, (const uint32_t *) ( header + 1), header->payload_bytes / sizeof( uint32_t));
+}
+
+//! written by exactly this build
+static bool checkpoint_valid( const warm_restart_header_t * header)
+{
+  return ( header->magic == WARM_RESTART_MAGIC)
+      && ( header->vector_table == (uint32_t) g_pfnVectors)
+      && ( header->code_end == (uint32_t) __fini_array_end)
+      && ( strncmp( header->git_tag, GIT_TAG_INFO, sizeof( header->git_tag)) == 0)
+      && ( header->payload_bytes <= WARM_RESTART_PAYLOAD_BYTES)
+      && ( checkpoint_crc( header) == header->crc);
+}
+
+//! runs before main(): backup SRAM access, reset cause and checkpoint
+static class warm_restart_start_up_t
+{
+public:
+  warm_restart_start_up_t( void)
+  {
+    RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+    RCC->AHB1ENR |= RCC_AHB1ENR_BKPSRAMEN;
+    PWR->CR |= PWR_CR_DBP; // backup domain write access
+    PWR->CSR |= PWR_CSR_BRE; // keep the backup SRAM on VBAT
+
+    report.reset_flags = RCC->CSR;
+    RCC->CSR |= RCC_CSR_RMVF; // clear the flags for the next reset
+
+    // watchdog or brown-out, power-on and software reset (update) excluded
+    bool unplanned_reset =
+	( report.reset_flags & ( RCC_CSR_WWDGRSTF | RCC_CSR_IWDGRSTF | RCC_CSR_BORRSTF))
+	&& ( ( report.reset_flags & ( RCC_CSR_PORRSTF | RCC_CSR_SFTRSTF)) == 0);
+
+    const warm_restart_header_t * header = BACKUP_SRAM;
+    if( unplanned_reset && checkpoint_valid( header) && ( header->warm_restarts < WARM_RESTART_MAX_IN_A_ROW))
+      {
+	checkpoint_available = true;
+	warm_restarts_in_a_row = header->warm_restarts + 1;
+	report.checkpoint_sequence = header->sequence;
+      }
+    else
+      BACKUP_SRAM->magic = 0;
+
+    report.warm_restarts = warm_restarts_in_a_row;
+  }
+} start_up;
+
+bool warm_restart_available( void)
+{
+  return checkpoint_available;
+}
+
+bool warm_restart_restore( const warm_restart_piece_t pieces[], unsigned count)
+{
+  const warm_restart_header_t * header = BACKUP_SRAM;
+  if( not checkpoint_available || ( header->payload_bytes != payload_bytes( pieces, count)))
+    {
+      checkpoint_available = false;
+      return false;
+    }
+
+  const uint8_t * source = (const uint8_t *) ( header + 1);
+  for( unsigned i = 0; i < count; ++i)
+    {
+      memcpy( pieces[i].data, source, pieces[i].bytes);
+      source += padded( pieces[i].bytes);
+    }
+  report.warm_restart = 1;
+  return true;
+}
+
+void warm_restart_save( const warm_restart_piece_t pieces[], unsigned count)
+{
+  warm_restart_header_t * header = BACKUP_SRAM;
+  uint32_t bytes = payload_bytes( pieces, count);
+  ASSERT( bytes <= WARM_RESTART_PAYLOAD_BYTES);
+
+  header->magic = 0; // invalid until complete
+
+  uint8_t * target = (uint8_t *) ( header + 1);
+  for( unsigned i = 0; i < count; ++i)
+    {
+      memcpy( target, pieces[i].data, pieces[i].bytes);
+      memset( target + pieces[i].bytes, 0, padded( pieces[i].bytes) - pieces[i].bytes);
+      target += padded( pieces[i].bytes);
+    }
+
+  if( ++sequence > WARM_RESTART_STABLE_SECONDS)
+    warm_restarts_in_a_row = 0; // has been running well for a while
+
+  header->vector_table = (uint32_t) g_pfnVectors;
+  header->code_end = (uint32_t) __fini_array_end;
+  memset( header->git_tag, 0, sizeof( header->git_tag));
+  strncpy( header->git_tag, GIT_TAG_INFO, sizeof( header->git_tag) - 1);
+  header->payload_bytes = bytes;
+  header->sequence = sequence;
+  header->warm_restarts = warm_restarts_in_a_row;
+  header->crc = checkpoint_crc( header);
+  header->magic = WARM_RESTART_MAGIC;
+}
+
+void request_cold_restart( void)
+{
+  cold_restart_requested = true;
+}
+
+void prepare_watchdog_reset( void)
+{
+  if( cold_restart_requested)
+    BACKUP_SRAM->magic = 0;
+}
+
+const warm_restart_report_t & get_warm_restart_report( void)
+{
+  return report;
+}
+
+void report_valid_output( uint32_t time_usec)
+{
+  report.time_to_valid_output_usec = time_usec;
+}
@@ -26,6 +26,9 @@
 #include "main.h"
 #include "FreeRTOS_wrapper.h"
 #include "stm32f4xx_hal.h"
+#include "EEPROM_data_file_implementation.h"
+#include "boot_slots.h"
+#include "warm_restart.h"
 
 #define SD_DETECT_PIN         GPIO_PIN_13
 #define SD_DETECT_GPIO_PORT   GPIOC
@@ -82,11 +85,13 @@ void watchdog_runnable (void*)
 #endif // ACTIVATE_WATCHDOG
 
   bool sd_was_plugged = SD_is_plugged_in();
+  bool reset_pending = false;
 
   uint8_t rythm = 0;
   for (synchronous_timer t (40); true;)
     {
       t.sync ();
+      supervise_boot_slot();
       if( (++rythm & 0x0f) ==0)
 	  HAL_GPIO_TogglePin (LED_STATUS3_GPIO_Port, LED_STATUS3_Pin);
 
@@ -100,12 +105,20 @@ void watchdog_runnable (void*)
 #endif
       HAL_WWDG_Refresh (&WwdgHandle);
 
-      if( (false == sd_was_plugged) && SD_is_plugged_in())
+      // parameters received via CAN are committed by the EEPROM writer, this task must not wait
+      if( reset_pending && not deferred_EEPROM_values_pending())
 	{
 	  user_initiated_reset = true;
+	  request_cold_restart(); // the sensor shall read the uSD card configuration
 	  while( true)
 	    ; // let the watchdog reset the system
 	}
+
+      if( (false == sd_was_plugged) && SD_is_plugged_in())
+	{
+	  request_deferred_EEPROM_flush();
+	  reset_pending = true;
+	}
       sd_was_plugged = SD_is_plugged_in();
 #endif
     }
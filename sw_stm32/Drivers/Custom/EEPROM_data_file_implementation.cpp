@@ -12,44 +12,168 @@
 #define PAGE_SIZE_BYTES 0x4000 // max 0x20000
 #define PAGE_SIZE_WORDS 0x1000 // 0x08000
 #define PAGE_SIZE_LONG_WORDS 0x800
+#define SECTOR_SIZE_LONG_WORDS 0x4000 // 128 KB, the legacy EEPROM data is located behind the page
+#define PAGE_OBSOLETE_MARK( sector) ( ( sector) == 0 ? (uint32_t *)0x080DFFFC : (uint32_t *)0x080FFFFC) // last word of the sector
 
-COMMON Queue <flash_write_order> flash_command_queue( 3);
+COMMON Queue <flash_write_order> flash_command_queue( FLASH_WRITE_QUEUE_LENGTH);
 COMMON Semaphore flash_isr_to_task( 1, 0, (char *)"FLASH_ISR");
+COMMON Semaphore flash_order_completed( 1, 0, (char *)"FLASH_DONE");
+COMMON Mutex flash_order_lock( (char *)"FLASH_ORDER");
+COMMON Mutex flash_session_lock( (char *)"FLASH_CTRL");
 COMMON Mutex EEPROM_lock;
 COMMON Mutex_Wrapper_Type my_mutex;
 
+COMMON volatile flash_write_ticket_t flash_orders_issued;
+COMMON volatile flash_write_ticket_t flash_orders_completed;
+COMMON flash_write_statistics_t flash_write_statistics;
+COMMON TaskHandle_t flash_writer_task;
+COMMON volatile bool flash_recovery_done; //!< background compaction must not interfere with the boot recovery
+COMMON volatile bool flash_background_work_inhibited; //!< flash operations stall code fetch for the whole CPU
+COMMON volatile bool deferred_commits_inhibited; //!< a few words only, allowed on the ground
+COMMON volatile bool deferred_flush_requested; //!< a reset is waiting for the deferred commits
+
+//! parameter change waiting for its flash commit
+typedef struct
+{
+  EEPROM_PARAMETER_ID id;
+  float value;
+} deferred_parameter_t;
+
+COMMON deferred_parameter_t deferred_parameters[EEPROM_WRITE_BEHIND_DEPTH];
+COMMON unsigned deferred_parameter_count;
+COMMON Mutex deferred_parameter_lock( (char *)"DEFERRED");
+
+#define EEPROM_TRANSACTION_COMMIT 0x434f4d54 // "COMT", last word of a transaction record
+#define TRANSACTION_ENTRY( id, size) ( (uint32_t)(id) | ( (uint32_t)(size) << 8))
+
+//! multi-parameter update: header word id | size << 8, then size data words per entry
+typedef struct
+{
+  uint32_t words;	//!< used words, without the commit marker
+  uint32_t data[EEPROM_TRANSACTION_WORDS];
+} EEPROM_transaction_t;
+
+//! a transaction collected in RAM for its owner, staging needs no EEPROM lock
+typedef struct
+{
+  TaskHandle_t owner;
+  bool overflow;
+  EEPROM_transaction_t staged;
+} transaction_stage_t;
+
+COMMON transaction_stage_t transaction_stages[EEPROM_TRANSACTION_STAGES];
+COMMON Mutex transaction_stage_lock( (char *)"EE_STAGE");
+COMMON EEPROM_transaction_t committed_transaction; //!< in flash, newer than the single records of its entries
+
 COMMON EEPROM_file_system permanent_data_file;
+COMMON configuration_cache_t configuration_cache;
+COMMON volatile uint32_t configuration_change_count;
 extern Queue <flash_write_order> flash_command_queue;
 
-void FLASH_write( uint32_t * dest, uint32_t * source, unsigned n_words)
+uint64_t getTime_usec(void);
+static void execute_flash_order( const flash_write_order & order);
+static bool transaction_is_staging( void);
+static bool stage_transaction_entry( EEPROM_file_system_node::ID_t id, unsigned size, const void * data);
+static const uint32_t * find_transaction_entry( const EEPROM_transaction_t & transaction, EEPROM_file_system_node::ID_t id, unsigned & size);
+static void prepare_single_record( EEPROM_file_system_node::ID_t id);
+
+//! tickets are issued in queue order, so one counter tells which orders are done
+static bool queue_flash_order( flash_write_order & order, unsigned timeout, flash_write_ticket_t & ticket)
 {
-#if 0 // asynchronous write
-  flash_write_order cmd;
-  bool result;
+  if( not flash_order_lock.lock( timeout))
+    return false;
+  order.enqueue_time_usec = (uint32_t)getTime_usec();
+  bool result = flash_command_queue.send( order, timeout);
+  if( result)
+    ticket = ++flash_orders_issued;
+  flash_order_lock.release();
+  return result;
+}
 
-  while( n_words --)
+static flash_write_ticket_t send_flash_order( flash_write_order & order)
+{
+  flash_write_ticket_t ticket = 0;
+  bool result = queue_flash_order( order, FLASH_ERASE_TIMEOUT, ticket);
+  ASSERT( result);
+  return ticket;
+}
+
+flash_write_ticket_t FLASH_write_async( uint32_t * dest, const uint32_t * source, unsigned n_words)
+{
+  flash_write_order order;
+  flash_write_ticket_t ticket = flash_orders_issued;
+
+  while( n_words > 0)
     {
-    cmd.dest=dest++;
-    cmd.value = *source++;
-    result = flash_command_queue.send( cmd, FLASH_ACCESS_TIMEOUT);
-    ASSERT( result);
+      unsigned batch = n_words < FLASH_WRITE_BATCH_WORDS ? n_words : FLASH_WRITE_BATCH_WORDS;
+      order.dest = dest;
+      order.n_words = batch;
+      for( unsigned i = 0; i < batch; ++i)
+	order.data[i] = source[i];
+      ticket = send_flash_order( order);
+      dest += batch;
+      source += batch;
+      n_words -= batch;
     }
-#else // synchronous write, interrupt-synchronized
-  HAL_StatusTypeDef status;
-  status = HAL_FLASH_Unlock();
-  ASSERT(HAL_OK == status);
+  return ticket;
+}
+
+bool FLASH_write_try_async( uint32_t * dest, const uint32_t * source, unsigned n_words, flash_write_ticket_t & ticket)
+{
+  ASSERT( n_words > 0 && n_words <= FLASH_WRITE_BATCH_WORDS);
+  flash_write_order order;
+  order.dest = dest;
+  order.n_words = n_words;
+  for( unsigned i = 0; i < n_words; ++i)
+    order.data[i] = source[i];
+  return queue_flash_order( order, 0, ticket);
+}
 
-  while( n_words --)
+bool FLASH_write_done( flash_write_ticket_t ticket)
+{
+  return (int32_t)(flash_orders_completed - ticket) >= 0; // wrap-around safe
+}
+
+bool FLASH_write_wait( flash_write_ticket_t ticket, unsigned timeout)
+{
+  // the completion semaphore may be consumed by another waiter: poll it with a short timeout
+  while( not FLASH_write_done( ticket))
     {
-      status = HAL_FLASH_Program_IT( TYPEPROGRAM_WORD, (uint32_t)dest++, *source++);
-      ASSERT( status == HAL_OK);
-      bool no_timeout = flash_isr_to_task.wait( FLASH_ACCESS_TIMEOUT);
-      ASSERT( no_timeout);
+      if( timeout == 0)
+	return false;
+      if( not flash_order_completed.wait( 1))
+	--timeout;
     }
+  return true;
+}
 
-  status = HAL_FLASH_Lock();
-  ASSERT(HAL_OK == status);
-#endif
+//! synchronous write used by the EEPROM file system
+void FLASH_write( uint32_t * dest, uint32_t * source, unsigned n_words)
+{
+  if( xTaskGetCurrentTaskHandle() == flash_writer_task) // page swap: program directly
+    {
+      flash_write_order order;
+      while( n_words > 0)
+	{
+	  unsigned batch = n_words < FLASH_WRITE_BATCH_WORDS ? n_words : FLASH_WRITE_BATCH_WORDS;
+	  order.dest = dest;
+	  order.n_words = batch;
+	  order.enqueue_time_usec = (uint32_t)getTime_usec();
+	  for( unsigned i = 0; i < batch; ++i)
+	    order.data[i] = source[i];
+	  execute_flash_order( order);
+	  dest += batch;
+	  source += batch;
+	  n_words -= batch;
+	}
+      return;
+    }
+
+  unsigned batches = ( n_words + FLASH_WRITE_BATCH_WORDS - 1) / FLASH_WRITE_BATCH_WORDS;
+  flash_write_ticket_t ticket = FLASH_write_async( dest, source, n_words);
+  // a sector erase may be queued in front of us
+  bool no_timeout = FLASH_write_wait( ticket, FLASH_ERASE_TIMEOUT + FLASH_ACCESS_TIMEOUT * batches);
+  ASSERT( no_timeout);
 }
 
 //!< test interface for reading
@@ -58,15 +182,65 @@ bool read_blob( EEPROM_file_system_node::ID_t id, unsigned length_in_words, void
   if( not permanent_data_file.is_consistent())
     return false;
 
+  unsigned size;
+  const uint32_t * entry = find_transaction_entry( committed_transaction, id, size);
+  if( entry && size == length_in_words)
+    {
+      for( unsigned i = 0; i < size; ++i)
+	((uint32_t *)data)[i] = entry[i];
+      return true;
+    }
+
   return permanent_data_file.retrieve_data ( id, length_in_words, (uint32_t *)data);
 }
+//! a synchronous write supersedes a deferred value which has not been committed yet
+static void drop_deferred_parameter( EEPROM_file_system_node::ID_t id)
+{
+  if( deferred_parameter_count == 0)
+    return;
+
+  bool success = deferred_parameter_lock.lock( FLASH_ACCESS_TIMEOUT);
+  ASSERT( success);
+  for( unsigned i = 0; i < deferred_parameter_count; ++i)
+    if( deferred_parameters[i].id == id)
+      {
+	deferred_parameters[i] = deferred_parameters[--deferred_parameter_count];
+	break;
+      }
+  deferred_parameter_lock.release();
+}
+
 //!< test interface for writing
 bool write_blob( EEPROM_file_system_node::ID_t id, unsigned length_in_words, const void * data)
 {
   if( not permanent_data_file.is_consistent())
     return false;
 
-  return permanent_data_file.store_data ( id, length_in_words, (uint32_t *)data);
+  if( transaction_is_staging())
+    return stage_transaction_entry( id, length_in_words, data);
+
+  LOCK_SECTION();
+  drop_deferred_parameter( id);
+  prepare_single_record( id);
+  bool result = permanent_data_file.store_data ( id, length_in_words, (uint32_t *)data);
+  if( result && id < LOWEST_UNUSED_EEPROM_ID && length_in_words == 1)
+    {
+      configuration_cache.value[id] = *(const float *)data;
+      configuration_cache.valid[id] = true;
+      ++configuration_change_count;
+    }
+  return result;
+}
+
+static bool sector_is_erased( unsigned sector)
+{
+  uint64_t * location = sector == 0 ? (uint64_t *)PAGE_0_HEAD : (uint64_t *)PAGE_1_HEAD;
+  unsigned size = SECTOR_SIZE_LONG_WORDS;
+
+  while( size --)
+    if( *location++ != 0xffffffffffffffff)
+      return false;
+  return true;
 }
 
 //!< order sector erase
@@ -76,27 +250,16 @@ bool erase_sector( unsigned sector)
   if( (sector != 0) && (sector != 1))
     return false;
 
-  uint64_t * location = sector == 0 ? (uint64_t *)PAGE_0_HEAD : (uint64_t *)PAGE_1_HEAD;
-  unsigned size = PAGE_SIZE_LONG_WORDS;
-
-  bool is_erased = true;
-  while( size --)
-    {
-    if( *location++ != 0xffffffffffffffff)
-      {
-	is_erased = false;
-	break;
-      }
-    }
-  if( is_erased)
+  if( sector_is_erased( sector))
     return true;
 
   flash_write_order cmd;
-  cmd.dest = (uint32_t *)sector;
-  bool result = flash_command_queue.send( cmd, FLASH_ERASE_TIMEOUT);
-  ASSERT( result);
+  cmd.dest = (uint32_t *)(uintptr_t)sector;
+  cmd.n_words = 0;
+  flash_write_ticket_t ticket = send_flash_order( cmd);
 
-  delay( MAXIMUM_PAGE_ERASE_TIME); // wait longest possible time until ERASE done
+  bool no_timeout = FLASH_write_wait( ticket, MAXIMUM_PAGE_ERASE_TIME + FLASH_ERASE_TIMEOUT);
+  ASSERT( no_timeout);
 
   return true;
 }
@@ -117,7 +280,8 @@ void erase_sector_operation( unsigned sector)
   ASSERT(status == HAL_OK);
 }
 
-float configuration (EEPROM_PARAMETER_ID id)
+//! walks the EEPROM file system chain
+static float read_configuration (EEPROM_PARAMETER_ID id)
 {
   if ( permanent_data_file.in_use())
     {
@@ -142,6 +306,79 @@ float configuration (EEPROM_PARAMETER_ID id)
     }
 }
 
+float configuration (EEPROM_PARAMETER_ID id)
+{
+  if( id < LOWEST_UNUSED_EEPROM_ID && configuration_cache.valid[id])
+    return configuration_cache.value[id];
+  return read_configuration( id);
+}
+
+uint32_t configuration_generation( void)
+{
+  return configuration_change_count;
+}
+
+//! fill the RAM shadow table, one file system search per known parameter
+static void build_configuration_cache( void)
+{
+  uint64_t start = getTime_usec();
+
+  for( unsigned id = 0; id < LOWEST_UNUSED_EEPROM_ID; ++id)
+    configuration_cache.valid[id] = false;
+  configuration_cache.entries = 0;
+
+  for( 	const persistent_data_t * parameter = PERSISTENT_DATA;
+	parameter < PERSISTENT_DATA + PERSISTENT_DATA_ENTRIES;
+	++parameter)
+    {
+      if( parameter->id >= LOWEST_UNUSED_EEPROM_ID)
+	continue;
+
+      float value;
+      uint8_t direct_value;
+      bool found = permanent_data_file.retrieve_data( parameter->id, 1, (uint32_t *)&value);
+      if( not found && permanent_data_file.retrieve_data( parameter->id, direct_value))
+	{
+	  value = (float)direct_value;
+	  found = true;
+	}
+      if( not found)
+	continue; // ensure_EEPROM_parameter_integrity() will write the default
+
+      configuration_cache.value[parameter->id] = value;
+      configuration_cache.valid[parameter->id] = true;
+      ++configuration_cache.entries;
+    }
+
+  // the last multi-parameter update is newer than the single records
+  for( unsigned i = 0; i < committed_transaction.words; i += 1 + ( committed_transaction.data[i] >> 8))
+    {
+      unsigned id = committed_transaction.data[i] & 0xff;
+      if( id >= LOWEST_UNUSED_EEPROM_ID || ( committed_transaction.data[i] >> 8) != 1)
+	continue;
+      if( not configuration_cache.valid[id])
+	++configuration_cache.entries;
+      configuration_cache.value[id] = *(const float *)( committed_transaction.data + i + 1);
+      configuration_cache.valid[id] = true;
+    }
+
+  uint64_t scanned = getTime_usec();
+  configuration_cache.scan_time_usec = (uint32_t)(scanned - start);
+
+  enum { LOOKUPS = 1000 };
+  volatile float sink;
+  for( unsigned i = 0; i < LOOKUPS; ++i)
+    {
+      EEPROM_PARAMETER_ID id = PERSISTENT_DATA[i % PERSISTENT_DATA_ENTRIES].id;
+      if( id < LOWEST_UNUSED_EEPROM_ID && configuration_cache.valid[id])
+	sink = configuration( id);
+    }
+  (void)sink;
+  configuration_cache.lookup_time_nsec = (uint32_t)(( getTime_usec() - scanned) * 1000 / LOOKUPS);
+
+  ++configuration_change_count;
+}
+
 bool file_system_page_swap( void)
 {
   if( permanent_data_file.get_head() == (void *)PAGE_1_HEAD)
@@ -169,16 +406,320 @@ bool file_system_page_swap( void)
 bool write_EEPROM_value (EEPROM_PARAMETER_ID id, float value)
 {
   ASSERT (permanent_data_file.in_use());
+  if( transaction_is_staging())
+    return stage_transaction_entry( id, 1, &value);
+
+  LOCK_SECTION();
+  drop_deferred_parameter( id);
+  prepare_single_record( id);
   bool success = permanent_data_file.store_data( id, 1, &value);
+  if( success && id < LOWEST_UNUSED_EEPROM_ID)
+    {
+      configuration_cache.value[id] = value;
+      configuration_cache.valid[id] = true;
+      ++configuration_change_count;
+    }
   return success;
 }
 
 //!< interface to legacy read function
 bool read_EEPROM_value (EEPROM_PARAMETER_ID id, float &value)
 {
+  if( id < LOWEST_UNUSED_EEPROM_ID && configuration_cache.valid[id]) // may not be committed yet
+    {
+      value = configuration_cache.value[id];
+      return false;
+    }
   return not permanent_data_file.retrieve_data( id, 1, &value);
 }
 
+bool write_EEPROM_value_deferred( EEPROM_PARAMETER_ID id, float value)
+{
+  if( EEPROM_WRITE_BEHIND_DEPTH == 0 || id >= LOWEST_UNUSED_EEPROM_ID || transaction_is_staging())
+    return write_EEPROM_value( id, value);
+
+  bool success = deferred_parameter_lock.lock( FLASH_ACCESS_TIMEOUT);
+  ASSERT( success);
+
+  bool queued = true;
+  unsigned i;
+  for( i = 0; i < deferred_parameter_count; ++i)
+    if( deferred_parameters[i].id == id)
+      break;
+  if( i < deferred_parameter_count) // coalesce
+    {
+      deferred_parameters[i].value = value;
+      ++flash_write_statistics.coalesced_parameters;
+    }
+  else if( deferred_parameter_count < EEPROM_WRITE_BEHIND_DEPTH)
+    {
+      deferred_parameters[deferred_parameter_count].id = id;
+      deferred_parameters[deferred_parameter_count].value = value;
+      ++deferred_parameter_count;
+      ++flash_write_statistics.deferred_parameters;
+    }
+  else
+    queued = false;
+
+  deferred_parameter_lock.release();
+
+  if( not queued) // queue full: commit right now
+    return write_EEPROM_value( id, value);
+
+  configuration_cache.value[id] = value;
+  configuration_cache.valid[id] = true;
+  ++configuration_change_count;
+  return true;
+}
+
+//! write one deferred parameter into the file system, false if none was pending
+static bool commit_deferred_parameter( void)
+{
+  bool success = deferred_parameter_lock.lock( FLASH_ACCESS_TIMEOUT);
+  ASSERT( success);
+  if( deferred_parameter_count == 0)
+    {
+      deferred_parameter_lock.release();
+      return false;
+    }
+  deferred_parameter_t parameter = deferred_parameters[--deferred_parameter_count];
+  deferred_parameter_lock.release();
+
+  // the RAM configuration has already been updated, maybe even by a newer value
+  prepare_single_record( parameter.id);
+  success = permanent_data_file.store_data( parameter.id, 1, &parameter.value);
+  ASSERT( success);
+  return true;
+}
+
+//! EEPROM writer task: commit all deferred parameters unless another task is using the file system
+static void commit_deferred_parameters( void)
+{
+  if( deferred_parameter_count == 0 || not my_mutex.try_lock())
+    return;
+  while( commit_deferred_parameter())
+    ;
+  my_mutex.unlock();
+}
+
+/*! \brief commit the deferred parameters in the calling task
+ *
+ *  Not done by the EEPROM writer: waiting there for the EEPROM lock could deadlock
+ *  with a lock owner waiting for one of its flash orders.
+ */
+bool flush_deferred_EEPROM_values( void)
+{
+  if( deferred_parameter_count == 0)
+    return true;
+  if( not permanent_data_file.in_use())
+    return false;
+
+  LOCK_SECTION(); // blocking, values acknowledged via CAN must survive a planned reset
+  while( commit_deferred_parameter())
+    ;
+  return deferred_parameter_count == 0;
+}
+
+void request_deferred_EEPROM_flush( void)
+{
+  deferred_flush_requested = true;
+}
+
+bool deferred_EEPROM_values_pending( void)
+{
+  return deferred_parameter_count != 0;
+}
+
+//! \return the transaction stage of the calling task or 0
+static transaction_stage_t * own_transaction_stage( void)
+{
+  TaskHandle_t me = xTaskGetCurrentTaskHandle();
+  for( transaction_stage_t * stage = transaction_stages; stage < transaction_stages + EEPROM_TRANSACTION_STAGES; ++stage)
+    if( stage->owner == me)
+      return stage;
+  return 0;
+}
+
+static bool transaction_is_staging( void)
+{
+  return own_transaction_stage() != 0;
+}
+
+//! \return the data of entry id or 0
+static const uint32_t * find_transaction_entry( const EEPROM_transaction_t & transaction, EEPROM_file_system_node::ID_t id, unsigned & size)
+{
+  for( unsigned i = 0; i < transaction.words; i += 1 + ( transaction.data[i] >> 8))
+    if( ( transaction.data[i] & 0xff) == id)
+      {
+	size = transaction.data[i] >> 8;
+	return transaction.data + i + 1;
+      }
+  return 0;
+}
+
+static void remove_transaction_entry( EEPROM_transaction_t & transaction, EEPROM_file_system_node::ID_t id)
+{
+  unsigned size;
+  const uint32_t * entry = find_transaction_entry( transaction, id, size);
+  if( entry == 0)
+    return;
+
+  uint32_t * to = transaction.data + ( entry - 1 - transaction.data);
+  for( const uint32_t * from = entry + size; from < transaction.data + transaction.words; ++from)
+    *to++ = *from;
+  transaction.words -= size + 1;
+}
+
+//! \return false if there is no room left, one word is reserved for the commit marker
+static bool add_transaction_entry( EEPROM_transaction_t & transaction, EEPROM_file_system_node::ID_t id, unsigned size, const uint32_t * data)
+{
+  remove_transaction_entry( transaction, id);
+  if( size > 0xff || transaction.words + 1 + size >= EEPROM_TRANSACTION_WORDS)
+    return false;
+
+  transaction.data[transaction.words++] = TRANSACTION_ENTRY( id, size);
+  for( unsigned i = 0; i < size; ++i)
+    transaction.data[transaction.words++] = data[i];
+  return true;
+}
+
+static bool stage_transaction_entry( EEPROM_file_system_node::ID_t id, unsigned size, const void * data)
+{
+  transaction_stage_t * stage = own_transaction_stage();
+  if( not add_transaction_entry( stage->staged, id, size, (const uint32_t *)data))
+    stage->overflow = true;
+  return not stage->overflow;
+}
+
+//! write the committed transaction as single records and retire it by an empty transaction record
+static void fold_committed_transaction( void)
+{
+  LOCK_SECTION();
+  if( committed_transaction.words == 0)
+    return;
+
+  bool success;
+  for( unsigned i = 0; i < committed_transaction.words; i += 1 + ( committed_transaction.data[i] >> 8))
+    {
+      success = permanent_data_file.store_data( committed_transaction.data[i] & 0xff, committed_transaction.data[i] >> 8, committed_transaction.data + i + 1);
+      ASSERT( success);
+    }
+
+  committed_transaction.words = 0;
+  uint32_t commit_marker = EEPROM_TRANSACTION_COMMIT;
+  success = permanent_data_file.store_data( EEPROM_TRANSACTION_ID, 1, &commit_marker);
+  ASSERT( success);
+}
+
+//! a single record must not be older than the committed transaction if that one contains it too
+static void prepare_single_record( EEPROM_file_system_node::ID_t id)
+{
+  unsigned size;
+  if( committed_transaction.words > 0 && find_transaction_entry( committed_transaction, id, size))
+    fold_committed_transaction();
+}
+
+//! take over the transaction record found in flash, if it is complete
+static void load_committed_transaction( void)
+{
+  committed_transaction.words = 0;
+  EEPROM_file_system_node * node = permanent_data_file.find_datum( EEPROM_TRANSACTION_ID);
+  if( node == 0 || node->size < 2 || node->size - 1u > EEPROM_TRANSACTION_WORDS)
+    return;
+
+  unsigned words = node->size - 1;
+  if( not permanent_data_file.retrieve_data( EEPROM_TRANSACTION_ID, words, committed_transaction.data)
+      || committed_transaction.data[words - 1] != EEPROM_TRANSACTION_COMMIT)
+    return;
+
+  unsigned i = 0;
+  while( i < words - 1)
+    i += 1 + ( committed_transaction.data[i] >> 8);
+  if( i == words - 1) // entries are well-formed
+    committed_transaction.words = words - 1;
+}
+
+void begin_EEPROM_transaction( void)
+{
+  ASSERT( not transaction_is_staging()); // no nesting
+
+  bool success = transaction_stage_lock.lock( FLASH_ACCESS_TIMEOUT);
+  ASSERT( success);
+  transaction_stage_t * stage = transaction_stages;
+  while( stage < transaction_stages + EEPROM_TRANSACTION_STAGES && stage->owner != 0)
+    ++stage;
+  ASSERT( stage < transaction_stages + EEPROM_TRANSACTION_STAGES); // increase EEPROM_TRANSACTION_STAGES
+  stage->staged.words = 0;
+  stage->overflow = false;
+  stage->owner = xTaskGetCurrentTaskHandle();
+  transaction_stage_lock.release();
+}
+
+static void release_transaction_stage( transaction_stage_t * stage)
+{
+  stage->staged.words = 0;
+  stage->overflow = false;
+  stage->owner = 0;
+}
+
+bool commit_EEPROM_transaction( void)
+{
+  transaction_stage_t * stage = own_transaction_stage();
+  ASSERT( stage);
+  EEPROM_transaction_t & staged_transaction = stage->staged;
+  bool success = not stage->overflow;
+
+  if( success && staged_transaction.words > 0)
+    {
+      LOCK_SECTION(); // held for the store only, not while the entries are being collected
+
+      // the entries of the previous transaction are carried over if there is room, else they are folded
+      unsigned staged_words = staged_transaction.words;
+      unsigned carried_words = 0;
+      unsigned size;
+      for( unsigned i = 0; i < committed_transaction.words; i += 1 + ( committed_transaction.data[i] >> 8))
+	if( not find_transaction_entry( staged_transaction, committed_transaction.data[i] & 0xff, size))
+	  carried_words += 1 + ( committed_transaction.data[i] >> 8);
+
+      if( staged_transaction.words + carried_words >= EEPROM_TRANSACTION_WORDS)
+	fold_committed_transaction();
+      else
+	for( unsigned i = 0; i < committed_transaction.words; i += 1 + ( committed_transaction.data[i] >> 8))
+	  if( not find_transaction_entry( staged_transaction, committed_transaction.data[i] & 0xff, size))
+	    (void) add_transaction_entry( staged_transaction, committed_transaction.data[i] & 0xff,
+					  committed_transaction.data[i] >> 8, committed_transaction.data + i + 1);
+
+      // one record: the update becomes valid with the record, completely or not at all
+      staged_transaction.data[staged_transaction.words] = EEPROM_TRANSACTION_COMMIT;
+      success = permanent_data_file.store_data( EEPROM_TRANSACTION_ID, staged_transaction.words + 1, staged_transaction.data);
+      if( success)
+	{
+	  committed_transaction = staged_transaction;
+	  for( unsigned i = 0; i < staged_words; i += 1 + ( committed_transaction.data[i] >> 8)) // not the carried ones
+	    {
+	      EEPROM_file_system_node::ID_t id = committed_transaction.data[i] & 0xff;
+	      drop_deferred_parameter( id); // the transaction is newer
+	      if( id < LOWEST_UNUSED_EEPROM_ID && ( committed_transaction.data[i] >> 8) == 1)
+		{
+		  configuration_cache.value[id] = *(const float *)( committed_transaction.data + i + 1);
+		  configuration_cache.valid[id] = true;
+		}
+	    }
+	  ++configuration_change_count;
+	}
+    }
+
+  release_transaction_stage( stage);
+  return success;
+}
+
+void abort_EEPROM_transaction( void)
+{
+  transaction_stage_t * stage = own_transaction_stage();
+  ASSERT( stage);
+  release_transaction_stage( stage);
+}
+
 bool import_raw_EEPROM_data( EEPROM_PARAMETER_ID id, uint32_t * flash_address, unsigned size_words, uint16_t &datum)
 {
   if( *(uint16_t *)flash_address == 0xEEEE) // dirty flash segment
@@ -238,7 +779,40 @@ static bool import_legacy_EEPROM_data( uint32_t * flash_address, unsigned size_w
   return result;
 }
 
-void recover_and_initialize_flash( void)
+//! used words of a page and the erased words found in between
+static unsigned page_fill_words( uint32_t * head, unsigned & holes)
+{
+  unsigned used = 0;
+  holes = 0;
+  for( unsigned i = 0; i < PAGE_SIZE_WORDS; ++i)
+    if( head[i] != 0xffffffff)
+      used = i + 1;
+  for( unsigned i = 0; i < used; ++i)
+    if( head[i] == 0xffffffff)
+      ++holes;
+  return used;
+}
+
+/*! \brief both pages contain data: a page copy has been interrupted by a power failure
+ *
+ *  Copying onto the spare page leaves the source complete and fuller than the copy.
+ *  An interrupted sector erase leaves erased words all over the page.
+ *  \return the sector to be discarded
+ */
+static unsigned obsolete_page_copy( void)
+{
+  unsigned holes_0, holes_1;
+  unsigned used_0 = page_fill_words( PAGE_0_HEAD, holes_0);
+  unsigned used_1 = page_fill_words( PAGE_1_HEAD, holes_1);
+  bool erasing_0 = holes_0 > used_0 / 8;
+  bool erasing_1 = holes_1 > used_1 / 8;
+
+  if( erasing_0 != erasing_1)
+    return erasing_0 ? 0 : 1;
+  return used_0 >= used_1 ? 1 : 0;
+}
+
+static void recover_flash( void)
 {
   if( *(uint16_t *)0x080F8000 == 0 && *(int64_t *)0x080E0000 == -1) // old flash layout
     {
@@ -265,6 +839,16 @@ void recover_and_initialize_flash( void)
       erase_sector( 1); // now we clean the upper sector from the old data
       return; // job done
     }
+  else if( *(int32_t *)PAGE_1_HEAD != -1 && *(int32_t *)PAGE_0_HEAD != -1) // interrupted page copy or old page not yet erased
+    {
+      if( *PAGE_OBSOLETE_MARK( 0) == 0)
+	erase_sector( 0);
+      else if( *PAGE_OBSOLETE_MARK( 1) == 0)
+	erase_sector( 1);
+      else
+	erase_sector( obsolete_page_copy());
+      recover_flash(); // only one page holds data now
+    }
   else if( *(int32_t *)PAGE_1_HEAD != -1) // check for file system on page 1
     {
       bool success = permanent_data_file.set_memory_to_existing_data( PAGE_1_HEAD, PAGE_1_HEAD+PAGE_SIZE_WORDS);
@@ -319,6 +903,161 @@ void recover_and_initialize_flash( void)
     }
 }
 
+void recover_and_initialize_flash( void)
+{
+  LOCK_SECTION();
+  flash_recovery_done = false;
+  recover_flash();
+  load_committed_transaction();
+  build_configuration_cache();
+  flash_recovery_done = true;
+}
+
+//! program one batch back-to-back, the flash is busy (and stalls code fetch) for this time only
+static void program_flash_batch( const flash_write_order & order)
+{
+  uint32_t * dest = order.dest;
+  for( unsigned i = 0; i < order.n_words; ++i)
+    {
+      HAL_StatusTypeDef status = HAL_FLASH_Program( TYPEPROGRAM_WORD, (uint32_t)(uintptr_t)dest++, order.data[i]);
+      ASSERT( status == HAL_OK);
+    }
+}
+
+bool begin_flash_session( unsigned timeout)
+{
+  if( not flash_session_lock.lock( timeout))
+    return false;
+  if( HAL_OK == HAL_FLASH_Unlock())
+    return true;
+  flash_session_lock.release();
+  return false;
+}
+
+void end_flash_session( void)
+{
+  HAL_StatusTypeDef status = HAL_FLASH_Lock();
+  ASSERT(HAL_OK == status);
+  flash_session_lock.release();
+}
+
+//! unlocked session for one order, called by the EEPROM writer task only
+static void execute_flash_order( const flash_write_order & order)
+{
+  // a software update may be erasing one of its 128 KB sectors
+  bool success = begin_flash_session( MAXIMUM_PAGE_ERASE_TIME + FLASH_ERASE_TIMEOUT);
+  ASSERT( success);
+
+  if( order.n_words == 0) // erase commmand
+    {
+      erase_sector_operation( (unsigned)(uintptr_t)(order.dest));
+      bool no_timeout = flash_isr_to_task.wait( FLASH_ERASE_TIMEOUT);
+      ASSERT( no_timeout);
+      ++flash_write_statistics.erases;
+    }
+  else
+    {
+      uint32_t start = (uint32_t)getTime_usec();
+      program_flash_batch( order);
+      uint32_t program_time = (uint32_t)getTime_usec() - start;
+
+      ++flash_write_statistics.orders;
+      flash_write_statistics.words += order.n_words;
+      flash_write_statistics.total_program_time_usec += program_time;
+      if( program_time > flash_write_statistics.max_program_time_usec)
+	flash_write_statistics.max_program_time_usec = program_time;
+      if( order.n_words > flash_write_statistics.max_batch_words)
+	flash_write_statistics.max_batch_words = order.n_words;
+    }
+
+  end_flash_session();
+
+  uint32_t latency = (uint32_t)getTime_usec() - order.enqueue_time_usec;
+  if( latency > flash_write_statistics.max_latency_usec)
+    flash_write_statistics.max_latency_usec = latency;
+}
+
+/*! \brief background work of the EEPROM writer: deferred parameters and compaction
+ *
+ *  Deferred parameter changes are committed as soon as the aircraft is on the ground,
+ *  already after the landing: programming a few words takes microseconds.
+ *
+ *  The slow part of a page swap is erasing the 128 KB sectors.
+ *  The spare sector is erased ahead of time, one erase per step,
+ *  while queued orders are served in between.
+ *  When the active page runs full the live records are copied into the spare page
+ *  and the file system is switched over under the EEPROM lock,
+ *  so readers see either the old or the new page, both complete.
+ *  Before the lock is released the old page gets its obsolete mark, a single word,
+ *  telling recover_flash() which page is up to date. It is erased in a later step,
+ *  it is the next spare page.
+ *  Nothing of this is done while the background work is inhibited (not ground idle).
+ */
+static void background_step( void)
+{
+  static bool spare_page_erased = false; // EEPROM writer task private
+
+  if( not flash_recovery_done || not permanent_data_file.in_use())
+    return;
+
+  if( not deferred_commits_inhibited || deferred_flush_requested)
+    commit_deferred_parameters();
+
+  if( flash_background_work_inhibited)
+    return;
+
+  unsigned spare_sector = permanent_data_file.get_head() == (void *)PAGE_1_HEAD ? 0 : 1;
+
+  if( not spare_page_erased)
+    {
+      if( not sector_is_erased( spare_sector))
+	{
+	  flash_write_order order;
+	  order.dest = (uint32_t *)(uintptr_t)spare_sector;
+	  order.n_words = 0;
+	  order.enqueue_time_usec = (uint32_t)getTime_usec();
+	  execute_flash_order( order);
+	}
+      spare_page_erased = true;
+      return;
+    }
+
+  if( permanent_data_file.get_remaining_space_words() >= EEPROM_PAGE_SWAP_THRESHOLD_WORDS)
+    return;
+
+  if( not my_mutex.try_lock()) // a writer is active, try again later
+    return;
+
+  uint32_t * head = spare_sector == 0 ? PAGE_0_HEAD : PAGE_1_HEAD;
+  EEPROM_file_system new_data_file( (EEPROM_file_system_node *)head, (EEPROM_file_system_node *)(head+PAGE_SIZE_WORDS));
+  new_data_file.import_all_data( permanent_data_file);
+  bool success = permanent_data_file.set_memory_to_existing_data( head, head+PAGE_SIZE_WORDS);
+  ASSERT( success);
+  ++flash_write_statistics.page_swaps;
+
+  // mark the old page before anything is written to the new one,
+  // otherwise recover_flash() could not tell which one is up to date
+  flash_write_order order;
+  order.dest = PAGE_OBSOLETE_MARK( 1 - spare_sector);
+  order.n_words = 1;
+  order.data[0] = 0;
+  order.enqueue_time_usec = (uint32_t)getTime_usec();
+  execute_flash_order( order);
+
+  my_mutex.unlock(); // deferred parameters have been kept in RAM meanwhile
+  spare_page_erased = false; // the old page, erased by one of the next steps
+}
+
+void inhibit_flash_background_work( bool inhibit)
+{
+  flash_background_work_inhibited = inhibit;
+}
+
+void inhibit_deferred_EEPROM_commits( bool inhibit)
+{
+  deferred_commits_inhibited = inhibit;
+}
+
 static void EEPROM_writing_runnable( void *)
 {
   uint32_t prioritygroup = NVIC_GetPriorityGrouping ();
@@ -327,42 +1066,28 @@ static void EEPROM_writing_runnable( void *)
 		    NVIC_EncodePriority (prioritygroup, STANDARD_ISR_PRIORITY, 0));
   NVIC_EnableIRQ ((IRQn_Type) FLASH_IRQn);
 
+  flash_writer_task = xTaskGetCurrentTaskHandle();
+
   flash_write_order order;
-  bool no_timeout;
   while( true)
     {
-      flash_command_queue.receive( order, INFINITE_WAIT);
-
-      HAL_StatusTypeDef status;
-      status = HAL_FLASH_Unlock();
-      ASSERT(HAL_OK == status);
-
-      if( order.dest == 0) // erase commmand
+      if( flash_command_queue.receive( order, EEPROM_PAGE_SWAP_STEP_INTERVAL))
 	{
-	  erase_sector_operation( 0);
-	  no_timeout = flash_isr_to_task.wait( FLASH_ERASE_TIMEOUT);
-	  ASSERT( no_timeout);
-	}
-      else if( order.dest == (uint32_t *)1)
-	{
-	  erase_sector_operation( 1);
-	  no_timeout = flash_isr_to_task.wait( FLASH_ERASE_TIMEOUT);
-	  ASSERT( no_timeout);
+	  execute_flash_order( order);
+	  ++flash_orders_completed;
+	  flash_order_completed.signal();
 	}
       else
-	{
-	  status = HAL_FLASH_Program_IT( TYPEPROGRAM_WORD, (uint32_t)(order.dest), order.value);
-	  ASSERT( status == HAL_OK);
-	  no_timeout = flash_isr_to_task.wait( FLASH_ERASE_TIMEOUT);
-	  ASSERT( no_timeout);
-	}
+	background_step(); // idle: deferred writes and compaction
 
-      status = HAL_FLASH_Lock();
-      ASSERT(HAL_OK == status);
+      // page swap and deferred commits run the file system on this stack
+      flash_write_statistics.stack_free_words = uxTaskGetStackHighWaterMark( 0);
     }
 }
 
-#define STACKSIZE 128
+// page swap and deferred commits run the file system here: 654 words used on the host (x86-64),
+// see eeprom_fuzzer, the firmware reports flash_write_statistics.stack_free_words
+#define STACKSIZE 1024
 static uint32_t __ALIGNED(STACKSIZE*sizeof(uint32_t)) stack_buffer[STACKSIZE];
 
 static ROM TaskParameters_t p =
@@ -2,13 +2,98 @@
 #define CUSTOM_EEPROM_DATA_FILE_IMPLEMENTATION_H_
 
 #include "persistent_data_file.h"
+#include "system_configuration.h"
 
+//! one job for the EEPROM writer task: program a batch of words or erase a sector
 typedef struct
 {
-  uint32_t * dest;
-  uint32_t value;
+  uint32_t * dest;	//!< flash address, sector number 0 or 1 for an erase order
+  uint32_t n_words;	//!< 0: erase sector
+  uint32_t enqueue_time_usec;
+  uint32_t data[FLASH_WRITE_BATCH_WORDS];
 } flash_write_order;
 
+//! completion handle of an asynchronous flash order
+typedef uint32_t flash_write_ticket_t;
+
+//! EEPROM writer performance, readable at any time
+typedef struct
+{
+  uint32_t orders;		//!< batches programmed
+  uint32_t words;		//!< words programmed
+  uint32_t erases;		//!< sectors erased
+  uint32_t max_batch_words;	//!< largest batch programmed in one unlocked session
+  uint32_t max_program_time_usec; //!< longest flash busy period = instruction fetch stall for all tasks
+  uint32_t total_program_time_usec;
+  uint32_t max_latency_usec;	//!< longest time from ordering to completion
+  uint32_t page_swaps;		//!< background compactions
+  uint32_t deferred_parameters;	//!< parameter changes queued for write-behind
+  uint32_t coalesced_parameters; //!< changes that replaced a still pending value
+  uint32_t stack_free_words;	//!< EEPROM writer stack words never used (high-water mark)
+} flash_write_statistics_t;
+
+extern flash_write_statistics_t flash_write_statistics;
+
+//! RAM shadow of the EEPROM parameters, built at boot, updated by every parameter write
+typedef struct
+{
+  float value[LOWEST_UNUSED_EEPROM_ID];
+  bool valid[LOWEST_UNUSED_EEPROM_ID];
+  uint32_t entries;		//!< parameters found during the boot scan
+  uint32_t scan_time_usec;	//!< boot scan of the EEPROM file system
+  uint32_t lookup_time_nsec;	//!< one cached configuration() lookup
+} configuration_cache_t;
+
+extern configuration_cache_t configuration_cache;
+
+//! incremented by every parameter change, compare to detect changes cheaply
+uint32_t configuration_generation( void);
+
+//! queue a flash write, words are copied, split into batches if necessary
+flash_write_ticket_t FLASH_write_async( uint32_t * dest, const uint32_t * source, unsigned n_words);
+//! queue one batch without waiting, \return false if the EEPROM writer is busy, try again later
+bool FLASH_write_try_async( uint32_t * dest, const uint32_t * source, unsigned n_words, flash_write_ticket_t & ticket);
+//! true if the order with this ticket (and all before) has been executed
+bool FLASH_write_done( flash_write_ticket_t ticket);
+//! wait for the completion of an asynchronous order
+bool FLASH_write_wait( flash_write_ticket_t ticket, unsigned timeout);
+
+/*! \brief exclusive use of the flash controller for one program or erase session
+ *
+ *  The controller unlock, the HAL process lock and the interrupt driven erase
+ *  are shared by all flash users: the EEPROM writer and the software update.
+ *  A session unlocks the controller, end_flash_session() locks it again.
+ *  \return false if another session did not end within the timeout
+ */
+bool begin_flash_session( unsigned timeout);
+void end_flash_session( void);
+
+//! postpone background sector erases and page swaps, e.g. while not in ground idle
+void inhibit_flash_background_work( bool inhibit);
+//! postpone deferred parameter commits, e.g. while flying
+void inhibit_deferred_EEPROM_commits( bool inhibit);
+
+//! update the RAM configuration now, commit to flash later (write-behind)
+bool write_EEPROM_value_deferred( EEPROM_PARAMETER_ID id, float value);
+//! commit all deferred parameter changes, call before a planned reset, blocks on the EEPROM lock
+bool flush_deferred_EEPROM_values( void);
+//! non-blocking alternative: the EEPROM writer commits them when idle, even while commits are inhibited
+void request_deferred_EEPROM_flush( void);
+bool deferred_EEPROM_values_pending( void);
+
+/*! \brief multi-parameter update, all or nothing
+ *
+ *  write_EEPROM_value() and write_blob() calls of the calling task are collected
+ *  in RAM until commit_EEPROM_transaction() stores them as one file system record,
+ *  which is programmed in one burst. Collecting the entries needs no EEPROM lock,
+ *  other tasks keep reading and writing parameters meanwhile,
+ *  the lock is taken by the commit only. The values become visible with the commit.
+ */
+void begin_EEPROM_transaction( void);
+//! \return false if the entries did not fit or could not be stored, nothing has changed then
+bool commit_EEPROM_transaction( void);
+void abort_EEPROM_transaction( void);
+
 void recover_and_initialize_flash( void);
 bool read_blob( EEPROM_file_system_node::ID_t id, unsigned length_in_words, void * data);
 bool write_blob( EEPROM_file_system_node::ID_t id, unsigned length_in_words, const void * data);
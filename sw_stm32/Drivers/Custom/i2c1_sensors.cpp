@@ -29,6 +29,7 @@
 #include "common.h"
 #include "communicator.h"
 #include "system_state.h"
+#include "boot_timeline.h"
 
 #define I2C_ADDRESS (0x28<<1) // 7 bits left-adjusted
 /*
@@ -64,6 +65,7 @@ restart:
 	  uint16_t raw_data = (data[0] << 8) | data[1];
 	  observations.pitot_pressure = ((float) (raw_data - OFFSET) * SPAN);
 	  update_system_state_set (PITOT_SENSOR_AVAILABLE);
+	  boot_milestone (BOOT_PITOT_PRESSURE_READY);
 	}
       else
 	{
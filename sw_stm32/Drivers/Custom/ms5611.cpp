@@ -220,15 +220,6 @@ inline uint16_t MS5611::read_coef (uint8_t coef_num)
 	return (Buffer_Rx[0] << 8) + Buffer_Rx[1];
 }
 
-inline uint32_t MS5611::getRawDx (uint8_t cmd)
-{
-	uint8_t reg = CMD_ADC_CONV | cmd;
-	I2C_Write (MS5611_I2C, I2C_address, &reg, 1);
-	vTaskDelay (10);
-
-	return read_24_bits ();
-}
-
 bool MS5611::initialize (void)
 {
 	uint8_t reg = CMD_RESET;
@@ -243,20 +234,21 @@ bool MS5611::initialize (void)
 		uint8_t uc_CRC = get_crc4 ();
 		ASSERT(uc_CRC == us_expectedCRC);
 
+		// conversion time @ OSR 4096: 9.04 ms max.
 		if(true == start_temperature_conversion ())
 		{
-			vTaskDelay (15);
-			ADC_temperature_reading = getRawDx (CMD_ADC_D2 | CMD_ADC_4096);
+			vTaskDelay (10);
+			ADC_temperature_reading = read_24_bits ();
 
 			if(true == start_pressure_conversion ())
 			{
-				vTaskDelay (15);
-				ADC_pressure_reading = getRawDx (CMD_ADC_D1 | CMD_ADC_4096);
+				vTaskDelay (10);
+				ADC_pressure_reading = read_24_bits ();
 				calibrate (ADC_pressure_reading, ADC_temperature_reading);
 				if (true == start_temperature_conversion ())
 				{
 					measure_temperature = true;
-					vTaskDelay (15);
+					vTaskDelay (10);
 					return true;
 				}
 			}
@@ -33,7 +33,6 @@ private:
   inline uint8_t get_crc4 ();
   inline void calibrate( const uint32_t D1, const uint32_t D2);
   inline uint32_t read_24_bits();
-  inline uint32_t getRawDx (uint8_t cmd);
 
 
   uint8_t I2C_address; //!< I2C address
@@ -30,12 +30,13 @@
 #include "common.h"
 #include "communicator.h"
 #include "system_state.h"
+#include "boot_timeline.h"
 
 #if RUN_MS5611_MODULE == 1
 
 void getPressure (void*)
 {
-  delay (123); // de-synchronize task start
+  delay (3); // de-synchronize from the other 10 ms sensor loops
 
   while (true) // re-initialization loop
     {
@@ -74,6 +75,7 @@ void getPressure (void*)
 	      observations.static_pressure = ms5611_static.get_pressure ();
 	      observations.static_sensor_temperature =
 		  ms5611_static.get_temperature ();
+	      boot_milestone (BOOT_STATIC_PRESSURE_READY);
 	    }
 	}
     }
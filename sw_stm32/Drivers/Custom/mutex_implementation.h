@@ -6,20 +6,33 @@
 
 extern Mutex EEPROM_lock;
 
+//! recursive lock for the EEPROM file system
 class Mutex_Wrapper_Type
 {
 public:
   Mutex_Wrapper_Type( void)
-  : lock_count(0)
+  : lock_count(0),
+    owner(0)
   {}
 
   void lock( void)
   {
-    bool success;
-    if( lock_count == 0)
-      success = EEPROM_lock.lock(2000); // todo patch check time
+    bool success = try_lock( 2000); // todo patch check time
     ASSERT( success);
+  }
+
+  //! \return false if another task holds the lock
+  bool try_lock( unsigned timeout = 0)
+  {
+    TaskHandle_t me = xTaskGetCurrentTaskHandle();
+    if( owner != me)
+      {
+	if( not EEPROM_lock.lock( timeout))
+	  return false;
+	owner = me;
+      }
     ++lock_count;
+    return true;
   }
 
   void unlock( void)
@@ -27,10 +40,14 @@ public:
     ASSERT( lock_count > 0);
         --lock_count;
     if( lock_count == 0)
-      EEPROM_lock.release();
+      {
+	owner = 0;
+	EEPROM_lock.release();
+      }
   }
 private:
   unsigned lock_count;
+  TaskHandle_t owner;
 };
 
 #include "scoped_lock.h"
@@ -0,0 +1,191 @@
+/** *****************************************************************************
+ * @file    	FreeRTOS_wrapper.h
+ * @brief   	host replacement of the FreeRTOS C++ wrapper using threads
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef HOST_FREERTOS_WRAPPER_H_
+#define HOST_FREERTOS_WRAPPER_H_
+
+// this file shadows Core/Inc/FreeRTOS_wrapper.h when building on the host
+// only the subset used by the EEPROM file system driver is provided
+// tasks are threads, they are started by host_start_tasks()
+// each task finds a painted stack of HOST_TASK_STACK_WORDS below its entry
+// one tick lasts host_tick_usec microseconds (1000 on the target)
+
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "my_assert.h"
+#include "embedded_memory.h"
+#include "common.h"
+
+#define STANDARD_TASK_PRIORITY	3
+#define INFINITE_WAIT		0xffffffff
+#define portPRIVILEGE_BIT	0x80000000
+#define portMPU_REGION_READ_WRITE 0
+#define portMPU_REGION_READ_ONLY 0
+#define portNUM_CONFIGURABLE_REGIONS 3
+#define HOST_TASK_STACK_WORDS	0x4000
+
+typedef void * TaskHandle_t;
+typedef void ( *TaskFunction_t)( void *);
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+typedef uint32_t UBaseType_t;
+
+typedef struct
+{
+  void * pvBaseAddress;
+  uint32_t ulLengthInBytes;
+  uint32_t ulParameters;
+} MemoryRegion_t;
+
+typedef struct
+{
+  TaskFunction_t pvTaskCode;
+  const char * pcName;
+  uint16_t usStackDepth;
+  void * pvParameters;
+  uint32_t uxPriority;
+  StackType_t * puxStackBuffer;
+  MemoryRegion_t xRegions[portNUM_CONFIGURABLE_REGIONS];
+} TaskParameters_t;
+
+extern unsigned host_tick_usec;
+
+//! deadline for a FreeRTOS timeout in ticks
+inline std::chrono::steady_clock::time_point host_deadline( unsigned ticks)
+{
+  if( ticks == INFINITE_WAIT)
+    return std::chrono::steady_clock::time_point::max();
+  return std::chrono::steady_clock::now() + std::chrono::microseconds( (uint64_t)ticks * host_tick_usec);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void);
+//! words of the painted stack never used, the calling task only (task = 0)
+UBaseType_t uxTaskGetStackHighWaterMark( TaskHandle_t task);
+void delay( TickType_t time);
+
+//! register a task, it runs as soon as host_start_tasks() is called
+void host_register_task( TaskFunction_t code, void * parameters);
+//! start all registered tasks as detached threads with painted stacks
+void host_start_tasks( void);
+
+template <class items> class Queue
+{
+public:
+  Queue( unsigned length, const char * = 0)
+  : capacity( length)
+  {}
+  bool send( const items & item, unsigned TicksToWait = INFINITE_WAIT)
+  {
+    std::unique_lock<std::mutex> lock( guard);
+    if( not changed.wait_until( lock, host_deadline( TicksToWait), [this]{ return content.size() < capacity; }))
+      return false;
+    content.push_back( item);
+    changed.notify_all();
+    return true;
+  }
+  bool receive( items & item, unsigned TicksToWait = INFINITE_WAIT)
+  {
+    std::unique_lock<std::mutex> lock( guard);
+    if( not changed.wait_until( lock, host_deadline( TicksToWait), [this]{ return not content.empty(); }))
+      return false;
+    item = content.front();
+    content.pop_front();
+    changed.notify_all();
+    return true;
+  }
+private:
+  unsigned capacity;
+  std::deque<items> content;
+  std::mutex guard;
+  std::condition_variable changed;
+};
+
+class Semaphore
+{
+public:
+  Semaphore( unsigned max_count = 1, unsigned init_count = 0, char * = 0)
+  : count( init_count), max( max_count)
+  {}
+  bool signal( void)
+  {
+    std::lock_guard<std::mutex> lock( guard);
+    if( count >= max)
+      return false;
+    ++count;
+    changed.notify_one();
+    return true;
+  }
+  void signal_from_ISR( void)
+  {
+    (void) signal();
+  }
+  bool wait( unsigned TicksToWait = INFINITE_WAIT)
+  {
+    std::unique_lock<std::mutex> lock( guard);
+    if( not changed.wait_until( lock, host_deadline( TicksToWait), [this]{ return count > 0; }))
+      return false;
+    --count;
+    return true;
+  }
+private:
+  unsigned count, max;
+  std::mutex guard;
+  std::condition_variable changed;
+};
+
+class Mutex
+{
+public:
+  Mutex( char * = 0)
+  {}
+  bool lock( unsigned TicksToWait = INFINITE_WAIT)
+  {
+    return the_mutex.try_lock_until( host_deadline( TicksToWait));
+  }
+  void release( void)
+  {
+    the_mutex.unlock();
+  }
+  void unlock( void)
+  {
+    the_mutex.unlock();
+  }
+private:
+  std::timed_mutex the_mutex;
+};
+
+class RestrictedTask
+{
+public:
+  RestrictedTask( const TaskParameters_t & p, bool = false)
+  {
+    host_register_task( p.pvTaskCode, p.pvParameters);
+  }
+};
+
+#endif /* HOST_FREERTOS_WRAPPER_H_ */
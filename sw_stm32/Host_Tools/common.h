@@ -0,0 +1,36 @@
+/** *****************************************************************************
+ * @file    	common.h
+ * @brief   	host replacement of the COMMON memory region definitions
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef HOST_COMMON_H
+#define HOST_COMMON_H
+
+// this file shadows Core/Inc/common.h when building on the host
+// there is no MPU, so the COMMON region is just ordinary memory
+
+#include "embedded_memory.h"
+
+#define COMMON_SIZE 0
+#define COMMON_BLOCK 0
+
+#endif
@@ -0,0 +1,596 @@
+/** *****************************************************************************
+ * @file    	eeprom_fuzzer.cpp
+ * @brief   	power failure fuzzer for the EEPROM file system driver
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+// Runs Drivers/Custom/EEPROM_data_file_implementation.cpp unchanged against
+// simulated_flash. Every boot cycle is a forked child process: it recovers the
+// file system like uSD_handler_runnable does, checks the parameters, writes
+// random parameter changes and dies at the scheduled power cut or ends with a
+// clean shutdown. The sensor orientation is written as one transaction, like
+// communicator_runnable does it, and must never be found torn. The flash and the expected parameter values live in shared
+// memory and survive the child. Several workers fuzz independent flash images
+// in parallel.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <chrono>
+#include <vector>
+
+#include "system_configuration.h"
+#include "FreeRTOS_wrapper.h"
+#include "host_support.h"
+#include "simulated_flash.h"
+#include "EEPROM_data_file_implementation.h"
+
+#define ASSERTION_EXIT		78
+#define MAX_CANDIDATES		8
+#define CYCLE_TIMEOUT_S		10
+#define LEGACY_EEPROM_DATA	0x080F8000
+#define WORD_PROGRAM_TYP_USEC	16 // STM32F407 data sheet, 32-bit parallelism
+#define WORD_PROGRAM_MAX_USEC	100
+
+extern EEPROM_file_system permanent_data_file; // EEPROM_data_file_implementation.cpp
+
+//! what the flash may contain for each parameter
+typedef struct
+{
+  bool known[LOWEST_UNUSED_EEPROM_ID];	//!< acknowledged value valid
+  float acknowledged[LOWEST_UNUSED_EEPROM_ID]; //!< last value whose write has returned
+  unsigned candidate_count[LOWEST_UNUSED_EEPROM_ID]; //!< > MAX_CANDIDATES: anything goes
+  float candidates[LOWEST_UNUSED_EEPROM_ID][MAX_CANDIDATES]; //!< written, not acknowledged
+  bool pending[LOWEST_UNUSED_EEPROM_ID]; //!< deferred write not flushed yet
+  float pending_value[LOWEST_UNUSED_EEPROM_ID];
+} parameter_model_t;
+
+typedef struct
+{
+  uint64_t cycles;
+  uint64_t power_cuts;
+  uint64_t clean_shutdowns;
+  uint64_t assertions;
+  uint64_t crashes;
+  uint64_t hangs;
+  uint64_t lost_values;		//!< neither the acknowledged value nor one in flight
+  uint64_t torn_transactions;	//!< sensor orientation from different updates
+  uint64_t recoveries;
+  uint64_t recovery_time_total_usec;
+  uint64_t recovery_time_max_usec;
+  uint64_t writes;
+  uint64_t writer_stack_used_words; //!< deepest EEPROM writer stack seen, host ABI
+  char first_failure[160];
+  parameter_model_t model;
+  simulated_flash_state_t flash;
+} worker_result_t;
+
+typedef struct
+{
+  uint64_t cycles;
+  unsigned max_operations;
+  unsigned power_cut_percent;
+  unsigned deferred_percent;
+  uint64_t seed;
+  bool legacy_start;
+  bool verbose;
+} fuzzer_options_t;
+
+static worker_result_t * result; // of the worker running in this process
+
+static uint64_t next_random( uint64_t & x)
+{
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return x;
+}
+
+static void report_failure( const char * format, uint64_t cycle, unsigned id)
+{
+  if( result->first_failure[0] == 0)
+    snprintf( result->first_failure, sizeof( result->first_failure), format, (unsigned long long)cycle, id);
+}
+
+static void assertion_exit( const char * file, int line)
+{
+  snprintf( result->first_failure, sizeof( result->first_failure), "cycle %llu: ASSERT %s line %d",
+	    (unsigned long long)result->cycles, file, line);
+  _exit( ASSERTION_EXIT);
+}
+
+//! the writer's own high-water mark, measured on the painted host task stack
+static uint64_t writer_stack_used_words( void)
+{
+  uint32_t free_words = flash_write_statistics.stack_free_words;
+  return free_words ? HOST_TASK_STACK_WORDS - free_words : 0;
+}
+
+static bool same( float a, float b)
+{
+  return memcmp( &a, &b, sizeof( float)) == 0;
+}
+
+static bool orientation_parameter( unsigned id)
+{
+  return id == SENS_TILT_ROLL || id == SENS_TILT_PITCH || id == SENS_TILT_YAW;
+}
+
+static void add_candidate( parameter_model_t & model, unsigned id, float value)
+{
+  if( model.candidate_count[id] < MAX_CANDIDATES)
+    model.candidates[id][model.candidate_count[id]] = value;
+  if( model.candidate_count[id] <= MAX_CANDIDATES)
+    ++model.candidate_count[id];
+}
+
+static void acknowledge( parameter_model_t & model, unsigned id, float value)
+{
+  model.acknowledged[id] = value;
+  model.known[id] = true;
+  model.candidate_count[id] = 0;
+}
+
+//! compare the recovered file system with the model
+static void verify_parameters( parameter_model_t & model, uint64_t cycle)
+{
+  for( unsigned i = 0; i < PERSISTENT_DATA_ENTRIES; ++i)
+    {
+      unsigned id = PERSISTENT_DATA[i].id;
+      if( not model.known[id] || model.candidate_count[id] > MAX_CANDIDATES)
+	continue;
+
+      float value;
+      if( not read_blob( id, 1, &value))
+	{
+	  ++result->lost_values;
+	  report_failure( "cycle %llu: parameter %u missing after recovery", cycle, id);
+	  continue;
+	}
+
+      bool expected = same( value, model.acknowledged[id]);
+      for( unsigned k = 0; not expected && k < model.candidate_count[id]; ++k)
+	expected = same( value, model.candidates[id][k]);
+      if( not expected)
+	{
+	  ++result->lost_values;
+	  report_failure( "cycle %llu: parameter %u has an unexpected value after recovery", cycle, id);
+	}
+    }
+
+  // all three from the same update: the last acknowledged or one in flight
+  float roll, pitch, yaw;
+  if( model.known[SENS_TILT_ROLL] && model.known[SENS_TILT_PITCH] && model.known[SENS_TILT_YAW]
+      && read_blob( SENS_TILT_ROLL, 1, &roll) && read_blob( SENS_TILT_PITCH, 1, &pitch) && read_blob( SENS_TILT_YAW, 1, &yaw))
+    {
+      bool acknowledged = same( roll, model.acknowledged[SENS_TILT_ROLL])
+	  && same( pitch, model.acknowledged[SENS_TILT_PITCH]) && same( yaw, model.acknowledged[SENS_TILT_YAW]);
+      bool one_update = same( roll, pitch) && same( pitch, yaw);
+      if( not acknowledged && not one_update)
+	{
+	  ++result->torn_transactions;
+	  report_failure( "cycle %llu: torn sensor orientation%.0u", cycle, 0);
+	}
+    }
+}
+
+//! the recovered values are the new reference
+static void adopt_parameters( parameter_model_t & model)
+{
+  for( unsigned i = 0; i < PERSISTENT_DATA_ENTRIES; ++i)
+    {
+      unsigned id = PERSISTENT_DATA[i].id;
+      float value;
+      model.pending[id] = false;
+      if( read_blob( id, 1, &value))
+	acknowledge( model, id, value);
+      else
+	{
+	  model.known[id] = false;
+	  model.candidate_count[id] = 0;
+	}
+    }
+}
+
+//! one power-on of the sensor, runs in a child process
+static void boot_cycle( const fuzzer_options_t & options, uint64_t cycle, uint64_t random_state)
+{
+  parameter_model_t & model = result->model;
+  assertion_hook = assertion_exit;
+  alarm( CYCLE_TIMEOUT_S);
+
+  host_start_tasks(); // the EEPROM writer
+
+  uint64_t start = getTime_usec();
+  recover_and_initialize_flash();
+  uint64_t recovery_time = getTime_usec() - start;
+
+  verify_parameters( model, cycle);
+  (void) ensure_EEPROM_parameter_integrity();
+  adopt_parameters( model);
+
+  ++result->recoveries;
+  result->recovery_time_total_usec += recovery_time;
+  if( recovery_time > result->recovery_time_max_usec)
+    result->recovery_time_max_usec = recovery_time;
+
+  unsigned operations = next_random( random_state) % ( options.max_operations + 1);
+  for( unsigned i = 0; i < operations; ++i)
+    {
+      uint64_t r = next_random( random_state);
+      EEPROM_PARAMETER_ID id = PERSISTENT_DATA[ r % PERSISTENT_DATA_ENTRIES].id;
+      float value = (float)( (int32_t)( r >> 32)) * 1e-6f;
+
+      unsigned operation = ( r >> 8) % 100 < options.deferred_percent ? ( r >> 16) % 3 : 3;
+      if( orientation_parameter( id))
+	operation = 4;
+
+      switch( operation)
+	{
+	case 0: // parameter change from CAN
+	  add_candidate( model, id, value);
+	  model.pending[id] = true;
+	  model.pending_value[id] = value;
+	  (void) write_EEPROM_value_deferred( id, value);
+	  break;
+	case 1: // planned reset
+	  if( flush_deferred_EEPROM_values())
+	    for( unsigned k = 0; k < LOWEST_UNUSED_EEPROM_ID; ++k)
+	      if( model.pending[k])
+		{
+		  model.pending[k] = false;
+		  acknowledge( model, k, model.pending_value[k]);
+		}
+	  break;
+	case 2: // let the writer do its background work
+	  delay( EEPROM_PAGE_SWAP_STEP_INTERVAL + 2);
+	  break;
+	case 4: // sensor orientation update, plus one other parameter to make later single writes fold it
+	  {
+	    EEPROM_PARAMETER_ID ids[4] = { SENS_TILT_ROLL, SENS_TILT_PITCH, SENS_TILT_YAW,
+		PERSISTENT_DATA[ ( r >> 40) % PERSISTENT_DATA_ENTRIES].id };
+	    unsigned entries = orientation_parameter( ids[3]) ? 3 : 4;
+	    begin_EEPROM_transaction();
+	    for( unsigned k = 0; k < entries; ++k)
+	      {
+		add_candidate( model, ids[k], value);
+		(void) write_EEPROM_value( ids[k], value);
+	      }
+	    if( commit_EEPROM_transaction())
+	      for( unsigned k = 0; k < entries; ++k)
+		{
+		  model.pending[ids[k]] = false;
+		  acknowledge( model, ids[k], value);
+		}
+	    else
+	      report_failure( "cycle %llu: orientation transaction failed%.0u", cycle, 0);
+	  }
+	  break;
+	default: // synchronous write
+	  add_candidate( model, id, value);
+	  if( write_EEPROM_value( id, value))
+	    {
+	      model.pending[id] = false;
+	      acknowledge( model, id, value);
+	    }
+	  else
+	    report_failure( "cycle %llu: write of parameter %u failed", cycle, id);
+	  break;
+	}
+      ++result->writes;
+    }
+  if( writer_stack_used_words() > result->writer_stack_used_words)
+    result->writer_stack_used_words = writer_stack_used_words();
+  _exit( 0); // clean shutdown: pending deferred writes are lost like at power off
+}
+
+static void seed_legacy_EEPROM( uint64_t & random_state)
+{
+  uint32_t * word = simulated_flash_word( LEGACY_EEPROM_DATA);
+  *word++ = 0; // valid page status
+  for( unsigned i = 0; i < PERSISTENT_DATA_ENTRIES; ++i)
+    *word++ = ( (uint32_t)PERSISTENT_DATA[i].id << 16) | ( next_random( random_state) & 0x3ff);
+}
+
+static void run_worker( const fuzzer_options_t & options, unsigned worker, uint64_t cycles)
+{
+  if( not simulated_flash_map())
+    {
+      snprintf( result->first_failure, sizeof( result->first_failure), "cannot map the simulated flash");
+      ++result->crashes;
+      return;
+    }
+  simulated_flash_state_t & flash = simulated_flash_state();
+  uint64_t random_state = options.seed + 0x9e3779b97f4a7c15ULL * ( worker + 1);
+  flash.random_state = random_state;
+  if( options.legacy_start)
+    seed_legacy_EEPROM( random_state);
+
+  for( uint64_t cycle = 0; cycle < cycles; ++cycle)
+    {
+      ++result->cycles;
+      bool cut = next_random( random_state) % 100 < options.power_cut_percent;
+      flash.power_cut_at_step = cut ? flash.steps + 1 + next_random( random_state) % ( options.max_operations * 3 + 1) : 0;
+      // scrambled, otherwise the child would replay the sequence of this generator
+      uint64_t child_random_state = ( next_random( random_state) * 0xbf58476d1ce4e5b9ULL) | 1;
+
+      fflush( stdout);
+      fflush( stderr);
+      pid_t pid = fork();
+      if( pid == 0)
+	boot_cycle( options, cycle, child_random_state);
+
+      int status;
+      if( pid < 0 || waitpid( pid, &status, 0) != pid)
+	{
+	  ++result->crashes;
+	  break;
+	}
+      if( WIFEXITED( status))
+	switch( WEXITSTATUS( status))
+	  {
+	  case 0:
+	    ++result->clean_shutdowns;
+	    break;
+	  case SIMULATED_POWER_CUT_EXIT:
+	    ++result->power_cuts;
+	    break;
+	  case ASSERTION_EXIT:
+	    ++result->assertions;
+	    break;
+	  default:
+	    ++result->crashes;
+	    report_failure( "cycle %llu: unexpected exit code %u", cycle, WEXITSTATUS( status));
+	    break;
+	  }
+      else if( WIFSIGNALED( status) && WTERMSIG( status) == SIGALRM)
+	{
+	  ++result->hangs;
+	  report_failure( "cycle %llu: hang%.0u", cycle, 0);
+	}
+      else
+	{
+	  ++result->crashes;
+	  report_failure( "cycle %llu: killed by signal %u", cycle, WTERMSIG( status));
+	}
+
+      if( options.verbose && result->first_failure[0])
+	break;
+    }
+  result->flash = flash;
+}
+
+//! flash work per parameter change while flying, the CPU stalls for its duration
+typedef struct
+{
+  uint64_t changes;
+  uint64_t words;
+  uint64_t max_words;
+  uint64_t erases;
+  uint64_t landing_words;	//!< committed after the landing
+} stall_statistics_t;
+
+static void report_stall( const char * name, const stall_statistics_t & stall)
+{
+  printf( "%-22s %llu changes, %.1f words avg, %llu words max, %llu erases"
+	  " -> stall max %llu us typ, %llu us worst case; %llu words after the landing\n",
+	  name, (unsigned long long)stall.changes,
+	  stall.changes ? (double)stall.words / stall.changes : 0.0,
+	  (unsigned long long)stall.max_words, (unsigned long long)stall.erases,
+	  (unsigned long long)( stall.max_words * WORD_PROGRAM_TYP_USEC),
+	  (unsigned long long)( stall.max_words * WORD_PROGRAM_MAX_USEC),
+	  (unsigned long long)stall.landing_words);
+}
+
+/*! \brief flash programmed because of parameter changes received in flight
+ *
+ *  Counts the words programmed and the sectors erased between a parameter change
+ *  and the next one, with the flight phase inhibits set like the communicator does.
+ *  The program times are taken from the data sheet, there is no timing model.
+ */
+static void measure_parameter_change_stall( unsigned changes, uint64_t random_state)
+{
+  static worker_result_t local_result;
+  result = &local_result;
+  assertion_hook = assertion_exit;
+
+  if( not simulated_flash_map())
+    {
+      printf( "cannot map the simulated flash\n");
+      exit( 1);
+    }
+  simulated_flash_state_t & flash = simulated_flash_state();
+  host_start_tasks();
+  recover_and_initialize_flash();
+  (void) ensure_EEPROM_parameter_integrity();
+
+  inhibit_flash_background_work( true);
+  inhibit_deferred_EEPROM_commits( true);
+
+  // synchronous, deferred, deferred with as many different parameters as the queue holds
+  enum { SYNCHRONOUS, DEFERRED, DEFERRED_FEW, VARIANTS };
+  stall_statistics_t stall[VARIANTS];
+  memset( stall, 0, sizeof( stall));
+  for( unsigned variant = 0; variant < VARIANTS; ++variant)
+    {
+      for( unsigned i = 0; i < changes; ++i)
+	{
+	  uint64_t r = next_random( random_state);
+	  unsigned parameters = variant == DEFERRED_FEW ? EEPROM_WRITE_BEHIND_DEPTH : PERSISTENT_DATA_ENTRIES;
+	  EEPROM_PARAMETER_ID id = PERSISTENT_DATA[ r % parameters].id;
+	  if( orientation_parameter( id))
+	    continue; // written as a transaction, not via CAN
+	  float value = (float)( (int32_t)( r >> 32)) * 1e-6f;
+
+	  uint64_t words = flash.programmed_words;
+	  uint64_t erases = flash.erases[0] + flash.erases[1];
+	  if( variant != SYNCHRONOUS)
+	    (void) write_EEPROM_value_deferred( id, value);
+	  else
+	    (void) write_EEPROM_value( id, value);
+	  delay( EEPROM_PAGE_SWAP_STEP_INTERVAL + 2); // the writer's background step
+	  words = flash.programmed_words - words;
+	  stall[variant].erases += flash.erases[0] + flash.erases[1] - erases;
+
+	  ++stall[variant].changes;
+	  stall[variant].words += words;
+	  if( words > stall[variant].max_words)
+	    stall[variant].max_words = words;
+	}
+
+      uint64_t words = flash.programmed_words;
+      inhibit_deferred_EEPROM_commits( false); // landed
+      delay( EEPROM_PAGE_SWAP_STEP_INTERVAL + 2);
+      stall[variant].landing_words = flash.programmed_words - words;
+      inhibit_deferred_EEPROM_commits( true); // next flight
+    }
+
+  report_stall( "synchronous", stall[SYNCHRONOUS]);
+  report_stall( "deferred", stall[DEFERRED]); // queue overflows: written synchronously
+  report_stall( "deferred, few params", stall[DEFERRED_FEW]);
+  printf( "writer stack used      %llu words on the host\n", (unsigned long long)writer_stack_used_words());
+  fflush( stdout);
+  _exit( 0); // the tasks keep running
+}
+
+static void usage( const char * name)
+{
+  fprintf( stderr,
+      "usage: %s [options]\n"
+      "  -n cycles      boot cycles per worker (10000)\n"
+      "  -j workers     parallel workers with their own flash image (all cores)\n"
+      "  -o operations  maximum parameter operations per boot cycle (20)\n"
+      "  -p percent     boot cycles ending with a power cut (50)\n"
+      "  -d percent     operations using the write-behind queue (20)\n"
+      "  -t usec        duration of one RTOS tick (50)\n"
+      "  -s seed        random seed (1)\n"
+      "  -L             start from an EEPROM image in the legacy layout\n"
+      "  -x             stop a worker at its first failure\n"
+      "  -J changes     measure the flash stall of parameter changes in flight instead\n",
+      name);
+  exit( 1);
+}
+
+int main( int argc, char ** argv)
+{
+  fuzzer_options_t options = { 10000, 20, 50, 20, 1, false, false };
+  unsigned workers = sysconf( _SC_NPROCESSORS_ONLN);
+  host_tick_usec = 50;
+
+  unsigned stall_changes = 0;
+  int opt;
+  while( (opt = getopt( argc, argv, "n:j:o:p:d:t:s:LxJ:h")) != -1)
+    switch( opt)
+      {
+      case 'n': options.cycles = strtoull( optarg, 0, 0); break;
+      case 'j': workers = atoi( optarg); break;
+      case 'o': options.max_operations = atoi( optarg); break;
+      case 'p': options.power_cut_percent = atoi( optarg); break;
+      case 'd': options.deferred_percent = atoi( optarg); break;
+      case 't': host_tick_usec = atoi( optarg); break;
+      case 's': options.seed = strtoull( optarg, 0, 0); break;
+      case 'L': options.legacy_start = true; break;
+      case 'x': options.verbose = true; break;
+      case 'J': stall_changes = atoi( optarg); break;
+      default: usage( argv[0]);
+      }
+  if( workers == 0)
+    workers = 1;
+  if( stall_changes)
+    measure_parameter_change_stall( stall_changes, options.seed);
+
+  worker_result_t * results = (worker_result_t *)mmap( 0, workers * sizeof( worker_result_t),
+						       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if( results == MAP_FAILED)
+    return 1;
+  memset( (void *)results, 0, workers * sizeof( worker_result_t));
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<pid_t> pids;
+  for( unsigned w = 0; w < workers; ++w)
+    {
+      pid_t pid = fork();
+      if( pid == 0)
+	{
+	  result = results + w;
+	  run_worker( options, w, options.cycles);
+	  _exit( 0);
+	}
+      pids.push_back( pid);
+    }
+  for( pid_t pid : pids)
+    waitpid( pid, 0, 0);
+  double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+
+  worker_result_t total;
+  memset( &total, 0, sizeof( total));
+  for( unsigned w = 0; w < workers; ++w)
+    {
+      const worker_result_t & r = results[w];
+      total.cycles += r.cycles;
+      total.power_cuts += r.power_cuts;
+      total.clean_shutdowns += r.clean_shutdowns;
+      total.assertions += r.assertions;
+      total.crashes += r.crashes;
+      total.hangs += r.hangs;
+      total.lost_values += r.lost_values;
+      total.torn_transactions += r.torn_transactions;
+      total.recoveries += r.recoveries;
+      total.recovery_time_total_usec += r.recovery_time_total_usec;
+      if( r.recovery_time_max_usec > total.recovery_time_max_usec)
+	total.recovery_time_max_usec = r.recovery_time_max_usec;
+      total.writes += r.writes;
+      if( r.writer_stack_used_words > total.writer_stack_used_words)
+	total.writer_stack_used_words = r.writer_stack_used_words;
+      total.flash.programmed_words += r.flash.programmed_words;
+      total.flash.program_violations += r.flash.program_violations;
+      total.flash.locked_accesses += r.flash.locked_accesses;
+      if( r.first_failure[0])
+	printf( "worker %u: %s\n", w, r.first_failure);
+    }
+
+  printf( "boot cycles          %llu in %.1f s with %u workers: %.0f cycles/s\n",
+	  (unsigned long long)total.cycles, seconds, workers, total.cycles / seconds);
+  printf( "power cuts           %llu\n", (unsigned long long)total.power_cuts);
+  printf( "clean shutdowns      %llu\n", (unsigned long long)total.clean_shutdowns);
+  printf( "assertions           %llu\n", (unsigned long long)total.assertions);
+  printf( "crashes / hangs      %llu / %llu\n", (unsigned long long)total.crashes, (unsigned long long)total.hangs);
+  printf( "lost values          %llu (neither acknowledged nor in flight)\n", (unsigned long long)total.lost_values);
+  printf( "torn transactions    %llu\n", (unsigned long long)total.torn_transactions);
+  printf( "recovery time        avg %.0f us, max %llu us\n",
+	  total.recoveries ? (double)total.recovery_time_total_usec / total.recoveries : 0.0,
+	  (unsigned long long)total.recovery_time_max_usec);
+  printf( "operations           %llu, %llu words programmed\n",
+	  (unsigned long long)total.writes, (unsigned long long)total.flash.programmed_words);
+  printf( "program violations   %llu (bits 0 -> 1), %llu while locked\n",
+	  (unsigned long long)total.flash.program_violations, (unsigned long long)total.flash.locked_accesses);
+  printf( "writer stack used    %llu words max on the host (x86-64), after clean shutdowns\n",
+	  (unsigned long long)total.writer_stack_used_words);
+  for( unsigned w = 0; w < workers; ++w)
+    printf( "erases worker %-5u  sector 10: %llu, sector 11: %llu\n", w,
+	    (unsigned long long)results[w].flash.erases[0], (unsigned long long)results[w].flash.erases[1]);
+
+  return total.assertions || total.crashes || total.hangs || total.lost_values || total.torn_transactions ? 2 : 0;
+}
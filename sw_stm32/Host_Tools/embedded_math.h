@@ -0,0 +1,50 @@
+/** *****************************************************************************
+ * @file    	embedded_math.h
+ * @brief   	host replacement of the firmware math macros
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef INC_EMBEDDED_MATH_H_
+#define INC_EMBEDDED_MATH_H_
+
+// this file shadows Core/Inc/embedded_math.h when building on the host
+// it avoids the Cortex-M4 inline assembly and CMSIS-DSP
+
+#include <math.h>
+
+typedef float ftype;
+
+#define M_PI_F 3.14159265358979323846f
+
+#define ZERO 0.0f
+#define ONE 1.0f
+#define TWO 2.0f
+#define HALF 0.5f
+#define QUARTER 0.25f
+
+#define SQR(x) ((x)*(x))
+#define SQRT(x) sqrtf(x)
+#define COS(x) cosf(x)
+#define SIN(x) sinf(x)
+#define ASIN(x) asinf(x)
+#define ATAN2(y, x) atan2f(y, x)
+
+#endif /* INC_EMBEDDED_MATH_H_ */
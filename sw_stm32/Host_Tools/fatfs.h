@@ -0,0 +1,126 @@
+/** *****************************************************************************
+ * @file    	fatfs.h
+ * @brief   	POSIX-backed FatFs replacement for host builds
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef HOST_FATFS_H_
+#define HOST_FATFS_H_
+
+// this file shadows FATFS/App/fatfs.h when building on the host
+// only the subset of the FatFs API used by the logger is provided
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef unsigned int	UINT;
+typedef unsigned char	BYTE;
+typedef uint32_t	DWORD;
+typedef uint32_t	FSIZE_t;
+typedef char		TCHAR;
+
+typedef enum {
+	FR_OK = 0,
+	FR_DISK_ERR,
+	FR_INT_ERR,
+	FR_NOT_READY,
+	FR_NO_FILE,
+	FR_NO_PATH,
+	FR_INVALID_NAME,
+	FR_DENIED,
+	FR_EXIST,
+	FR_INVALID_OBJECT,
+	FR_WRITE_PROTECTED,
+	FR_INVALID_DRIVE,
+	FR_NOT_ENABLED,
+	FR_NO_FILESYSTEM,
+	FR_MKFS_ABORTED,
+	FR_TIMEOUT,
+	FR_LOCKED,
+	FR_NOT_ENOUGH_CORE,
+	FR_TOO_MANY_OPEN_FILES,
+	FR_INVALID_PARAMETER
+} FRESULT;
+
+#define	FA_READ			0x01
+#define	FA_WRITE		0x02
+#define	FA_OPEN_EXISTING	0x00
+#define	FA_CREATE_NEW		0x04
+#define	FA_CREATE_ALWAYS	0x08
+#define	FA_OPEN_ALWAYS		0x10
+#define	FA_OPEN_APPEND		0x30
+
+#define	AM_DIR	0x10
+
+typedef struct
+{
+  FILE *fp;
+  FSIZE_t fptr;
+  FSIZE_t obj_size;
+} FIL;
+
+typedef struct
+{
+  FSIZE_t fsize;
+  BYTE fattrib;
+  TCHAR fname[256];
+} FILINFO;
+
+#define f_size(fp) ((fp)->obj_size)
+#define f_tell(fp) ((fp)->fptr)
+
+FRESULT f_open (FIL* fp, const TCHAR* path, BYTE mode);
+FRESULT f_close (FIL* fp);
+FRESULT f_read (FIL* fp, void* buff, UINT btr, UINT* br);
+FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw);
+FRESULT f_lseek (FIL* fp, FSIZE_t ofs);
+FRESULT f_truncate (FIL* fp);
+FRESULT f_expand (FIL* fp, FSIZE_t szf, BYTE opt);
+FRESULT f_sync (FIL* fp);
+FRESULT f_stat (const TCHAR* path, FILINFO* fno);
+FRESULT f_rename (const TCHAR* path_old, const TCHAR* path_new);
+FRESULT f_unlink (const TCHAR* path);
+
+//! latency model for the simulated uSD card, all times in microseconds
+typedef struct
+{
+  unsigned write_latency;	//!< fixed cost per f_write call
+  unsigned write_per_kbyte;	//!< additional cost per KByte written
+  unsigned sync_latency;	//!< cost per f_sync call
+  unsigned stall_latency;	//!< garbage-collection pause ...
+  unsigned stall_period;	//!< ... injected every n-th f_write, 0 = never
+  unsigned time_scale;		//!< divide all delays by this factor, 1 = real time
+} fatfs_shim_latency_t;
+
+//! statistics collected by the simulated uSD card
+typedef struct
+{
+  uint64_t bytes_written;
+  unsigned write_calls;
+  unsigned sync_calls;
+  unsigned stalls;
+  unsigned max_write_latency; //!< in microseconds, unscaled
+} fatfs_shim_statistics_t;
+
+extern fatfs_shim_latency_t fatfs_shim_latency;
+extern fatfs_shim_statistics_t fatfs_shim_statistics;
+
+#endif /* HOST_FATFS_H_ */
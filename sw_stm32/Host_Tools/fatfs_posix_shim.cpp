@@ -0,0 +1,189 @@
+/** *****************************************************************************
+ * @file    	fatfs_posix_shim.cpp
+ * @brief   	FatFs API mapped onto POSIX files with injectable latency
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include "fatfs.h"
+#include <unistd.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <thread>
+
+fatfs_shim_latency_t fatfs_shim_latency = { 0, 0, 0, 0, 0, 1};
+fatfs_shim_statistics_t fatfs_shim_statistics;
+
+//!< simulate the time the uSD card needs
+static void card_busy( unsigned microseconds)
+{
+  if( microseconds == 0)
+    return;
+  unsigned scale = fatfs_shim_latency.time_scale ? fatfs_shim_latency.time_scale : 1;
+  std::this_thread::sleep_for( std::chrono::microseconds( microseconds / scale));
+}
+
+FRESULT f_open (FIL* fp, const TCHAR* path, BYTE mode)
+{
+  const char * posix_mode;
+  if( mode & FA_CREATE_ALWAYS)
+    posix_mode = (mode & FA_READ) ? "w+b" : "wb";
+  else if( mode & FA_WRITE)
+    posix_mode = "r+b";
+  else
+    posix_mode = "rb";
+
+  fp->fp = fopen( path, posix_mode);
+  if( fp->fp == 0 && (mode & FA_OPEN_ALWAYS))
+    fp->fp = fopen( path, "w+b");
+  if( fp->fp == 0)
+    return FR_NO_FILE;
+
+  fseek( fp->fp, 0, SEEK_END);
+  fp->obj_size = ftell( fp->fp);
+  if( (mode & FA_OPEN_APPEND) == FA_OPEN_APPEND)
+    fp->fptr = fp->obj_size;
+  else
+    {
+      fseek( fp->fp, 0, SEEK_SET);
+      fp->fptr = 0;
+    }
+  return FR_OK;
+}
+
+FRESULT f_close (FIL* fp)
+{
+  if( fp->fp == 0)
+    return FR_INVALID_OBJECT;
+  card_busy( fatfs_shim_latency.sync_latency); // FatFs syncs the file when closing it
+  fclose( fp->fp);
+  fp->fp = 0;
+  return FR_OK;
+}
+
+FRESULT f_read (FIL* fp, void* buff, UINT btr, UINT* br)
+{
+  if( fp->fp == 0)
+    return FR_INVALID_OBJECT;
+  *br = fread( buff, 1, btr, fp->fp);
+  fp->fptr += *br;
+  return ferror( fp->fp) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw)
+{
+  if( fp->fp == 0)
+    return FR_INVALID_OBJECT;
+
+  unsigned latency = fatfs_shim_latency.write_latency
+      + (uint64_t)fatfs_shim_latency.write_per_kbyte * btw / 1024;
+
+  ++fatfs_shim_statistics.write_calls;
+  if( fatfs_shim_latency.stall_period
+      && (fatfs_shim_statistics.write_calls % fatfs_shim_latency.stall_period) == 0)
+    {
+      latency += fatfs_shim_latency.stall_latency;
+      ++fatfs_shim_statistics.stalls;
+    }
+  if( latency > fatfs_shim_statistics.max_write_latency)
+    fatfs_shim_statistics.max_write_latency = latency;
+
+  card_busy( latency);
+
+  *bw = fwrite( buff, 1, btw, fp->fp);
+  fp->fptr += *bw;
+  if( fp->fptr > fp->obj_size)
+    fp->obj_size = fp->fptr;
+  fatfs_shim_statistics.bytes_written += *bw;
+  return *bw == btw ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_lseek (FIL* fp, FSIZE_t ofs)
+{
+  if( fp->fp == 0)
+    return FR_INVALID_OBJECT;
+  if( fseek( fp->fp, ofs, SEEK_SET) != 0)
+    return FR_DISK_ERR;
+  fp->fptr = ofs;
+  if( fp->fptr > fp->obj_size)
+    fp->obj_size = fp->fptr;
+  return FR_OK;
+}
+
+FRESULT f_truncate (FIL* fp)
+{
+  if( fp->fp == 0)
+    return FR_INVALID_OBJECT;
+  fflush( fp->fp);
+  if( ftruncate( fileno( fp->fp), fp->fptr) != 0)
+    return FR_DISK_ERR;
+  fp->obj_size = fp->fptr;
+  return FR_OK;
+}
+
+//!< like FatFs: only allowed on an empty file, the file size becomes szf
+FRESULT f_expand (FIL* fp, FSIZE_t szf, BYTE opt)
+{
+  if( fp->fp == 0)
+    return FR_INVALID_OBJECT;
+  if( szf == 0 || fp->obj_size != 0)
+    return FR_DENIED;
+  if( opt)
+    {
+      fflush( fp->fp);
+      if( ftruncate( fileno( fp->fp), szf) != 0)
+	return FR_DENIED;
+      fp->obj_size = szf;
+    }
+  return FR_OK;
+}
+
+FRESULT f_sync (FIL* fp)
+{
+  if( fp->fp == 0)
+    return FR_INVALID_OBJECT;
+  ++fatfs_shim_statistics.sync_calls;
+  card_busy( fatfs_shim_latency.sync_latency);
+  return fflush( fp->fp) == 0 ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_stat (const TCHAR* path, FILINFO* fno)
+{
+  struct stat s;
+  if( stat( path, &s) != 0)
+    return FR_NO_FILE;
+  if( fno)
+    {
+      fno->fsize = s.st_size;
+      fno->fattrib = S_ISDIR( s.st_mode) ? AM_DIR : 0;
+    }
+  return FR_OK;
+}
+
+FRESULT f_rename (const TCHAR* path_old, const TCHAR* path_new)
+{
+  card_busy( 2 * fatfs_shim_latency.write_latency); // two directory entries
+  return rename( path_old, path_new) == 0 ? FR_OK : FR_NO_FILE;
+}
+
+FRESULT f_unlink (const TCHAR* path)
+{
+  return unlink( path) == 0 ? FR_OK : FR_NO_FILE;
+}
@@ -0,0 +1,100 @@
+/** *****************************************************************************
+ * @file    	host_freertos.cpp
+ * @brief   	host replacement of the FreeRTOS C++ wrapper using threads
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include <pthread.h>
+#include <thread>
+#include <vector>
+#include "FreeRTOS_wrapper.h"
+
+unsigned host_tick_usec = 1000;
+
+#define STACK_PAINT		0xa5a5a5a5
+#define TASK_ENTRY_RESERVE	1024 // bytes kept free for the entry frame and the red zone
+
+static thread_local char this_task; // its address identifies the thread
+static thread_local uint32_t * stack_bottom; // lowest painted word
+
+typedef struct
+{
+  TaskFunction_t code;
+  void * parameters;
+} registered_task_t;
+
+//! tasks are registered during static initialization, so this must not be a global object
+static std::vector<registered_task_t> & registered_tasks( void)
+{
+  static std::vector<registered_task_t> tasks;
+  return tasks;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void)
+{
+  return &this_task;
+}
+
+void delay( TickType_t time)
+{
+  std::this_thread::sleep_for( std::chrono::microseconds( (uint64_t)time * host_tick_usec));
+}
+
+void host_register_task( TaskFunction_t code, void * parameters)
+{
+  registered_tasks().push_back( { code, parameters });
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark( TaskHandle_t task)
+{
+  ASSERT( task == 0 && stack_bottom != 0);
+  UBaseType_t free_words = 0;
+  while( free_words < HOST_TASK_STACK_WORDS && stack_bottom[free_words] == STACK_PAINT)
+    ++free_words;
+  return free_words;
+}
+
+//! paint the stack below the entry like FreeRTOS does, then run the task
+static void * task_entry( void * parameter)
+{
+  const registered_task_t * task = (const registered_task_t *)parameter;
+  uint32_t * top = (uint32_t *)( (char *)__builtin_frame_address( 0) - TASK_ENTRY_RESERVE);
+  stack_bottom = top - HOST_TASK_STACK_WORDS;
+  for( volatile uint32_t * word = stack_bottom; word < top; ++word)
+    *word = STACK_PAINT;
+  task->code( task->parameters);
+  return 0;
+}
+
+void host_start_tasks( void)
+{
+  pthread_attr_t attributes;
+  pthread_attr_init( &attributes);
+  pthread_attr_setstacksize( &attributes, HOST_TASK_STACK_WORDS * sizeof( uint32_t) * 2);
+  pthread_attr_setdetachstate( &attributes, PTHREAD_CREATE_DETACHED);
+  for( const registered_task_t & task : registered_tasks())
+    {
+      pthread_t thread;
+      int result = pthread_create( &thread, &attributes, task_entry, (void *)&task);
+      ASSERT( result == 0);
+    }
+  pthread_attr_destroy( &attributes);
+}
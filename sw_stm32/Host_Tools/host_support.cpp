@@ -0,0 +1,52 @@
+/** *****************************************************************************
+ * @file    	host_support.cpp
+ * @brief   	replacements for firmware system services on the host
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include "host_support.h"
+
+unsigned assertion_count;
+const char * last_assertion_file;
+int last_assertion_line;
+void ( *assertion_hook)( const char * file, int line);
+
+//!< on the target ASSERT() ends in a crash dump, here we just count
+extern "C" void emergency_write_crashdump( char * file, int line)
+{
+  if( assertion_hook)
+    assertion_hook( file, line);
+  if( assertion_count == 0)
+    fprintf( stderr, "ASSERT failed: %s line %d\n", file, line);
+  ++assertion_count;
+  last_assertion_file = file;
+  last_assertion_line = line;
+}
+
+uint64_t getTime_usec(void)
+{
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
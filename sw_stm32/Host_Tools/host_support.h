@@ -0,0 +1,37 @@
+/** *****************************************************************************
+ * @file    	host_support.h
+ * @brief   	replacements for firmware system services on the host
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef HOST_SUPPORT_H_
+#define HOST_SUPPORT_H_
+
+#include <stdint.h>
+
+extern unsigned assertion_count; //!< number of ASSERT() hits, fatal on the target
+extern const char * last_assertion_file;
+extern int last_assertion_line;
+extern void ( *assertion_hook)( const char * file, int line); //!< called first, may end the process
+
+uint64_t getTime_usec(void);
+
+#endif /* HOST_SUPPORT_H_ */
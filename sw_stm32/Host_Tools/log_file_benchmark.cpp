@@ -0,0 +1,432 @@
+/** *****************************************************************************
+ * @file    	log_file_benchmark.cpp
+ * @brief   	host throughput benchmark for the flexible log file writer
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+// Replays the 100 Hz record mix of communicator_runnable into
+// flexible_log_file_implementation_t while a second thread runs the
+// uSD_handler logging loop against the POSIX FatFs shim.
+// uSD card stalls are injected via the shim's latency model.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+#include "system_configuration.h"
+#include "fatfs.h"
+#include "host_support.h"
+#include "data_structures.h"
+#include "flexible_file_format.h"
+#include "flexible_log_file_implementation.h"
+#include "compact_log_records.h"
+#include "black_box.h"
+
+#define MAX_SPILL_BUFSIZE 65536
+
+void sync_logger( void);
+
+static uint8_t __attribute__((aligned(16))) mem_buffer[MEM_BUFSIZE];
+static uint32_t __attribute__((aligned(16))) log_spill_buffer[MAX_SPILL_BUFSIZE / sizeof( uint32_t)];
+static flexible_log_file_implementation_t * flex_file;
+black_box_t black_box;
+
+bool write_block( uint32_t * begin, uint32_t size_words)
+{
+  return flex_file->write_block ( begin, size_words);
+}
+
+// emulation of the RTOS task notification used by the uSD handler
+static std::mutex notification_mutex;
+static std::condition_variable notification;
+static unsigned notification_count;
+static bool logger_shall_stop;
+
+void sync_logger( void)
+{
+  std::lock_guard<std::mutex> lock( notification_mutex);
+  ++notification_count;
+  notification.notify_one();
+}
+
+static bool notify_take( void)
+{
+  std::unique_lock<std::mutex> lock( notification_mutex);
+  notification.wait( lock, []{ return notification_count > 0 || logger_shall_stop;});
+  bool got_one = notification_count > 0;
+  notification_count = 0;
+  return got_one;
+}
+
+typedef struct
+{
+  unsigned flushes;
+  unsigned failures;
+  uint64_t max_flush_time; // usec, time scaled
+} logger_statistics_t;
+
+static logger_statistics_t logger_statistics;
+
+// first GNSS fix: the logger renames the file opened under the fallback name
+static std::atomic<bool> first_fix;
+static const char * fixed_filename;
+static unsigned rename_extra_ms; // additional work of the logger at the rename
+static uint64_t rename_time; // usec, time scaled, 0 = not renamed
+static unsigned rename_drops; // dropped from the rename until one second after it
+
+//!< the logging loop of uSD_handler_runnable
+static void logger_runnable( void)
+{
+  bool renamed = false;
+  unsigned drops_before_rename = 0;
+  uint64_t rename_window_end = 0;
+  while( notify_take())
+    {
+      uint64_t start = getTime_usec();
+      bool success = flex_file->flush_buffer();
+      success &= flex_file->sync_file_if_due();
+      uint64_t duration = getTime_usec() - start;
+
+      ++logger_statistics.flushes;
+      if( not success)
+	++logger_statistics.failures;
+      if( duration > logger_statistics.max_flush_time)
+	logger_statistics.max_flush_time = duration;
+
+      if( rename_window_end && getTime_usec() >= rename_window_end)
+	{
+	  rename_drops = flex_file->get_statistics().dropped_records - drops_before_rename;
+	  rename_window_end = 0;
+	}
+
+      if( not renamed && first_fix)
+	{
+	  drops_before_rename = flex_file->get_statistics().dropped_records;
+	  start = getTime_usec();
+	  if( rename_extra_ms)
+	    std::this_thread::sleep_for( std::chrono::microseconds( rename_extra_ms * 1000 / fatfs_shim_latency.time_scale));
+	  if( not flex_file->rename( fixed_filename))
+	    ++logger_statistics.failures;
+	  rename_time = ( getTime_usec() - start) * fatfs_shim_latency.time_scale;
+	  rename_window_end = getTime_usec() + 1000000 / fatfs_shim_latency.time_scale;
+	  renamed = true;
+	}
+    }
+}
+
+static void usage( const char * name)
+{
+  fprintf( stderr,
+      "usage: %s [options]\n"
+      "  -t seconds     simulated logging time (600)\n"
+      "  -s scale       run faster than real time by this factor (10)\n"
+      "  -w usec        latency per f_write (2000)\n"
+      "  -k usec        additional latency per KByte written (500)\n"
+      "  -y usec        latency per f_sync (3000)\n"
+      "  -S usec        uSD stall (garbage collection) duration (150000)\n"
+      "  -p n           inject a stall every n-th f_write, 0 = never (50)\n"
+      "  -d             log D-GNSS instead of GNSS data\n"
+      "  -m             omit external magnetometer data\n"
+      "  -r             serialize sensor data in place using reserve() + commit()\n"
+      "  -c             log COMPACT_SENSOR_DATA instead of BASIC_SENSOR_DATA, with -r: encoded in place like the firmware\n"
+      "  -z bytes       ring slot size (LOG_SLOT_SIZE_BYTES)\n"
+      "  -b bytes       spill area size in addition to the 4 KByte main buffer (firmware setting)\n"
+      "  -P ms          open the file this late, log into the ring before (pre-trigger)\n"
+      "  -F seconds     first GNSS fix: open the file under a fallback name, rename it then\n"
+      "  -E ms          additional logger work at the rename, e.g. 300 for an EEPROM dump (0)\n"
+      "  -o file        output file (benchmark.lrsx)\n",
+      name);
+  exit( 1);
+}
+
+int main( int argc, char ** argv)
+{
+  unsigned seconds = 600;
+  bool log_d_gnss = false;
+  bool log_magnetometer = true;
+  bool use_reserve = false;
+  bool use_compact = false;
+  const char * filename = "benchmark.lrsx";
+  unsigned slot_size_bytes = LOG_SLOT_SIZE_BYTES;
+  int spill_size_bytes = -1; // use the firmware's sizing rule
+  unsigned pretrigger_ms = 0;
+  unsigned first_fix_seconds = 0;
+  char fallback_filename[flexible_log_file_implementation_t::MAX_FILE_NAME_SIZE];
+
+  fatfs_shim_latency.write_latency = 2000;
+  fatfs_shim_latency.write_per_kbyte = 500;
+  fatfs_shim_latency.sync_latency = 3000;
+  fatfs_shim_latency.stall_latency = 150000;
+  fatfs_shim_latency.stall_period = 50;
+  fatfs_shim_latency.time_scale = 10;
+
+  int opt;
+  while( (opt = getopt( argc, argv, "t:s:w:k:y:S:p:dmrcz:b:P:F:E:o:h")) != -1)
+    switch( opt)
+      {
+      case 't': seconds = atoi( optarg); break;
+      case 's': fatfs_shim_latency.time_scale = atoi( optarg); break;
+      case 'w': fatfs_shim_latency.write_latency = atoi( optarg); break;
+      case 'k': fatfs_shim_latency.write_per_kbyte = atoi( optarg); break;
+      case 'y': fatfs_shim_latency.sync_latency = atoi( optarg); break;
+      case 'S': fatfs_shim_latency.stall_latency = atoi( optarg); break;
+      case 'p': fatfs_shim_latency.stall_period = atoi( optarg); break;
+      case 'd': log_d_gnss = true; break;
+      case 'm': log_magnetometer = false; break;
+      case 'r': use_reserve = true; break;
+      case 'c': use_compact = true; break;
+      case 'z': slot_size_bytes = atoi( optarg); break;
+      case 'b': spill_size_bytes = atoi( optarg); break;
+      case 'P': pretrigger_ms = atoi( optarg); break;
+      case 'F': first_fix_seconds = atoi( optarg); break;
+      case 'E': rename_extra_ms = atoi( optarg); break;
+      case 'o': filename = optarg; break;
+      default: usage( argv[0]);
+      }
+  if( fatfs_shim_latency.time_scale == 0 || slot_size_bytes < sizeof( uint32_t))
+    usage( argv[0]);
+
+  if( spill_size_bytes < 0) // same rule as uSD_helpers.cpp
+    {
+      int ring_ms = LOG_SD_STALL_BUDGET_MS > LOG_PRETRIGGER_MS ? LOG_SD_STALL_BUDGET_MS : LOG_PRETRIGGER_MS;
+      int ring_bytes = ring_ms * LOG_DATA_RATE_BYTES_PER_SECOND / 1000 + 2 * slot_size_bytes;
+      spill_size_bytes = ring_bytes > MEM_BUFSIZE
+	  ? ( ring_bytes - MEM_BUFSIZE + slot_size_bytes - 1) / slot_size_bytes * slot_size_bytes
+	  : 0;
+    }
+  if( spill_size_bytes > MAX_SPILL_BUFSIZE)
+    usage( argv[0]);
+
+  if( first_fix_seconds) // like uSD_handler_runnable without GNSS fix at power-on
+    {
+      if( strlen( filename) + sizeof( ".nofix") > sizeof( fallback_filename))
+	usage( argv[0]);
+      fixed_filename = filename;
+      strcpy( fallback_filename, filename);
+      strcat( fallback_filename, ".nofix");
+      filename = fallback_filename;
+    }
+
+  flex_file = new flexible_log_file_implementation_t(
+      (uint32_t *)mem_buffer,
+      MEM_BUFSIZE / sizeof( uint32_t),
+      sync_logger,
+      slot_size_bytes / sizeof( uint32_t),
+      log_spill_buffer,
+      spill_size_bytes / sizeof( uint32_t));
+
+  measurement_data_t observations;
+  D_GNSS_coordinates_t coordinates;
+  state_vector_t state_vector;
+  float3vector external_magnetometer;
+  uint32_t system_state = 0;
+  memset( &observations, 0, sizeof( observations));
+  memset( &coordinates, 0, sizeof( coordinates));
+  memset( &state_vector, 0, sizeof( state_vector));
+  compact_record_codec_t sensor_data_codec( MEASUREMENT_DATA_WORDS, LOG_COMPACT_KEYFRAME_INTERVAL,
+					    MEASUREMENT_DATA_FIELDS, MEASUREMENT_DATA_FIELD_COUNT);
+  uint32_t compact_record[compact_record_codec_t::MAX_ENCODED_WORDS];
+  srand( 1);
+
+  if( pretrigger_ms)
+    flex_file->start_capture();
+  else if( not flex_file->open( (char *)filename))
+    {
+      fprintf( stderr, "cannot open %s\n", filename);
+      return 1;
+    }
+
+  std::thread logger( [=]()
+    {
+      if( pretrigger_ms) // like uSD_handler_runnable: the card is ready some time after power-on
+	{
+	  std::this_thread::sleep_for( std::chrono::microseconds( pretrigger_ms * 1000 / fatfs_shim_latency.time_scale));
+	  if( not flex_file->open( (char *)filename))
+	    {
+	      fprintf( stderr, "cannot open %s\n", filename);
+	      exit( 1);
+	    }
+	}
+      logger_runnable();
+    });
+
+  uint32_t file_format_version = flexible_log_file_implementation_t::FLEXIBLE_LOG_FILE_FORMAT_VERSION;
+  flex_file->append_record( FILE_FORMAT_VERSION, &file_format_version, 1);
+
+  uint64_t words_appended = 1;
+  uint64_t append_time = 0; // CPU time spent in append_record, usec
+  uint64_t black_box_time = 0; // CPU time spent in black_box.update(), usec
+  const unsigned ticks = seconds * 100;
+  const auto tick_period = std::chrono::microseconds( 10000 / fatfs_shim_latency.time_scale);
+  auto next_tick = std::chrono::steady_clock::now();
+
+  for( unsigned tick = 0; tick < ticks; ++tick)
+    {
+      next_tick += tick_period;
+      std::this_thread::sleep_until( next_tick);
+
+      // sensor values with a realistic amount of noise
+      for( unsigned i = 0; i < 3; ++i)
+	{
+	  observations.acc[i] = ( i == 2 ? -9.81f : 0.0f) + 0.02f * ( rand() / (float)RAND_MAX - 0.5f);
+	  observations.gyro[i] = 0.002f * ( rand() / (float)RAND_MAX - 0.5f);
+	  observations.mag[i] = 0.3f + 0.002f * ( rand() / (float)RAND_MAX - 0.5f);
+	}
+      observations.static_pressure = 95000.0f - tick * 0.01f + 2.0f * ( rand() / (float)RAND_MAX - 0.5f);
+      observations.pitot_pressure = 600.0f + 1.0f * ( rand() / (float)RAND_MAX - 0.5f);
+      observations.static_sensor_temperature = 20.0f + 0.05f * ( rand() / (float)RAND_MAX - 0.5f);
+      observations.supply_voltage = 12.5f + 0.01f * ( rand() / (float)RAND_MAX - 0.5f);
+      coordinates.latitude = (float)tick;
+      if( first_fix_seconds && tick == first_fix_seconds * 100)
+	first_fix = true;
+
+      uint64_t black_box_start = getTime_usec();
+      black_box.update( observations, state_vector);
+      if( tick % 10 == 0)
+	black_box.update_GNSS( coordinates);
+      black_box_time += getTime_usec() - black_box_start;
+
+      uint64_t start = getTime_usec();
+
+      if( tick % 1000 == 0)
+	{
+	  ++system_state;
+	  flex_file->append_record( SENSOR_STATUS, &system_state, 1);
+	  words_appended += 1;
+	}
+
+      if( use_compact && use_reserve)
+	{
+	  uint32_t * span = flex_file->reserve( COMPACT_SENSOR_DATA, sensor_data_codec.get_max_encoded_words());
+	  if( span == 0 || not flex_file->commit( sensor_data_codec.encode( (uint32_t *)&observations, span)))
+	    sensor_data_codec.force_keyframe();
+	}
+      else if( use_compact)
+	{
+	  unsigned words = sensor_data_codec.encode( (uint32_t *)&observations, compact_record);
+	  if( not flex_file->append_record( COMPACT_SENSOR_DATA, compact_record, words))
+	    sensor_data_codec.force_keyframe();
+	}
+      else if( use_reserve)
+	{
+	  uint32_t * span = flex_file->reserve( BASIC_SENSOR_DATA, sizeof(observations) / sizeof(uint32_t));
+	  if( span)
+	    {
+	      memcpy( span, &observations, sizeof(observations));
+	      flex_file->commit();
+	    }
+	}
+      else
+	flex_file->append_record( BASIC_SENSOR_DATA, (uint32_t*) &observations, sizeof(observations) / sizeof(uint32_t));
+      words_appended += sizeof(observations) / sizeof(uint32_t);
+
+      if( log_magnetometer)
+	{
+	  flex_file->append_record( MAGNETOMETER_DATA, (uint32_t*) &external_magnetometer,
+			  sizeof(external_magnetometer) / sizeof(uint32_t));
+	  words_appended += sizeof(external_magnetometer) / sizeof(uint32_t);
+	}
+
+      if( tick % 10 == 0) // GNSS @ 10 Hz
+	{
+	  unsigned seconds_of_day = 12 * 3600 + tick / 100;
+	  coordinates.day = 1;
+	  coordinates.hour = seconds_of_day / 3600;
+	  coordinates.minute = seconds_of_day / 60 % 60;
+	  coordinates.second = seconds_of_day % 60;
+	  coordinates.sat_fix_type = 1;
+	  flex_file->index_time( gnss_time_key( coordinates));
+
+	  if( log_d_gnss)
+	    {
+	      flex_file->append_record( D_GNSS_DATA, (uint32_t*) &coordinates,
+			      sizeof(D_GNSS_coordinates_t) / sizeof(uint32_t));
+	      words_appended += sizeof(D_GNSS_coordinates_t) / sizeof(uint32_t);
+	    }
+	  else
+	    {
+	      flex_file->append_record( GNSS_DATA, (uint32_t*) &coordinates,
+			      sizeof(GNSS_coordinates_t) / sizeof(uint32_t));
+	      words_appended += sizeof(GNSS_coordinates_t) / sizeof(uint32_t);
+	    }
+	}
+
+      append_time += getTime_usec() - start;
+    }
+
+  flex_file->block_input();
+
+  {
+    std::lock_guard<std::mutex> lock( notification_mutex);
+    logger_shall_stop = true;
+    notification.notify_one();
+  }
+  logger.join();
+  flex_file->close();
+
+  const log_file_statistics_t & statistics = flex_file->get_statistics();
+  const unsigned slot_bytes = flex_file->get_slot_size_words() * sizeof( uint32_t);
+  const double bytes_per_second = (double)fatfs_shim_statistics.bytes_written / seconds;
+
+  printf( "simulated time         %u s (time scale 1:%u)\n", seconds, fatfs_shim_latency.time_scale);
+  printf( "log ring               %u slots of %u bytes (spill area %d bytes)\n",
+	  flex_file->get_slot_count(), slot_bytes, spill_size_bytes);
+  printf( "payload words          %llu (without record headers)\n", (unsigned long long)words_appended);
+  printf( "throughput             %.1f words/s\n", (double)words_appended / seconds);
+  printf( "file size              %llu bytes = %.1f bytes/s\n",
+	  (unsigned long long)fatfs_shim_statistics.bytes_written, bytes_per_second);
+  printf( "append_record cost     %.2f usec per 10 ms tick\n", (double)append_time / ticks);
+  printf( "black box cost         %.2f usec per 10 ms tick, %u bytes\n",
+	  (double)black_box_time / ticks, (unsigned)sizeof( black_box));
+  printf( "f_write calls          %u, stalls %u, max latency %u usec\n",
+	  fatfs_shim_statistics.write_calls, fatfs_shim_statistics.stalls,
+	  fatfs_shim_statistics.max_write_latency);
+  printf( "f_sync calls           %u\n", fatfs_shim_statistics.sync_calls);
+  printf( "preallocation          %u bytes, %u growth steps\n",
+	  statistics.preallocated_bytes, statistics.growth_steps);
+  printf( "logger flushes         %u, failed %u, max duration %llu usec (scaled)\n",
+	  logger_statistics.flushes, logger_statistics.failures,
+	  (unsigned long long)logger_statistics.max_flush_time);
+  printf( "ring high-water mark   %u of %u slots pending\n",
+	  statistics.max_pending_slots, flex_file->get_slot_count());
+  unsigned spare_slots = flex_file->get_slot_count() - 1 - statistics.max_pending_slots;
+  printf( "overrun margin         %u slots = %.1f ms\n",
+	  spare_slots, spare_slots * slot_bytes * 1000.0 / bytes_per_second);
+  printf( "dropped records        %u (%u words)\n",
+	  statistics.dropped_records, statistics.dropped_words);
+  if( pretrigger_ms)
+    printf( "pre-trigger capture    %u bytes logged before open, %u records dropped\n",
+	    statistics.captured_bytes, statistics.captured_dropped_records);
+  if( first_fix_seconds)
+    printf( "rename at first fix    %llu usec (unscaled), %u records dropped within 1 s%s\n",
+	    (unsigned long long)rename_time, rename_drops, rename_time ? "" : ", NOT DONE");
+  if( assertion_count)
+    printf( "ASSERT hits            %u (fatal on the target !)\n", assertion_count);
+
+  bool failed = assertion_count || statistics.dropped_records;
+  return failed ? 2 : 0;
+}
@@ -0,0 +1,223 @@
+/** *****************************************************************************
+ * @file    	log_record_reader.cpp
+ * @brief   	host side parser for flexible log files
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+#include <mutex>
+#include "log_record_reader.h"
+#include "flexible_log_file.h"
+
+// all blocks emitted by flexible_log_file_t end up here, one sink per thread
+static thread_local std::vector<uint32_t> * block_sink;
+static thread_local const uint32_t * payload_to_skip; //!< header probing: do not copy the payload
+
+bool write_block( uint32_t * begin, uint32_t size_words)
+{
+  if( block_sink == 0)
+    return false;
+  if( begin == payload_to_skip)
+    {
+      block_sink->push_back( 0xffffffff); // just a marker where the payload went
+      return true;
+    }
+  block_sink->insert( block_sink->end(), begin, begin + size_words);
+  return true;
+}
+
+//! just the record framing of the library, no file behind it
+class framing_probe_t : public flexible_log_file_t
+{
+public:
+  framing_probe_t( void)
+  : flexible_log_file_t( dummy, sizeof( dummy) / sizeof( uint32_t))
+  {}
+  bool open( char *) override
+  {
+    return true;
+  }
+  bool close( void) override
+  {
+    return true;
+  }
+private:
+  uint32_t dummy[16];
+};
+
+static thread_local framing_probe_t framing_probe;
+
+//! frame a record, with the payload replaced by a single marker word if skip_payload
+static void frame_record( flexible_log_file_record_type type, const uint32_t * data, uint32_t size_words,
+			  std::vector<uint32_t> & out, bool skip_payload)
+{
+  block_sink = &out;
+  payload_to_skip = skip_payload ? data : 0;
+  framing_probe.append_record( type, (uint32_t *)data, size_words);
+  block_sink = 0;
+  payload_to_skip = 0;
+}
+
+static std::string key_of( const uint32_t * header, unsigned words)
+{
+  return std::string( (const char *)header, words * sizeof( uint32_t));
+}
+
+//! learned once per process, shared by all readers
+typedef struct
+{
+  bool known;
+  unsigned header_words;
+  unsigned trailer_words;
+  std::unordered_map<std::string, uint32_t> header_table; //!< header -> type << 16 | size
+} record_framing_t;
+
+static void learn_framing( record_framing_t & framing)
+{
+  static uint32_t payload[log_record_reader_t::MAX_RECORD_WORDS];
+  std::vector<uint32_t> probe;
+  framing.known = false;
+
+  frame_record( FILE_FORMAT_VERSION, payload, 1, probe, true);
+  unsigned marker = 0;
+  while( marker < probe.size() && probe[marker] != 0xffffffff)
+    ++marker;
+  if( marker == probe.size())
+    return; // the payload is not passed through as one block
+  framing.header_words = marker;
+  framing.trailer_words = probe.size() - marker - 1;
+
+  // the header must only depend on type and size, not on the payload
+  for( unsigned type = 0; type <= log_record_reader_t::MAX_RECORD_TYPE; ++type)
+    for( unsigned size = 0; size <= log_record_reader_t::MAX_RECORD_WORDS; ++size)
+      {
+	probe.clear();
+	frame_record( (flexible_log_file_record_type)type, payload, size, probe, true);
+	if( probe.size() < framing.header_words)
+	  return;
+	std::string key = key_of( probe.data(), framing.header_words);
+	if( framing.header_table.count( key) == 0)
+	  framing.header_table[key] = ( type << 16) | size;
+      }
+
+  probe.clear();
+  payload[0] = 0x12345678;
+  frame_record( FILE_FORMAT_VERSION, payload, 1, probe, true);
+  payload[0] = 0;
+  if( framing.header_table[ key_of( probe.data(), framing.header_words)] != ( (unsigned)FILE_FORMAT_VERSION << 16 | 1))
+    return;
+
+  framing.known = true;
+}
+
+static const record_framing_t & get_framing( void)
+{
+  static record_framing_t framing;
+  static std::once_flag learned;
+  std::call_once( learned, learn_framing, std::ref( framing));
+  return framing;
+}
+
+log_record_reader_t::log_record_reader_t( void)
+: framing_is_known( false),
+  header_words( 0),
+  trailer_words( 0),
+  header_table( 0),
+  position( 0),
+  input_end( 0),
+  skipped_words( 0)
+{
+  const record_framing_t & framing = get_framing();
+  framing_is_known = framing.known;
+  header_words = framing.header_words;
+  trailer_words = framing.trailer_words;
+  header_table = &framing.header_table;
+}
+
+void log_record_reader_t::frame( flexible_log_file_record_type type, const uint32_t * data, uint32_t size_words,
+				 std::vector<uint32_t> & out)
+{
+  frame_record( type, data, size_words, out, false);
+}
+
+bool log_record_reader_t::try_record( const uint32_t * at, log_record_t & record)
+{
+  if( at + header_words + trailer_words > input_end)
+    return false;
+
+  auto entry = header_table->find( key_of( at, header_words));
+  if( entry == header_table->end())
+    return false;
+
+  uint32_t size = entry->second & 0xffff;
+  const uint32_t * end = at + header_words + size + trailer_words;
+  if( end > input_end)
+    return false;
+
+  record.type = (flexible_log_file_record_type)( entry->second >> 16);
+  record.data = at + header_words;
+  record.size_words = size;
+  record.begin = at;
+  record.end = end;
+
+  if( trailer_words == 0)
+    return true;
+
+  // the trailer (checksum) must match the payload
+  framed.clear();
+  frame_record( record.type, record.data, size, framed, false);
+  return framed.size() == (size_t)( end - at)
+      && memcmp( framed.data() + header_words + size, at + header_words + size, trailer_words * sizeof( uint32_t)) == 0;
+}
+
+bool log_record_reader_t::next( log_record_t & record)
+{
+  if( not framing_is_known)
+    return false;
+
+  while( position < input_end)
+    {
+      if( try_record( position, record))
+	{
+	  position = record.end;
+	  return true;
+	}
+      ++position;
+      ++skipped_words;
+    }
+  return false;
+}
+
+bool read_log_file( const char * filename, std::vector<uint32_t> & content)
+{
+  FILE * fp = fopen( filename, "rb");
+  if( fp == 0)
+    return false;
+  fseek( fp, 0, SEEK_END);
+  long size = ftell( fp);
+  fseek( fp, 0, SEEK_SET);
+  content.resize( size / sizeof( uint32_t));
+  bool success = fread( content.data(), sizeof( uint32_t), content.size(), fp) == content.size();
+  fclose( fp);
+  return success;
+}
@@ -0,0 +1,116 @@
+/** *****************************************************************************
+ * @file    	log_record_reader.h
+ * @brief   	host side parser for flexible log files
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef LOG_RECORD_READER_H_
+#define LOG_RECORD_READER_H_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "flexible_file_format.h"
+
+//! one record as found in the file, data points into the caller's memory
+typedef struct
+{
+  flexible_log_file_record_type type;
+  const uint32_t * data;
+  uint32_t size_words;
+  const uint32_t * begin;	//!< start of the record header
+  const uint32_t * end;		//!< behind the record trailer
+} log_record_t;
+
+/*! \brief record parser which does not depend on the framing details
+ *
+ *  The record header and trailer are produced by flexible_log_file_t from lib.
+ *  Instead of duplicating that code the reader learns the framing by letting
+ *  the library frame probe records. A record is accepted if framing its payload
+ *  again gives exactly the words found in the file, which also detects corruption.
+ *  After a corrupt area the parser re-synchronizes word by word.
+ *  The framing is learned once per process, readers may be used in parallel threads.
+ */
+class log_record_reader_t
+{
+public:
+  enum
+  {
+    MAX_RECORD_TYPE = 255,
+    MAX_RECORD_WORDS = 1024
+  };
+
+  log_record_reader_t( void);
+
+  //! false if the library's record framing cannot be handled
+  bool framing_known( void) const
+  {
+    return framing_is_known;
+  }
+
+  //! words in front of and behind the payload
+  unsigned get_header_words( void) const
+  {
+    return header_words;
+  }
+  unsigned get_trailer_words( void) const
+  {
+    return trailer_words;
+  }
+
+  void set_input( const uint32_t * begin, const uint32_t * end)
+  {
+    position = begin;
+    input_end = end;
+    skipped_words = 0;
+  }
+
+  //! \return false at the end of the input
+  bool next( log_record_t & record);
+
+  //! words which did not belong to a valid record
+  uint64_t get_skipped_words( void) const
+  {
+    return skipped_words;
+  }
+
+  //! frame a record exactly as the firmware does and append it to out
+  void frame( flexible_log_file_record_type type, const uint32_t * data, uint32_t size_words,
+	      std::vector<uint32_t> & out);
+
+private:
+  bool try_record( const uint32_t * at, log_record_t & record);
+
+  bool framing_is_known;
+  unsigned header_words;
+  unsigned trailer_words;
+  const std::unordered_map<std::string, uint32_t> * header_table; //!< header -> type << 16 | size
+  std::vector<uint32_t> framed;
+  const uint32_t * position;
+  const uint32_t * input_end;
+  uint64_t skipped_words;
+};
+
+//! read a complete file into memory, false on error
+bool read_log_file( const char * filename, std::vector<uint32_t> & content);
+
+#endif /* LOG_RECORD_READER_H_ */
@@ -0,0 +1,342 @@
+/** *****************************************************************************
+ * @file    	lrsx_columns.cpp
+ * @brief   	columnar decoding of flexible log files
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+#include "data_structures.h"
+#include "compact_log_records.h"
+#include "lrsx_columns.h"
+
+//! column type of a scalar member, enums are stored as their underlying type
+template <class T> constexpr column_type_t scalar_type( void)
+{
+  if constexpr( std::is_enum<T>::value)
+    return scalar_type< typename std::underlying_type<T>::type>();
+  else if constexpr( std::is_floating_point<T>::value)
+    return sizeof( T) == 8 ? COLUMN_F64 : COLUMN_F32;
+  else if constexpr( std::is_signed<T>::value)
+    return sizeof( T) == 4 ? COLUMN_I32 : sizeof( T) == 2 ? COLUMN_I16 : COLUMN_I8;
+  else
+    return sizeof( T) == 4 ? COLUMN_U32 : sizeof( T) == 2 ? COLUMN_U16 : COLUMN_U8;
+}
+
+/*! \brief add the columns of one struct member
+ *  Arrays and vector classes (float3vector) give one column per element.
+ */
+template <class M> void add_member( std::vector<column_source_t> & sources, const char * name, size_t offset)
+{
+  if constexpr( std::is_array<M>::value)
+    {
+      typedef typename std::remove_extent<M>::type E;
+      for( unsigned i = 0; i < std::extent<M>::value; ++i)
+	sources.push_back( { std::string( name) + "[" + std::to_string( i) + "]",
+			     scalar_type<E>(), sizeof( E), (unsigned)( offset + i * sizeof( E))});
+    }
+  else if constexpr( std::is_class<M>::value)
+    {
+      static_assert( sizeof( M) % sizeof( float) == 0, "vector type expected");
+      for( unsigned i = 0; i < sizeof( M) / sizeof( float); ++i)
+	sources.push_back( { std::string( name) + "[" + std::to_string( i) + "]",
+			     COLUMN_F32, sizeof( float), (unsigned)( offset + i * sizeof( float))});
+    }
+  else
+    {
+      static_assert( sizeof( M) <= 8, "scalar type expected");
+      sources.push_back( { name, scalar_type<M>(), sizeof( M), (unsigned)offset});
+    }
+}
+
+template <class S, class M> size_t member_offset( M S::* member)
+{
+  static const S instance = S();
+  return (const char *)&( instance.*member) - (const char *)&instance;
+}
+
+#define MEMBER_COLUMNS( S, member) \
+  add_member< decltype( S::member)>( sources, #member, member_offset< S, decltype( S::member)>( &S::member))
+
+// only members used by the firmware are named here, the remaining
+// words of measurement_data_t are exported as "word[n]"
+static std::vector<column_source_t> measurement_columns( void)
+{
+  std::vector<column_source_t> sources;
+  MEMBER_COLUMNS( measurement_data_t, acc);
+  MEMBER_COLUMNS( measurement_data_t, gyro);
+  MEMBER_COLUMNS( measurement_data_t, mag);
+  MEMBER_COLUMNS( measurement_data_t, static_pressure);
+  MEMBER_COLUMNS( measurement_data_t, pitot_pressure);
+  MEMBER_COLUMNS( measurement_data_t, static_sensor_temperature);
+  MEMBER_COLUMNS( measurement_data_t, supply_voltage);
+
+  std::vector<bool> covered( sizeof( measurement_data_t) / sizeof( uint32_t));
+  for( auto & s : sources)
+    covered[ s.offset_bytes / sizeof( uint32_t)] = true;
+  for( unsigned i = 0; i < covered.size(); ++i)
+    if( not covered[i])
+      sources.push_back( { "word[" + std::to_string( i) + "]", COLUMN_F32, sizeof( float), (unsigned)( i * sizeof( uint32_t))});
+  return sources;
+}
+
+template <class S> static std::vector<column_source_t> gnss_columns( void)
+{
+  std::vector<column_source_t> sources;
+  MEMBER_COLUMNS( S, latitude);
+  MEMBER_COLUMNS( S, longitude);
+  MEMBER_COLUMNS( S, GNSS_MSL_altitude);
+  MEMBER_COLUMNS( S, velocity);
+  MEMBER_COLUMNS( S, speed_acc);
+  MEMBER_COLUMNS( S, pDOP);
+  MEMBER_COLUMNS( S, geo_sep_dm);
+  MEMBER_COLUMNS( S, year);
+  MEMBER_COLUMNS( S, month);
+  MEMBER_COLUMNS( S, day);
+  MEMBER_COLUMNS( S, hour);
+  MEMBER_COLUMNS( S, minute);
+  MEMBER_COLUMNS( S, second);
+  MEMBER_COLUMNS( S, nano);
+  MEMBER_COLUMNS( S, sat_fix_type);
+  MEMBER_COLUMNS( S, SATS_number);
+  return sources;
+}
+
+static std::vector<column_source_t> d_gnss_columns( void)
+{
+  std::vector<column_source_t> sources = gnss_columns<D_GNSS_coordinates_t>();
+  MEMBER_COLUMNS( D_GNSS_coordinates_t, relPosNED);
+  MEMBER_COLUMNS( D_GNSS_coordinates_t, relPosHeading);
+  return sources;
+}
+
+column_table_t::column_table_t( const char * _name, unsigned _record_bytes, const std::vector<column_source_t> & _sources)
+: name( _name),
+  record_bytes( _record_bytes),
+  rows( 0)
+{
+  sources.push_back( { "record", COLUMN_U32, sizeof( uint32_t), 0}); // position in the record stream
+  sources.insert( sources.end(), _sources.begin(), _sources.end());
+  data.resize( sources.size());
+}
+
+void column_table_t::reserve( size_t n)
+{
+  for( unsigned c = 0; c < sources.size(); ++c)
+    data[c].reserve( n * sources[c].element_size);
+}
+
+void column_table_t::clear( void)
+{
+  for( auto & column : data)
+    column.clear();
+  rows = 0;
+}
+
+void column_table_t::append( const uint32_t * record, uint64_t sequence)
+{
+  uint32_t record_number = (uint32_t)sequence;
+  data[0].insert( data[0].end(), (const uint8_t *)&record_number, (const uint8_t *)&record_number + sizeof( record_number));
+
+  const uint8_t * bytes = (const uint8_t *)record;
+  for( unsigned c = 1; c < sources.size(); ++c)
+    {
+      const uint8_t * element = bytes + sources[c].offset_bytes;
+      data[c].insert( data[c].end(), element, element + sources[c].element_size);
+    }
+  ++rows;
+}
+
+static void print_element( FILE * fp, column_type_t type, const uint8_t * p)
+{
+  switch( type)
+    {
+    case COLUMN_F32: { float v; memcpy( &v, p, sizeof( v)); fprintf( fp, "%.9g", v); } break;
+    case COLUMN_F64: { double v; memcpy( &v, p, sizeof( v)); fprintf( fp, "%.17g", v); } break;
+    case COLUMN_I32: { int32_t v; memcpy( &v, p, sizeof( v)); fprintf( fp, "%d", v); } break;
+    case COLUMN_U32: { uint32_t v; memcpy( &v, p, sizeof( v)); fprintf( fp, "%u", v); } break;
+    case COLUMN_I16: { int16_t v; memcpy( &v, p, sizeof( v)); fprintf( fp, "%d", v); } break;
+    case COLUMN_U16: { uint16_t v; memcpy( &v, p, sizeof( v)); fprintf( fp, "%u", v); } break;
+    case COLUMN_I8:  fprintf( fp, "%d", (int8_t)*p); break;
+    case COLUMN_U8:  fprintf( fp, "%u", *p); break;
+    }
+}
+
+bool column_table_t::write_csv( const char * filename) const
+{
+  FILE * fp = fopen( filename, "w");
+  if( fp == 0)
+    return false;
+
+  for( unsigned c = 0; c < sources.size(); ++c)
+    fprintf( fp, c ? ",%s" : "%s", sources[c].name.c_str());
+  fputc( '\n', fp);
+
+  for( size_t r = 0; r < rows; ++r)
+    {
+      for( unsigned c = 0; c < sources.size(); ++c)
+	{
+	  if( c)
+	    fputc( ',', fp);
+	  print_element( fp, sources[c].type, data[c].data() + r * sources[c].element_size);
+	}
+      fputc( '\n', fp);
+    }
+  return fclose( fp) == 0;
+}
+
+column_set_t::column_set_t( void)
+: measurement( "measurement", sizeof( measurement_data_t), measurement_columns()),
+  gnss( "gnss", sizeof( GNSS_coordinates_t), gnss_columns<GNSS_coordinates_t>()),
+  d_gnss( "d_gnss", sizeof( D_GNSS_coordinates_t), d_gnss_columns()),
+  records( 0),
+  undecodable( 0)
+{
+}
+
+bool column_set_t::decode( lrsx_file_t & file)
+{
+  measurement.clear();
+  gnss.clear();
+  d_gnss.clear();
+  records = undecodable = 0;
+
+  // the index footer tells how much room is needed
+  const log_index_t & index = file.get_index();
+  measurement.reserve( index.record_count[BASIC_SENSOR_DATA] + index.record_count[COMPACT_SENSOR_DATA]);
+  gnss.reserve( index.record_count[GNSS_DATA]);
+  d_gnss.reserve( index.record_count[D_GNSS_DATA]);
+
+  compact_record_codec_t sensor_data_codec( MEASUREMENT_DATA_WORDS, 0, MEASUREMENT_DATA_FIELDS, MEASUREMENT_DATA_FIELD_COUNT);
+  uint32_t decoded[compact_record_codec_t::MAX_RECORD_WORDS];
+
+  log_record_t record;
+  file.read_from( file.begin());
+  for( ; file.next( record); ++records)
+    {
+      column_table_t * table = 0;
+      const uint32_t * payload = record.data;
+
+      switch( (unsigned)record.type)
+	{
+	case BASIC_SENSOR_DATA:
+	  table = &measurement;
+	  break;
+	case (unsigned)COMPACT_SENSOR_DATA:
+	  if( sensor_data_codec.decode( record.data, record.size_words, decoded))
+	    {
+	      table = &measurement;
+	      payload = decoded;
+	    }
+	  else
+	    ++undecodable;
+	  break;
+	case GNSS_DATA:
+	  table = &gnss;
+	  break;
+	case D_GNSS_DATA:
+	  table = &d_gnss;
+	  break;
+	default:
+	  break;
+	}
+
+      if( table == 0)
+	continue;
+      if( payload == record.data && record.size_words * sizeof( uint32_t) < table->get_record_bytes())
+	{
+	  ++undecodable;
+	  continue;
+	}
+      table->append( payload, records);
+    }
+  return undecodable == 0;
+}
+
+bool column_set_t::write_archive( const char * filename) const
+{
+  const column_table_t * tables[] = { &measurement, &gnss, &d_gnss };
+  const unsigned n_tables = sizeof( tables) / sizeof( *tables);
+
+  lcol_file_header_t file_header;
+  memset( &file_header, 0, sizeof( file_header));
+  memcpy( file_header.magic, LCOL_MAGIC, sizeof( LCOL_MAGIC));
+  file_header.version = LCOL_VERSION;
+  file_header.tables = n_tables;
+
+  // layout: all headers first, then the aligned arrays
+  std::vector<uint8_t> headers( (const uint8_t *)&file_header, (const uint8_t *)( &file_header + 1));
+  uint64_t offset = sizeof( file_header);
+  for( auto t : tables)
+    offset += sizeof( lcol_table_header_t) + t->sources.size() * sizeof( lcol_column_header_t);
+
+  for( auto t : tables)
+    {
+      lcol_table_header_t table_header;
+      memset( &table_header, 0, sizeof( table_header));
+      strncpy( table_header.name, t->get_name(), sizeof( table_header.name) - 1);
+      table_header.rows = t->get_rows();
+      table_header.columns = t->sources.size();
+      headers.insert( headers.end(), (const uint8_t *)&table_header, (const uint8_t *)( &table_header + 1));
+
+      for( unsigned c = 0; c < t->sources.size(); ++c)
+	{
+	  lcol_column_header_t column;
+	  memset( &column, 0, sizeof( column));
+	  strncpy( column.name, t->sources[c].name.c_str(), sizeof( column.name) - 1);
+	  column.type = t->sources[c].type;
+	  column.element_size = t->sources[c].element_size;
+	  offset = ( offset + LCOL_ALIGNMENT - 1) / LCOL_ALIGNMENT * LCOL_ALIGNMENT;
+	  column.data_offset = offset;
+	  column.data_bytes = t->data[c].size();
+	  offset += column.data_bytes;
+	  headers.insert( headers.end(), (const uint8_t *)&column, (const uint8_t *)( &column + 1));
+	}
+    }
+
+  FILE * fp = fopen( filename, "wb");
+  if( fp == 0)
+    return false;
+  bool success = fwrite( headers.data(), 1, headers.size(), fp) == headers.size();
+
+  static const uint8_t padding[LCOL_ALIGNMENT] = { 0 };
+  uint64_t position = headers.size();
+  for( auto t : tables)
+    for( auto & column : t->data)
+      {
+	unsigned pad = ( LCOL_ALIGNMENT - position % LCOL_ALIGNMENT) % LCOL_ALIGNMENT;
+	success &= fwrite( padding, 1, pad, fp) == pad;
+	success &= fwrite( column.data(), 1, column.size(), fp) == column.size();
+	position += pad + column.size();
+      }
+  return ( fclose( fp) == 0) && success;
+}
+
+bool column_set_t::write_csv( const char * basename) const
+{
+  bool success = true;
+  for( auto t : { &measurement, &gnss, &d_gnss })
+    if( t->get_rows() > 0)
+      success &= t->write_csv( ( std::string( basename) + "_" + t->get_name() + ".csv").c_str());
+  return success;
+}
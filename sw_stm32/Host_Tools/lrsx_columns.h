@@ -0,0 +1,158 @@
+/** *****************************************************************************
+ * @file    	lrsx_columns.h
+ * @brief   	columnar decoding of flexible log files
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef LRSX_COLUMNS_H_
+#define LRSX_COLUMNS_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "lrsx_file.h"
+
+/* Columnar archive (.lcol), little endian, all arrays 64 byte aligned:
+ *
+ *   lcol_file_header_t
+ *   per table:		lcol_table_header_t
+ *   per column:	lcol_column_header_t
+ *   column data at data_offset
+ */
+
+#define LCOL_MAGIC	"LRSXCOL"
+#define LCOL_VERSION	1
+#define LCOL_ALIGNMENT	64
+
+enum column_type_t
+{
+  COLUMN_F32, COLUMN_F64, COLUMN_I32, COLUMN_U32, COLUMN_I16, COLUMN_U16, COLUMN_I8, COLUMN_U8
+};
+
+typedef struct
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t tables;
+} lcol_file_header_t;
+
+typedef struct
+{
+  char name[32];
+  uint64_t rows;
+  uint32_t columns;
+  uint32_t reserved;
+} lcol_table_header_t;
+
+typedef struct
+{
+  char name[48];
+  uint32_t type;		//!< column_type_t
+  uint32_t element_size;
+  uint64_t data_offset;
+  uint64_t data_bytes;
+} lcol_column_header_t;
+
+//! allocator for SIMD friendly column storage
+template <class T> struct aligned_allocator
+{
+  typedef T value_type;
+  aligned_allocator( void) = default;
+  template <class U> aligned_allocator( const aligned_allocator<U> &) {}
+  T * allocate( size_t n)
+  {
+    void * p = aligned_alloc( LCOL_ALIGNMENT, ( n * sizeof( T) + LCOL_ALIGNMENT - 1) / LCOL_ALIGNMENT * LCOL_ALIGNMENT);
+    if( p == 0)
+      throw std::bad_alloc();
+    return (T *)p;
+  }
+  void deallocate( T * p, size_t)
+  {
+    free( p);
+  }
+  template <class U> bool operator==( const aligned_allocator<U> &) const { return true; }
+  template <class U> bool operator!=( const aligned_allocator<U> &) const { return false; }
+};
+
+//! where a column comes from in the record
+typedef struct
+{
+  std::string name;
+  column_type_t type;
+  unsigned element_size;
+  unsigned offset_bytes;
+} column_source_t;
+
+//! one table per record kind, one contiguous array per field element
+class column_table_t
+{
+public:
+  column_table_t( const char * _name, unsigned _record_bytes, const std::vector<column_source_t> & _sources);
+
+  void reserve( size_t rows);
+  //! append one record, no allocation unless the reserved size is exceeded
+  void append( const uint32_t * record, uint64_t sequence);
+  void clear( void);
+
+  const char * get_name( void) const
+  {
+    return name.c_str();
+  }
+  size_t get_rows( void) const
+  {
+    return rows;
+  }
+  unsigned get_record_bytes( void) const
+  {
+    return record_bytes;
+  }
+
+  bool write_csv( const char * filename) const;
+
+  std::string name;
+  unsigned record_bytes;
+  std::vector<column_source_t> sources; //!< sources[0] is the record sequence number
+  std::vector< std::vector< uint8_t, aligned_allocator<uint8_t> > > data;
+  size_t rows;
+};
+
+//! the tables filled by decode_log_file()
+class column_set_t
+{
+public:
+  column_set_t( void);
+
+  column_table_t measurement;	//!< BASIC_SENSOR_DATA and COMPACT_SENSOR_DATA
+  column_table_t gnss;		//!< GNSS_DATA
+  column_table_t d_gnss;	//!< D_GNSS_DATA
+
+  //! decode all records in one pass, false if compact records had to be dropped
+  bool decode( lrsx_file_t & file);
+  bool write_archive( const char * filename) const;
+  bool write_csv( const char * basename) const;
+
+  uint64_t records;
+  uint64_t undecodable;
+};
+
+#endif /* LRSX_COLUMNS_H_ */
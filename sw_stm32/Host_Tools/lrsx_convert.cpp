@@ -0,0 +1,141 @@
+/** *****************************************************************************
+ * @file    	lrsx_convert.cpp
+ * @brief   	parallel conversion of log files into columnar archives or CSV
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+// Every worker thread owns one column_set_t which is re-used for all
+// files it converts, so the column arrays are allocated only a few times.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lrsx_columns.h"
+
+static void usage( const char * name)
+{
+  fprintf( stderr,
+      "usage: %s [options] file.lrsx ...\n"
+      "  -c             write CSV files instead of a columnar archive (.lcol)\n"
+      "  -n             decode only, do not write anything (benchmark)\n"
+      "  -j threads     number of worker threads (all cores)\n"
+      "  -o directory   output directory (next to the input files)\n",
+      name);
+  exit( 1);
+}
+
+static std::string output_basename( const char * input, const char * directory)
+{
+  std::string name( input);
+  size_t dot = name.rfind( '.');
+  if( dot != std::string::npos && name.find( '/', dot) == std::string::npos)
+    name.erase( dot);
+  if( directory)
+    {
+      size_t slash = name.rfind( '/');
+      name = std::string( directory) + "/" + ( slash == std::string::npos ? name : name.substr( slash + 1));
+    }
+  return name;
+}
+
+int main( int argc, char ** argv)
+{
+  bool csv = false;
+  bool decode_only = false;
+  unsigned threads = std::thread::hardware_concurrency();
+  const char * directory = 0;
+
+  int opt;
+  while( (opt = getopt( argc, argv, "cnj:o:h")) != -1)
+    switch( opt)
+      {
+      case 'c': csv = true; break;
+      case 'n': decode_only = true; break;
+      case 'j': threads = atoi( optarg); break;
+      case 'o': directory = optarg; break;
+      default: usage( argv[0]);
+      }
+  if( optind >= argc)
+    usage( argv[0]);
+  if( threads == 0)
+    threads = 1;
+
+  std::vector<const char *> files( argv + optind, argv + argc);
+  std::atomic<unsigned> next_file( 0);
+  std::atomic<uint64_t> bytes( 0), records( 0);
+  std::atomic<unsigned> failures( 0);
+  std::mutex report;
+
+  auto start = std::chrono::steady_clock::now();
+
+  auto worker = [&]()
+    {
+      lrsx_file_t file;
+      column_set_t columns;
+      for( unsigned i; ( i = next_file++) < files.size(); )
+	{
+	  const char * name = files[i];
+	  bool success = file.open( name);
+	  if( success)
+	    {
+	      bool complete = columns.decode( file);
+	      bytes += ( file.end() - file.begin()) * sizeof( uint32_t);
+	      records += columns.records;
+	      if( not decode_only)
+		{
+		  std::string out = output_basename( name, directory);
+		  success = csv ? columns.write_csv( out.c_str()) : columns.write_archive( ( out + ".lcol").c_str());
+		}
+	      if( not complete)
+		{
+		  std::lock_guard<std::mutex> lock( report);
+		  fprintf( stderr, "%s: %llu records could not be decoded\n", name, (unsigned long long)columns.undecodable);
+		}
+	    }
+	  if( not success)
+	    {
+	      ++failures;
+	      std::lock_guard<std::mutex> lock( report);
+	      fprintf( stderr, "%s: conversion failed\n", name);
+	    }
+	}
+    };
+
+  std::vector<std::thread> pool;
+  for( unsigned t = 0; t < threads && t < files.size(); ++t)
+    pool.emplace_back( worker);
+  for( auto & t : pool)
+    t.join();
+
+  double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count();
+  printf( "%zu files, %.1f MB, %llu records in %.3f s with %zu threads: %.1f MB/s, %.2f M records/s\n",
+	  files.size(), bytes / 1e6, (unsigned long long)records.load(), seconds, pool.size(),
+	  bytes / 1e6 / seconds, records / 1e6 / seconds);
+  return failures ? 1 : 0;
+}
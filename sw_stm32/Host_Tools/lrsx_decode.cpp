@@ -0,0 +1,124 @@
+/** *****************************************************************************
+ * @file    	lrsx_decode.cpp
+ * @brief   	reference decoder for compact log records
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+// Expands COMPACT_SENSOR_DATA into BASIC_SENSOR_DATA records and
+// COMPACT_STATE_VECTOR into DECODED_STATE_VECTOR records.
+// The index footer is dropped, all other records are copied unchanged.
+// The result can be read by every tool that understands the plain
+// flexible log file format. Use lrsx_index -r to add a new footer.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "system_configuration.h"
+#include "flexible_log_file.h"
+#include "compact_log_records.h"
+#include "log_record_reader.h"
+
+int main( int argc, char ** argv)
+{
+  if( argc != 3)
+    {
+      fprintf( stderr, "usage: %s input.lrsx output.lrsx\n", argv[0]);
+      return 1;
+    }
+
+  std::vector<uint32_t> input;
+  if( not read_log_file( argv[1], input))
+    {
+      fprintf( stderr, "cannot read %s\n", argv[1]);
+      return 1;
+    }
+
+  log_record_reader_t reader;
+  if( not reader.framing_known())
+    {
+      fprintf( stderr, "record framing of the library not supported\n");
+      return 1;
+    }
+  reader.set_input( input.data(), input.data() + input.size());
+
+  compact_record_codec_t sensor_data_codec( MEASUREMENT_DATA_WORDS, 0, MEASUREMENT_DATA_FIELDS, MEASUREMENT_DATA_FIELD_COUNT);
+  compact_record_codec_t state_vector_codec( STATE_VECTOR_WORDS, 0);
+
+  std::vector<uint32_t> output;
+  uint32_t decoded[compact_record_codec_t::MAX_RECORD_WORDS];
+  unsigned records = 0, expanded = 0, undecodable = 0;
+  log_record_t record;
+
+  while( reader.next( record))
+    {
+      ++records;
+      switch( (unsigned)record.type)
+	{
+	case FILE_FORMAT_VERSION:
+	  {
+	    uint32_t version = flexible_log_file_t::FLEXIBLE_LOG_FILE_FORMAT_VERSION;
+	    reader.frame( FILE_FORMAT_VERSION, &version, 1, output);
+	  }
+	  break;
+	case (unsigned)COMPACT_SENSOR_DATA:
+	  if( sensor_data_codec.decode( record.data, record.size_words, decoded))
+	    {
+	      reader.frame( BASIC_SENSOR_DATA, decoded, MEASUREMENT_DATA_WORDS, output);
+	      ++expanded;
+	    }
+	  else
+	    ++undecodable;
+	  break;
+	case (unsigned)COMPACT_STATE_VECTOR:
+	  if( state_vector_codec.decode( record.data, record.size_words, decoded))
+	    {
+	      reader.frame( DECODED_STATE_VECTOR, decoded, STATE_VECTOR_WORDS, output);
+	      ++expanded;
+	    }
+	  else
+	    ++undecodable;
+	  break;
+	case (unsigned)LOG_INDEX_FOOTER: // offsets are no longer valid
+	case (unsigned)LOG_INDEX_LOCATOR:
+	  break;
+	default:
+	  output.insert( output.end(), record.begin, record.end);
+	  break;
+	}
+    }
+
+  FILE * fp = fopen( argv[2], "wb");
+  if( fp == 0 || fwrite( output.data(), sizeof( uint32_t), output.size(), fp) != output.size())
+    {
+      fprintf( stderr, "cannot write %s\n", argv[2]);
+      return 1;
+    }
+  fclose( fp);
+
+  printf( "records              %u, %u expanded\n", records, expanded);
+  printf( "undecodable          %u (lost before a keyframe)\n", undecodable);
+  printf( "skipped words        %llu\n", (unsigned long long)reader.get_skipped_words());
+  printf( "size                 %zu -> %zu bytes, ratio %.2f\n",
+	  input.size() * sizeof( uint32_t), output.size() * sizeof( uint32_t),
+	  input.size() ? (double)output.size() / input.size() : 0.0);
+  return undecodable || reader.get_skipped_words() ? 2 : 0;
+}
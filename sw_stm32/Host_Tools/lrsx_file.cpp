@@ -0,0 +1,210 @@
+/** *****************************************************************************
+ * @file    	lrsx_file.cpp
+ * @brief   	random access to flexible log files using the index footer
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+
+#include "system_configuration.h"
+#include "data_structures.h"
+#include "lrsx_file.h"
+
+bool mapped_file_t::open( const char * filename)
+{
+  close();
+  int fd = ::open( filename, O_RDONLY);
+  if( fd < 0)
+    return false;
+
+  struct stat s;
+  if( fstat( fd, &s) != 0)
+    {
+      ::close( fd);
+      return false;
+    }
+
+  size_bytes = s.st_size;
+  if( size_bytes > 0)
+    {
+      base = mmap( 0, size_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+      if( base == MAP_FAILED)
+	{
+	  base = 0;
+	  size_bytes = 0;
+	}
+    }
+  ::close( fd); // the mapping stays valid
+  return base != 0 || s.st_size == 0;
+}
+
+void mapped_file_t::close( void)
+{
+  if( base)
+    munmap( base, size_bytes);
+  base = 0;
+  size_bytes = 0;
+}
+
+bool gnss_record_time_key( const log_record_t & record, uint32_t & time_key)
+{
+  if( record.type != GNSS_DATA && record.type != D_GNSS_DATA)
+    return false;
+
+  GNSS_coordinates_t coordinates;
+  if( record.size_words * sizeof( uint32_t) < sizeof( coordinates))
+    return false;
+  memcpy( &coordinates, record.data, sizeof( coordinates));
+
+  if( coordinates.sat_fix_type == 0) // SAT_FIX_NONE, not indexed by the firmware either
+    return false;
+
+  time_key = gnss_time_key( coordinates);
+  return true;
+}
+
+bool lrsx_file_t::open( const char * filename)
+{
+  footer_found = false;
+  if( not file.open( filename) || not reader.framing_known())
+    return false;
+
+  end_of_data = file.end();
+  if( read_footer())
+    footer_found = true;
+  else
+    scan();
+  return true;
+}
+
+//!< locate the footer via the fixed-size locator record at the end of the file
+bool lrsx_file_t::read_footer( void)
+{
+  log_index_locator_t locator = { LOG_INDEX_MAGIC, 0};
+  std::vector<uint32_t> framed;
+  reader.frame( LOG_INDEX_LOCATOR, (uint32_t *)&locator, sizeof( locator) / sizeof( uint32_t), framed);
+
+  if( file.size() / sizeof( uint32_t) < framed.size())
+    return false;
+
+  log_record_t record;
+  reader.set_input( file.end() - framed.size(), file.end());
+  if( not reader.next( record) || record.type != LOG_INDEX_LOCATOR || reader.get_skipped_words() != 0)
+    return false;
+
+  memcpy( &locator, record.data, sizeof( locator));
+  if( locator.magic != LOG_INDEX_MAGIC || locator.footer_offset_bytes % sizeof( uint32_t)
+      || locator.footer_offset_bytes >= file.size())
+    return false;
+
+  const uint32_t * footer = file.begin() + locator.footer_offset_bytes / sizeof( uint32_t);
+  reader.set_input( footer, record.begin);
+  if( not reader.next( record) || record.type != LOG_INDEX_FOOTER || record.begin != footer)
+    return false;
+
+  memset( &index, 0, sizeof( index));
+  if( record.size_words < log_index_size_words( 0) || record.size_words > sizeof( index) / sizeof( uint32_t))
+    return false;
+  memcpy( &index, record.data, record.size_words * sizeof( uint32_t));
+  if( index.magic != LOG_INDEX_MAGIC || index.counted_types != LOG_RECORD_TYPES_COUNTED
+      || log_index_size_words( index.entries) != record.size_words)
+    return false;
+
+  end_of_data = footer;
+  return true;
+}
+
+//!< fallback: build the index from the records, stop at the last valid one
+void lrsx_file_t::scan( void)
+{
+  log_index_start( index, LOG_INDEX_INTERVAL_SECONDS);
+  end_of_data = file.begin();
+
+  log_record_t record;
+  reader.set_input( file.begin(), file.end());
+  while( reader.next( record))
+    {
+      if( record.type == LOG_INDEX_FOOTER || record.type == LOG_INDEX_LOCATOR)
+	break; // footer without valid locator: ignore it
+
+      uint32_t time_key;
+      if( gnss_record_time_key( record, time_key))
+	log_index_add( index, time_key, ( record.begin - file.begin()) * sizeof( uint32_t));
+
+      if( (unsigned)record.type < LOG_RECORD_TYPES_COUNTED)
+	++index.record_count[record.type];
+      end_of_data = record.end;
+    }
+}
+
+const uint32_t * lrsx_file_t::seek( uint32_t time_key)
+{
+  const log_index_entry_t * first = index.entry;
+  const log_index_entry_t * last = index.entry + index.entries;
+
+  // last entry not later than time_key
+  const log_index_entry_t * entry = std::upper_bound( first, last, time_key,
+      []( uint32_t key, const log_index_entry_t & e) { return key < e.time_key; });
+  const uint32_t * from = ( entry == first) ? file.begin() : file.begin() + ( entry - 1)->offset_bytes / sizeof( uint32_t);
+
+  log_record_t record;
+  reader.set_input( from, end_of_data);
+  while( reader.next( record))
+    {
+      uint32_t record_time;
+      if( gnss_record_time_key( record, record_time) && record_time >= time_key)
+	{
+	  reader.set_input( record.begin, end_of_data);
+	  return record.begin;
+	}
+    }
+  return end_of_data;
+}
+
+bool lrsx_file_t::rebuild_footer( const char * filename)
+{
+  if( footer_found)
+    return true;
+
+  std::vector<uint32_t> tail;
+  log_index_locator_t locator = { LOG_INDEX_MAGIC, (uint32_t)(( end_of_data - file.begin()) * sizeof( uint32_t))};
+  reader.frame( LOG_INDEX_FOOTER, (uint32_t *)&index, log_index_size_words( index.entries), tail);
+  reader.frame( LOG_INDEX_LOCATOR, (uint32_t *)&locator, sizeof( locator) / sizeof( uint32_t), tail);
+
+  FILE * fp = fopen( filename, "r+b");
+  if( fp == 0)
+    return false;
+  bool success =
+      fseek( fp, locator.footer_offset_bytes, SEEK_SET) == 0
+      && fwrite( tail.data(), sizeof( uint32_t), tail.size(), fp) == tail.size()
+      && fflush( fp) == 0
+      && ftruncate( fileno( fp), locator.footer_offset_bytes + tail.size() * sizeof( uint32_t)) == 0;
+  fclose( fp);
+
+  return success && open( filename);
+}
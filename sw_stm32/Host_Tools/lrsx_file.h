@@ -0,0 +1,137 @@
+/** *****************************************************************************
+ * @file    	lrsx_file.h
+ * @brief   	random access to flexible log files using the index footer
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef LRSX_FILE_H_
+#define LRSX_FILE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "log_file_index.h"
+#include "log_record_reader.h"
+
+//! read-only memory map of a complete file
+class mapped_file_t
+{
+public:
+  mapped_file_t( void)
+  : base( 0), size_bytes( 0)
+  {}
+  ~mapped_file_t()
+  {
+    close();
+  }
+  bool open( const char * filename);
+  void close( void);
+
+  const uint32_t * begin( void) const
+  {
+    return (const uint32_t *)base;
+  }
+  const uint32_t * end( void) const
+  {
+    return begin() + size_bytes / sizeof( uint32_t);
+  }
+  size_t size( void) const
+  {
+    return size_bytes;
+  }
+
+private:
+  void * base;
+  size_t size_bytes;
+};
+
+/*! \brief log file with O(log n) seeking by GNSS time
+ *
+ *  If the file has been closed properly the index is taken from the footer
+ *  and only the pages needed are read. Otherwise (power loss) the file is
+ *  scanned once and the index is built exactly the way the firmware does it.
+ */
+class lrsx_file_t
+{
+public:
+  lrsx_file_t( void)
+  : footer_found( false), end_of_data( 0)
+  {}
+
+  bool open( const char * filename);
+
+  //! the index was read from the file, no scan was necessary
+  bool has_footer( void) const
+  {
+    return footer_found;
+  }
+
+  const log_index_t & get_index( void) const
+  {
+    return index;
+  }
+
+  //! first GNSS record logged at or after time_key, end() if there is none
+  const uint32_t * seek( uint32_t time_key);
+
+  //! records in the range [from, end of data), excluding the footer
+  void read_from( const uint32_t * from)
+  {
+    reader.set_input( from, end_of_data);
+  }
+  bool next( log_record_t & record)
+  {
+    return reader.next( record);
+  }
+
+  const uint32_t * begin( void) const
+  {
+    return file.begin();
+  }
+  const uint32_t * end( void) const
+  {
+    return end_of_data;
+  }
+
+  /*! \brief write footer and locator behind the last valid record
+   *  A tail of garbage left by a power loss is cut off.
+   */
+  bool rebuild_footer( const char * filename);
+
+  log_record_reader_t & get_reader( void)
+  {
+    return reader;
+  }
+
+private:
+  bool read_footer( void);
+  void scan( void);
+
+  mapped_file_t file;
+  log_record_reader_t reader;
+  log_index_t index;
+  bool footer_found;
+  const uint32_t * end_of_data; //!< behind the last record, footer excluded
+};
+
+//! time key of a GNSS_DATA or D_GNSS_DATA record, false for other records or without fix
+bool gnss_record_time_key( const log_record_t & record, uint32_t & time_key);
+
+#endif /* LRSX_FILE_H_ */
@@ -0,0 +1,117 @@
+/** *****************************************************************************
+ * @file    	lrsx_index.cpp
+ * @brief   	show, use and rebuild the seek index of log files
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+
+#include "lrsx_file.h"
+
+static void usage( const char * name)
+{
+  fprintf( stderr,
+      "usage: %s [options] file.lrsx ...\n"
+      "  -t hh:mm:ss    seek to this GNSS time (UTC, day of the first fix)\n"
+      "  -r             write the footer into files without one (power loss)\n"
+      "  -v             list the index entries\n",
+      name);
+  exit( 1);
+}
+
+int main( int argc, char ** argv)
+{
+  bool rebuild = false;
+  bool verbose = false;
+  int seek_seconds = -1;
+
+  int opt;
+  while( (opt = getopt( argc, argv, "t:rvh")) != -1)
+    switch( opt)
+      {
+      case 't':
+	{
+	  unsigned h, m, s;
+	  if( sscanf( optarg, "%u:%u:%u", &h, &m, &s) != 3)
+	    usage( argv[0]);
+	  seek_seconds = ( h * 60 + m) * 60 + s;
+	}
+	break;
+      case 'r': rebuild = true; break;
+      case 'v': verbose = true; break;
+      default: usage( argv[0]);
+      }
+  if( optind >= argc)
+    usage( argv[0]);
+
+  int result = 0;
+  for( int i = optind; i < argc; ++i)
+    {
+      lrsx_file_t file;
+      auto start = std::chrono::steady_clock::now();
+      if( not file.open( argv[i]))
+	{
+	  fprintf( stderr, "%s: cannot open\n", argv[i]);
+	  result = 1;
+	  continue;
+	}
+      double open_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start).count();
+
+      const log_index_t & index = file.get_index();
+      printf( "%s: %s, opened in %.2f ms\n", argv[i], file.has_footer() ? "footer" : "no footer, scanned", open_ms);
+      printf( "  %u index entries, every %u s\n", index.entries, index.interval_seconds);
+      for( unsigned type = 0; type < LOG_RECORD_TYPES_COUNTED; ++type)
+	if( index.record_count[type])
+	  printf( "  record type 0x%02x: %u\n", type, index.record_count[type]);
+      if( verbose)
+	for( unsigned e = 0; e < index.entries; ++e)
+	  printf( "  %02u:%02u:%02u @ %u\n",
+		  index.entry[e].time_key / 3600 % 24, index.entry[e].time_key / 60 % 60,
+		  index.entry[e].time_key % 60, index.entry[e].offset_bytes);
+
+      if( seek_seconds >= 0 && index.entries > 0)
+	{
+	  uint32_t time_key = index.entry[0].time_key / 86400 * 86400 + seek_seconds;
+	  start = std::chrono::steady_clock::now();
+	  const uint32_t * position = file.seek( time_key);
+	  double seek_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start).count();
+	  if( position == file.end())
+	    printf( "  seek: time not found\n");
+	  else
+	    printf( "  seek: offset %zu, %.2f ms\n", ( position - file.begin()) * sizeof( uint32_t), seek_ms);
+	}
+
+      if( rebuild && not file.has_footer())
+	{
+	  if( file.rebuild_footer( argv[i]))
+	    printf( "  footer written\n");
+	  else
+	    {
+	      fprintf( stderr, "%s: cannot write footer\n", argv[i]);
+	      result = 1;
+	    }
+	}
+    }
+  return result;
+}
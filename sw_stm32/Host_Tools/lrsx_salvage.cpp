@@ -0,0 +1,181 @@
+/** *****************************************************************************
+ * @file    	lrsx_salvage.cpp
+ * @brief   	repair of log files left open by a power loss
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+// The search for the last intact checkpoint is the firmware's own code
+// (Communication/log_file_recovery.cpp), running on the POSIX FatFs shim.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+#include "fatfs.h"
+#include "log_file_index.h"
+#include "log_file_recovery.h"
+#include "log_record_reader.h"
+
+static void usage( const char * name)
+{
+  fprintf( stderr,
+      "usage: %s [options] file.lrsx ...\n"
+      "  -n             dry run, report only\n"
+      "  -x             keep intact records behind the last checkpoint\n",
+      name);
+  exit( 1);
+}
+
+//!< a closed file ends with the index locator
+static bool closed_properly( FIL & file, const log_record_framing_t & framing)
+{
+  unsigned words = framing.header_words + sizeof( log_index_locator_t) / sizeof( uint32_t) + framing.trailer_words;
+  std::vector<uint32_t> tail( words);
+  UINT bytes_read = 0;
+  if( ( f_size( &file) < words * sizeof( uint32_t))
+      || ( f_lseek( &file, f_size( &file) - words * sizeof( uint32_t)) != FR_OK)
+      || ( f_read( &file, tail.data(), words * sizeof( uint32_t), &bytes_read) != FR_OK)
+      || ( bytes_read != words * sizeof( uint32_t)))
+    return false;
+  return tail[framing.header_words] == LOG_INDEX_MAGIC;
+}
+
+/*! \brief records behind the last checkpoint that are complete and contiguous
+ *
+ *  Checkpoint K+1 would have been written at the first record boundary behind
+ *  (K+1) * interval, so valid data cannot start beyond that point.
+ *  \return new end of file
+ */
+static uint32_t extend_behind_checkpoint( FIL & file, const log_recovery_result_t & result,
+					  log_record_reader_t & reader, unsigned & records)
+{
+  uint32_t begin = result.recovered_bytes;
+  uint32_t limit = ( result.last_sequence + 1) * result.interval_bytes;
+  uint32_t window_end = limit + log_record_reader_t::MAX_RECORD_WORDS * sizeof( uint32_t);
+  if( window_end > result.original_bytes)
+    window_end = result.original_bytes;
+  if( window_end <= begin)
+    return begin;
+
+  std::vector<uint32_t> window( ( window_end - begin) / sizeof( uint32_t));
+  UINT bytes_read = 0;
+  if( ( f_lseek( &file, begin) != FR_OK)
+      || ( f_read( &file, window.data(), window.size() * sizeof( uint32_t), &bytes_read) != FR_OK))
+    return begin;
+  window.resize( bytes_read / sizeof( uint32_t));
+
+  reader.set_input( window.data(), window.data() + window.size());
+  const uint32_t * end = window.data();
+  log_record_t record;
+  while( reader.next( record)
+      && ( record.begin == end) // no garbage in between
+      && ( record.type != LOG_CHECKPOINT)
+      && ( begin + ( record.begin - window.data()) * sizeof( uint32_t) < limit))
+    {
+      end = record.end;
+      ++records;
+    }
+  return begin + ( end - window.data()) * sizeof( uint32_t);
+}
+
+int main( int argc, char ** argv)
+{
+  bool dry_run = false;
+  bool extend = false;
+
+  int opt;
+  while( (opt = getopt( argc, argv, "nxh")) != -1)
+    switch( opt)
+      {
+      case 'n': dry_run = true; break;
+      case 'x': extend = true; break;
+      default: usage( argv[0]);
+      }
+  if( optind >= argc)
+    usage( argv[0]);
+
+  log_record_reader_t reader;
+  if( not reader.framing_known())
+    {
+      fprintf( stderr, "record framing of the library not supported\n");
+      return 1;
+    }
+  log_record_framing_t framing;
+  framing.header_words = reader.get_header_words();
+  framing.trailer_words = reader.get_trailer_words();
+
+  int status = 0;
+  for( int i = optind; i < argc; ++i)
+    {
+      const char * name = argv[i];
+      FIL file;
+      if( f_open( &file, name, dry_run ? FA_READ : FA_READ | FA_WRITE) != FR_OK)
+	{
+	  fprintf( stderr, "%s: cannot open\n", name);
+	  status = 1;
+	  continue;
+	}
+
+      if( closed_properly( file, framing))
+	{
+	  printf( "%s: closed properly, nothing to do\n", name);
+	  f_close( &file);
+	  continue;
+	}
+
+      auto start = std::chrono::steady_clock::now();
+      log_recovery_result_t result;
+      if( not find_log_recovery_point( file, framing, result))
+	{
+	  fprintf( stderr, "%s: no checkpoint found, try lrsx_index -r\n", name);
+	  f_close( &file);
+	  status = 1;
+	  continue;
+	}
+      double search_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start).count();
+
+      uint32_t end = result.recovered_bytes;
+      unsigned extra_records = 0;
+      if( extend)
+	end = extend_behind_checkpoint( file, result, reader, extra_records);
+
+      bool success = true;
+      if( not dry_run && end < result.original_bytes)
+	success = ( f_lseek( &file, end) == FR_OK) && ( f_truncate( &file) == FR_OK);
+      success &= ( f_close( &file) == FR_OK);
+
+      printf( "%s: checkpoint %u found with %u probes in %.2f ms, %u -> %u bytes",
+	      name, (unsigned)result.last_sequence, (unsigned)result.probes, search_ms,
+	      (unsigned)result.original_bytes, (unsigned)end);
+      if( extend)
+	printf( ", %u records behind the checkpoint", extra_records);
+      printf( "%s\n", dry_run ? " (dry run)" : "");
+
+      if( not success)
+	{
+	  fprintf( stderr, "%s: truncation failed\n", name);
+	  status = 1;
+	}
+    }
+  return status;
+}
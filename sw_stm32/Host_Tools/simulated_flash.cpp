@@ -0,0 +1,180 @@
+/** *****************************************************************************
+ * @file    	simulated_flash.cpp
+ * @brief   	simulated NOR flash for the EEPROM sectors with power cut injection
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+// NOR flash behaviour: erase sets a whole sector to 0xff, programming can only
+// clear bits. A power cut happens in the middle of the step it has been
+// scheduled for: a word program clears a random subset of its bits, an erase
+// leaves a random mix of erased, untouched and garbage words. Then the process
+// dies immediately, like the MCU does.
+
+#include <sys/mman.h>
+#include <string.h>
+#include <unistd.h>
+#include "stm32f4xx_hal.h"
+#include "simulated_flash.h"
+
+#define FLASH_BYTES ( SIMULATED_FLASH_SECTORS * SIMULATED_FLASH_SECTOR_BYTES)
+
+static simulated_flash_state_t * state;
+static bool unlocked;
+
+bool simulated_flash_map( void)
+{
+  void * flash = mmap( (void *)SIMULATED_FLASH_BASE, FLASH_BYTES, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  if( flash != (void *)SIMULATED_FLASH_BASE)
+    return false;
+  void * shared = mmap( 0, sizeof( simulated_flash_state_t), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if( shared == MAP_FAILED)
+    return false;
+  state = (simulated_flash_state_t *)shared;
+  state->random_state = 0x2545f4914f6cdd1dULL;
+  simulated_flash_format();
+  return true;
+}
+
+simulated_flash_state_t & simulated_flash_state( void)
+{
+  return *state;
+}
+
+void simulated_flash_format( void)
+{
+  memset( (void *)SIMULATED_FLASH_BASE, 0xff, FLASH_BYTES);
+}
+
+uint32_t * simulated_flash_word( uint32_t address)
+{
+  if( address < SIMULATED_FLASH_BASE || address + sizeof( uint32_t) > SIMULATED_FLASH_BASE + FLASH_BYTES || ( address & 3))
+    return 0;
+  return (uint32_t *)(uintptr_t)address;
+}
+
+static uint32_t random_word( void)
+{
+  uint64_t x = state->random_state; // xorshift64
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  state->random_state = x;
+  return (uint32_t)( x >> 16);
+}
+
+//! \return true if the power fails during this step
+static bool power_cut_now( void)
+{
+  ++state->steps;
+  return state->power_cut_at_step != 0 && state->steps >= state->power_cut_at_step;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock( void)
+{
+  unlocked = true;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock( void)
+{
+  unlocked = false;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program( uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+  uint32_t * word = simulated_flash_word( Address);
+  if( word == 0 || TypeProgram != TYPEPROGRAM_WORD)
+    return HAL_ERROR;
+  if( not unlocked)
+    {
+      ++state->locked_accesses;
+      return HAL_ERROR;
+    }
+
+  uint32_t value = (uint32_t)Data;
+  if( ( *word & value) != value)
+    ++state->program_violations;
+
+  if( power_cut_now())
+    {
+      *word &= value | random_word(); // only some of the bits have been cleared
+      _exit( SIMULATED_POWER_CUT_EXIT);
+    }
+
+  *word &= value;
+  ++state->programmed_words;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program_IT( uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+  HAL_StatusTypeDef status = HAL_FLASH_Program( TypeProgram, Address, Data);
+  if( status == HAL_OK)
+    HAL_FLASH_EndOfOperationCallback( Address);
+  return status;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase_IT( FLASH_EraseInitTypeDef * pEraseInit)
+{
+  if( pEraseInit->Sector < FLASH_SECTOR_10 || pEraseInit->Sector + pEraseInit->NbSectors > FLASH_SECTOR_10 + SIMULATED_FLASH_SECTORS)
+    return HAL_ERROR;
+  if( not unlocked)
+    {
+      ++state->locked_accesses;
+      return HAL_ERROR;
+    }
+
+  for( unsigned sector = pEraseInit->Sector; sector < pEraseInit->Sector + pEraseInit->NbSectors; ++sector)
+    {
+      unsigned index = sector - FLASH_SECTOR_10;
+      uint32_t * word = (uint32_t *)(uintptr_t)( SIMULATED_FLASH_BASE + index * SIMULATED_FLASH_SECTOR_BYTES);
+      unsigned words = SIMULATED_FLASH_SECTOR_BYTES / sizeof( uint32_t);
+      ++state->erases[index];
+
+      if( power_cut_now())
+	{
+	  for( unsigned i = 0; i < words; ++i)
+	    switch( random_word() & 3)
+	      {
+	      case 0:
+	      case 1:
+		word[i] = 0xffffffff;
+		break;
+	      case 2:
+		break;
+	      case 3:
+		word[i] = random_word();
+		break;
+	      }
+	  _exit( SIMULATED_POWER_CUT_EXIT);
+	}
+
+      memset( word, 0xff, SIMULATED_FLASH_SECTOR_BYTES);
+    }
+  HAL_FLASH_EndOfOperationCallback( 0xffffffff);
+  return HAL_OK;
+}
+
+void HAL_FLASH_IRQHandler( void)
+{}
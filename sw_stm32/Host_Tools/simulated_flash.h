@@ -0,0 +1,63 @@
+/** *****************************************************************************
+ * @file    	simulated_flash.h
+ * @brief   	simulated NOR flash for the EEPROM sectors with power cut injection
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef SIMULATED_FLASH_H_
+#define SIMULATED_FLASH_H_
+
+#include <stdint.h>
+
+#define SIMULATED_FLASH_BASE		0x080C0000 // sector 10, sector 11 follows
+#define SIMULATED_FLASH_SECTOR_BYTES	0x20000
+#define SIMULATED_FLASH_SECTORS		2
+#define SIMULATED_POWER_CUT_EXIT	77 // exit code of a process killed by a power cut
+
+//! flash state and wear, shared between a fuzzer worker and its boot cycles
+typedef struct
+{
+  uint64_t steps;		//!< word programs and sector erases since the start
+  uint64_t power_cut_at_step;	//!< 0: no power cut
+  uint64_t programmed_words;
+  uint64_t erases[SIMULATED_FLASH_SECTORS];
+  uint64_t program_violations;	//!< programming tried to set bits (0 -> 1)
+  uint64_t locked_accesses;	//!< programming or erasing without HAL_FLASH_Unlock()
+  uint64_t random_state;	//!< for the damage done by a power cut
+} simulated_flash_state_t;
+
+/*! \brief map the flash at its target address
+ *
+ *  The flash and its state are shared memory, so they survive the death of
+ *  the child process which plays one boot cycle of the firmware.
+ *  The fixed address lets the driver use its absolute flash addresses unchanged.
+ */
+bool simulated_flash_map( void);
+
+simulated_flash_state_t & simulated_flash_state( void);
+
+//! erase everything without counting wear (factory state)
+void simulated_flash_format( void);
+
+//! direct access for test setup
+uint32_t * simulated_flash_word( uint32_t address);
+
+#endif /* SIMULATED_FLASH_H_ */
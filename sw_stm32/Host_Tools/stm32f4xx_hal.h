@@ -0,0 +1,84 @@
+/** *****************************************************************************
+ * @file    	stm32f4xx_hal.h
+ * @brief   	host replacement of the HAL flash interface, backed by simulated_flash
+ * @author  	Dr. Klaus Schaefer
+ * @copyright 	Copyright 2026 Dr. Klaus Schaefer. All rights reserved.
+ * @license 	This project is released under the GNU Public License GPL-3.0
+
+    <Larus Flight Sensor Firmware>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ **************************************************************************/
+
+#ifndef HOST_STM32F4XX_HAL_H_
+#define HOST_STM32F4XX_HAL_H_
+
+// this file shadows the STM32 HAL when building on the host
+// only the flash and NVIC functions used by the EEPROM file system driver are provided
+
+#include <stdint.h>
+
+#define __ALIGNED(x) __attribute__((aligned(x)))
+
+typedef enum
+{
+  HAL_OK = 0,
+  HAL_ERROR,
+  HAL_BUSY,
+  HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef int IRQn_Type;
+#define FLASH_IRQn 4
+
+#define TYPEPROGRAM_WORD		2
+#define FLASH_TYPEPROGRAM_WORD		2
+#define FLASH_TYPEERASE_SECTORS		0
+#define FLASH_VOLTAGE_RANGE_3		2
+#define FLASH_SECTOR_10			10
+#define FLASH_SECTOR_11			11
+
+typedef struct
+{
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uint32_t Sector;
+  uint32_t NbSectors;
+  uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock( void);
+HAL_StatusTypeDef HAL_FLASH_Lock( void);
+HAL_StatusTypeDef HAL_FLASH_Program( uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASH_Program_IT( uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase_IT( FLASH_EraseInitTypeDef * pEraseInit);
+void HAL_FLASH_IRQHandler( void);
+
+extern "C" void HAL_FLASH_EndOfOperationCallback( uint32_t ReturnValue);
+
+inline uint32_t NVIC_GetPriorityGrouping( void)
+{
+  return 0;
+}
+inline uint32_t NVIC_EncodePriority( uint32_t, uint32_t, uint32_t)
+{
+  return 0;
+}
+inline void NVIC_SetPriority( IRQn_Type, uint32_t)
+{}
+inline void NVIC_EnableIRQ( IRQn_Type)
+{}
+
+#endif /* HOST_STM32F4XX_HAL_H_ */
@@ -111,8 +111,7 @@ extern "C" {
  * TRC_RECORDER_MODE_SNAPSHOT
  * TRC_RECORDER_MODE_STREAMING
  ******************************************************************************/
-#if 0
-
+#if TRACE_STREAMING_TO_SD // see FreeRTOSConfig.h
 #define TRC_CFG_RECORDER_MODE TRC_RECORDER_MODE_STREAMING
 #else
 #define TRC_CFG_RECORDER_MODE TRC_RECORDER_MODE_SNAPSHOT
@@ -224,8 +223,14 @@ extern "C" {
  * recording longer traces in the same amount of RAM.
  *
  * Default value is 1.
+ *
+ * Larus: not streamed, @ 1 kHz they would dominate the uSD card data rate.
  *****************************************************************************/
+#if TRACE_STREAMING_TO_SD
+#define TRC_CFG_INCLUDE_OSTICK_EVENTS 0
+#else
 #define TRC_CFG_INCLUDE_OSTICK_EVENTS 1
+#endif
 
  /*****************************************************************************
  * TRC_CFG_INCLUDE_EVENT_GROUP_EVENTS
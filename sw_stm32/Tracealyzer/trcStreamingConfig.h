@@ -105,8 +105,12 @@ extern "C" {
  * internal buffer to the stream interface (all except for the J-Link port).
  * For such ports, make sure the TzCtrl priority is high enough to ensure
  * reliable periodic execution and transfer of the data.
+ *
+ * Larus: privileged to access the recorder data, lowest priority above idle
+ * to keep the trace from disturbing the data acquisition. If it is starved
+ * the paged buffer overflows and the recorder counts the dropped events.
  ******************************************************************************/
-#define TRC_CFG_CTRL_TASK_PRIORITY 10
+#define TRC_CFG_CTRL_TASK_PRIORITY ((tskIDLE_PRIORITY + 1) | portPRIVILEGE_BIT)
 
 /*******************************************************************************
  * Configuration Macro: TRC_CFG_CTRL_TASK_DELAY
@@ -125,7 +129,7 @@ extern "C" {
  *
  * Note: not used by the J-Link RTT stream port (see trcStreamingPort.h instead)
  ******************************************************************************/
-#define TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT 2
+#define TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT 4
 
 /*******************************************************************************
  * Configuration Macro: TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE
@@ -135,8 +139,10 @@ extern "C" {
  * the Ethernet MTU (Maximum Transmission Unit).
  *
  * Note: not used by the J-Link RTT stream port (see trcStreamingPort.h instead)
+ *
+ * Larus: 4 sectors of the uSD card, the pages are kept in the CCM RAM.
  ******************************************************************************/
-#define TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE 2500
+#define TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE 2048
 
 /*******************************************************************************
  * TRC_CFG_ISR_TAILCHAINING_THRESHOLD
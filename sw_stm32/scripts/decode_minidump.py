@@ -0,0 +1,295 @@
+#!/bin/python3
+
+# Decode a crash minidump (*.MINIDUMP, see Communication/crash_minidump.h)
+# into a readable report, addresses symbolized with the ELF file of the firmware.
+#
+# usage: decode_minidump.py dump.MINIDUMP [Release/sw_sensor.elf] [--log-tail tail.lrsx] [--black-box prefix]
+
+import sys, struct, bisect
+
+MINIDUMP_MAGIC = 0x444d524c
+MINIDUMP_FORMAT_VERSION = 1
+
+MINIDUMP_LOG_TAIL = 1
+MINIDUMP_REGISTERS = 2
+MINIDUMP_TASK = 3
+MINIDUMP_QUEUE = 4
+MINIDUMP_SNAPSHOT = 5
+MINIDUMP_BLACK_BOX = 6
+MINIDUMP_END = 0xffff
+
+FILE_HEADER = struct.Struct('<LLQLLLLLL64s32s')
+SECTION = struct.Struct('<LL')
+LOG_TAIL = struct.Struct('<LLL')
+REGISTERS = struct.Struct('<' + 'L' * 17) # register_dump_t
+TASK = struct.Struct('<L16sLLLLLLLLLL')
+QUEUE = struct.Struct('<L16sLLLL')
+SNAPSHOT = struct.Struct('<LLLL')
+BLACK_BOX = struct.Struct('<LLLLLLL')
+
+BLACK_BOX_STREAMS = {1: 'sensor_data', 2: 'GNSS', 3: 'state_vector'}
+
+TASK_STATES = ['running', 'ready', 'blocked', 'suspended', 'deleted']
+QUEUE_TYPES = ['queue', 'mutex', 'counting semaphore', 'binary semaphore', 'recursive mutex', 'set']
+
+CFSR_BITS = {
+    0: 'IACCVIOL', 1: 'DACCVIOL', 3: 'MUNSTKERR', 4: 'MSTKERR', 5: 'MLSPERR', 7: 'MMARVALID',
+    8: 'IBUSERR', 9: 'PRECISERR', 10: 'IMPRECISERR', 11: 'UNSTKERR', 12: 'STKERR', 13: 'LSPERR', 15: 'BFARVALID',
+    16: 'UNDEFINSTR', 17: 'INVSTATE', 18: 'INVPC', 19: 'NOCP', 24: 'UNALIGNED', 25: 'DIVBYZERO'}
+
+def stm32_crc(crc, data):
+    """Same as Core/Inc/stm32_crc.h, data: bytes, multiple of 4"""
+    for (word,) in struct.iter_unpack('<L', data):
+        crc ^= word
+        for _ in range(32):
+            crc = ((crc << 1) ^ 0x04c11db7) & 0xffffffff if crc & 0x80000000 else (crc << 1) & 0xffffffff
+    return crc
+
+def padded(size):
+    return (size + 3) & ~3
+
+def c_string(raw):
+    return raw.split(b'\0')[0].decode('ascii', 'replace')
+
+class Symbols():
+    """Address to function name and source line, from the ELF symbol table and DWARF line info"""
+    def __init__(self, elf_name):
+        self.functions = []
+        self.lines = []
+        if elf_name is None:
+            return
+        from elftools.elf.elffile import ELFFile
+        self.elf_file = ELFFile(open(elf_name, "rb"))
+
+        symtab = self.elf_file.get_section_by_name('.symtab')
+        for symbol in symtab.iter_symbols():
+            if symbol['st_info']['type'] == 'STT_FUNC' and symbol['st_size'] > 0:
+                self.functions.append((symbol['st_value'] & ~1, symbol['st_size'], symbol.name))
+        self.functions.sort()
+        self.function_starts = [f[0] for f in self.functions]
+
+        if self.elf_file.has_dwarf_info():
+            dwarf = self.elf_file.get_dwarf_info()
+            for cu in dwarf.iter_CUs():
+                program = dwarf.line_program_for_CU(cu)
+                if program is None:
+                    continue
+                file_entries = program.header['file_entry']
+                for entry in program.get_entries():
+                    state = entry.state
+                    if state is None or state.end_sequence or state.file == 0 or state.file > len(file_entries):
+                        continue
+                    self.lines.append((state.address, file_entries[state.file - 1].name.decode(), state.line))
+            self.lines.sort()
+            self.line_starts = [l[0] for l in self.lines]
+
+    def function(self, address):
+        address &= ~1
+        i = bisect.bisect_right(self.function_starts, address) - 1 if self.functions else -1
+        if i >= 0:
+            start, size, name = self.functions[i]
+            if address < start + size:
+                return name, address - start
+        return None
+
+    def describe(self, address):
+        text = f"0x{address:08X}"
+        function = self.function(address)
+        if function:
+            text += f" {function[0]}+0x{function[1]:X}"
+            if self.lines:
+                i = bisect.bisect_right(self.line_starts, address & ~1) - 1
+                if i >= 0:
+                    text += f" ({self.lines[i][1]}:{self.lines[i][2]})"
+        return text
+
+    def is_return_address(self, word):
+        """Thumb return addresses are odd and point into a function"""
+        return (word & 1) == 1 and self.function(word - 1) is not None
+
+def saved_context(stack):
+    """Registers saved by the context switch of port.c (ARM_CM4_MPU)"""
+    if len(stack) < 18:
+        return None
+    registers = {'control': stack[0], 'exc_return': stack[9]}
+    for i in range(8):
+        registers[f"r{i + 4}"] = stack[1 + i]
+    frame = 10 if stack[9] & 0x10 else 26 # s16 .. s31 stacked if the FPU was in use
+    if len(stack) < frame + 8:
+        return None
+    for i, name in enumerate(['r0', 'r1', 'r2', 'r3', 'r12', 'lr', 'pc', 'xpsr']):
+        registers[name] = stack[frame + i]
+    registers['frame_end'] = frame + (8 if stack[9] & 0x10 else 26)
+    return registers
+
+def backtrace(symbols, pc, lr, stack, limit = 16):
+    """pc and lr, then the return addresses found on the stack"""
+    frames = [('pc', pc), ('lr', lr)]
+    if symbols.functions:
+        for offset, word in enumerate(stack):
+            if len(frames) >= limit:
+                break
+            if symbols.is_return_address(word):
+                frames.append((f"sp+{offset * 4:#x}", word))
+    return frames
+
+def black_box_stream(data, csv_prefix):
+    """Records of one black box stream, time relative to the crash, the data as float columns"""
+    stream, record_bytes, data_offset, records, written, interval, current_sample = BLACK_BOX.unpack_from(data)
+    name = BLACK_BOX_STREAMS.get(stream, f"stream{stream}")
+    samples = []
+    for i in range(records):
+        record = BLACK_BOX.size + i * record_bytes
+        sample = struct.unpack_from('<L', data, record)[0]
+        values = struct.unpack_from(f'<{(record_bytes - data_offset) // 4}f', data, record + data_offset)
+        samples.append(((sample - current_sample) * 0.01, values))
+    span = f"{samples[0][0]:.2f} .. {samples[-1][0]:.2f} s" if samples else "empty"
+    print(f"  {name:13} {records:4} of {written} records, every {interval * 10} ms, {span}")
+    if csv_prefix and samples:
+        file_name = f"{csv_prefix}_{name}.csv"
+        with open(file_name, "w") as f:
+            f.write("time," + ",".join(f"w{i}" for i in range(len(samples[0][1]))) + "\n")
+            for time, values in samples:
+                f.write(f"{time:.2f}," + ",".join(f"{v:.7g}" for v in values) + "\n")
+        print(f"    written to '{file_name}'")
+
+def main():
+    args = [a for a in sys.argv[1:]]
+    log_tail_name = None
+    black_box_prefix = None
+    if "--log-tail" in args:
+        i = args.index("--log-tail")
+        log_tail_name = args[i + 1]
+        del args[i:i + 2]
+    if "--black-box" in args:
+        i = args.index("--black-box")
+        black_box_prefix = args[i + 1]
+        del args[i:i + 2]
+    if len(args) < 1:
+        sys.exit("usage: decode_minidump.py dump.MINIDUMP [firmware.elf] [--log-tail tail.lrsx] [--black-box prefix]")
+
+    with open(args[0], "rb") as f:
+        dump = f.read()
+    symbols = Symbols(args[1] if len(args) > 1 else None)
+
+    (magic, version, time_usec, sw_version, id0, id1, id2, crash_line, tick_count,
+     crash_file, git_tag) = FILE_HEADER.unpack_from(dump)
+    if magic != MINIDUMP_MAGIC:
+        sys.exit(f"'{args[0]}' is no minidump")
+    if version != MINIDUMP_FORMAT_VERSION:
+        sys.exit(f"minidump format version {version} not supported")
+
+    print(f"Firmware:   {c_string(git_tag)} (0x{sw_version:08X})")
+    print(f"Hardware:   {id0:08X} {id1:08X} {id2:08X}")
+    print(f"Crash:      {c_string(crash_file)} line {crash_line}")
+    print(f"Uptime:     {time_usec / 1e6:.3f} s, tick {tick_count}")
+
+    sections = []
+    offset = FILE_HEADER.size
+    complete = False
+    while offset + SECTION.size <= len(dump):
+        section_type, size = SECTION.unpack_from(dump, offset)
+        payload = offset + SECTION.size
+        if section_type == MINIDUMP_END:
+            if payload + 4 <= len(dump):
+                expected = struct.unpack_from('<L', dump, payload)[0]
+                complete = stm32_crc(0xffffffff, dump[:payload]) == expected
+            break
+        if payload + size > len(dump):
+            break
+        sections.append((section_type, dump[payload:payload + size]))
+        offset = payload + padded(size)
+    print(f"Integrity:  {'CRC ok' if complete else 'INCOMPLETE or corrupt, decoding what is there'}")
+
+    registers = None
+    tasks = []
+    for section_type, data in sections:
+        if section_type == MINIDUMP_REGISTERS:
+            registers = REGISTERS.unpack_from(data)
+            fpu_dump = struct.unpack_from('<32L', data, REGISTERS.size) if len(data) >= REGISTERS.size + 128 else None
+        elif section_type == MINIDUMP_TASK:
+            task = TASK.unpack_from(data)
+            stack = [w for (w,) in struct.iter_unpack('<L', data[TASK.size:TASK.size + task[11] * 4])]
+            tasks.append((task, stack))
+
+    task_names = {task[0]: c_string(task[1]) for task, _ in tasks}
+    active_tcb = registers[16] if registers else 0
+
+    if registers:
+        (r0, r1, r2, r3, r12, lr, pc, psr, bfar, mmfar, mmfsr, fpscr, bfsr, hfsr, ufsr, ipsr) = registers[:16]
+        cfsr = mmfsr | (bfsr << 8) | (ufsr << 16)
+        print(f"\nRegisters of {task_names.get(active_tcb, f'TCB 0x{active_tcb:08X}')}")
+        print(f"  PC    {symbols.describe(pc)}")
+        print(f"  LR    {symbols.describe(lr)}")
+        print(f"  R0 {r0:08X}  R1 {r1:08X}  R2 {r2:08X}  R3 {r3:08X}  R12 {r12:08X}  xPSR {psr:08X}")
+        print(f"  IPSR  {ipsr}  HFSR {hfsr:08X}  CFSR {cfsr:08X} {' '.join(n for b, n in CFSR_BITS.items() if cfsr & (1 << b))}")
+        if cfsr & (1 << 7):
+            print(f"  MMFAR {mmfar:08X}")
+        if cfsr & (1 << 15):
+            print(f"  BFAR  {bfar:08X}")
+        print(f"  FPSCR {fpscr:08X}")
+        if fpu_dump and any(fpu_dump):
+            print("  " + " ".join(f"s{i}={struct.unpack('<f', struct.pack('<L', w))[0]:.6g}" for i, w in enumerate(fpu_dump)))
+
+    print(f"\n{'Task':16} {'State':10} {'Prio':>4} {'Stack':>6} {'Used':>6} {'Free':>6}  TCB")
+    for task, stack in tasks:
+        (handle, name, number, state, current_priority, base_priority, run_time,
+         stack_base, stack_end, top_of_stack, high_water_mark, stack_words) = task
+        size = (stack_end - stack_base) // 4 + 1
+        marker = " <- crashed" if handle == active_tcb else ""
+        state_name = TASK_STATES[state] if state < len(TASK_STATES) else str(state)
+        print(f"{c_string(name):16} {state_name:10} {current_priority:4} {size:6} {size - high_water_mark:6} {high_water_mark:6}  0x{handle:08X}{marker}")
+
+    for task, stack in tasks:
+        handle, name = task[0], c_string(task[1])
+        print(f"\nTask {name}: stack 0x{task[7]:08X}..0x{task[8]:08X}, saved SP 0x{task[9]:08X}")
+        context = saved_context(stack)
+        if handle == active_tcb and registers:
+            pc, lr = registers[6], registers[5]
+        elif context:
+            pc, lr = context['pc'], context['lr']
+            print("  " + " ".join(f"{r}={context[r]:08X}" for r in ['r4', 'r5', 'r6', 'r7', 'r8', 'r9', 'r10', 'r11']))
+            print("  " + " ".join(f"{r}={context[r]:08X}" for r in ['r0', 'r1', 'r2', 'r3', 'r12', 'xpsr', 'control', 'exc_return']))
+        else:
+            print("  no saved context")
+            continue
+        frame_stack = stack[context['frame_end']:] if context else stack
+        for where, address in backtrace(symbols, pc, lr, frame_stack):
+            print(f"  {where:>9}  {symbols.describe(address)}")
+
+    print(f"\n{'Queue':16} {'Type':20} {'Waiting':>7} {'Free':>5}  Holder")
+    for section_type, data in sections:
+        if section_type == MINIDUMP_QUEUE:
+            handle, name, queue_type, waiting, spaces, holder = QUEUE.unpack_from(data)
+            type_name = QUEUE_TYPES[queue_type] if queue_type < len(QUEUE_TYPES) else str(queue_type)
+            holder_name = task_names.get(holder, f"0x{holder:08X}") if holder else ""
+            print(f"{c_string(name):16} {type_name:20} {waiting:7} {spaces:5}  {holder_name}")
+
+    for section_type, data in sections:
+        if section_type == MINIDUMP_SNAPSHOT:
+            sizes = SNAPSHOT.unpack_from(data)
+            offset = SNAPSHOT.size
+            parts = []
+            for size in sizes:
+                parts.append(data[offset:offset + size])
+                offset += padded(size)
+            observations, coordinates, system_state, state_vector = parts
+            print(f"\nsystem_state 0x{struct.unpack_from('<L', system_state)[0]:08X}")
+            print("observations " + " ".join(f"{v:.5g}" for (v,) in struct.iter_unpack('<f', observations[:len(observations) // 4 * 4])))
+            print("state_vector " + " ".join(f"{v:.5g}" for (v,) in struct.iter_unpack('<f', state_vector[:len(state_vector) // 4 * 4])))
+        elif section_type == MINIDUMP_LOG_TAIL:
+            header_words, trailer_words, dropped = LOG_TAIL.unpack_from(data)
+            tail = data[LOG_TAIL.size:]
+            print(f"\nLog tail: {len(tail)} bytes, record framing {header_words}+{trailer_words} words, {dropped} records dropped")
+            if log_tail_name:
+                with open(log_tail_name, "wb") as f:
+                    f.write(tail)
+                print(f"  written to '{log_tail_name}', decode with Host_Tools/lrsx_decode")
+
+    black_box = [data for section_type, data in sections if section_type == MINIDUMP_BLACK_BOX]
+    if black_box:
+        print("\nBlack box, time relative to the crash:")
+        for data in black_box:
+            black_box_stream(data, black_box_prefix)
+
+main()
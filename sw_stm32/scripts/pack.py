@@ -1,6 +1,6 @@
 #!/bin/python3
 
-import sys, io, toml, struct
+import sys, io, toml, struct, hashlib
 
 from elftools.elf.elffile import ELFFile
 from elftools.elf.relocation import RelocationSection
@@ -19,6 +19,22 @@ def stm32_crc(data):
             buf = bytearray()
     return crc
 
+IMAGE_MAGIC = 0x1c80_73ab_2085_3579
+DELTA_MAGIC = 0x1c80_73ab_2085_d17a
+DELTA_BLOCK = 32 # smallest run of bytes taken from the installed application
+DELTA_OP_COPY = 0x40000000
+DELTA_OP_ADD = 0x80000000
+
+# A/B boot slots, see Core/Inc/boot_slots.h
+BOOT_SLOT_MAGIC = 0x1c80_73ab_2085_510b
+BOOT_SELECTOR_ADDR = 0x0800_0000
+BOOT_SELECTOR_BYTES = 0x4000 # flash sector 0
+BOOT_SLOT_A_ADDR = 0x0800_4000
+BOOT_SLOT_B_ADDR = 0x0806_0000
+BOOT_SLOT_BYTES = 0x5_c000
+BOOT_SLOT_HEADER_BYTES = 0x200
+BOOT_SLOT_STATE_WORDS = 4 # sequence, trial, confirmed, revoked: programmed on the device
+
 def get_version(version_str):
         shift_fact = 0
         version = 0
@@ -96,7 +112,7 @@ class Binary():
     def create_meta_data(self):
         """Create the meta data needed"""
         data = {
-             'Magic Number': 0x1c80_73ab_2085_3579,
+             'Magic Number': IMAGE_MAGIC,
              'CRC <place holder>': 0x12345678,
              'Meta Data Version': 1,
              'Storage Address': self.addr_storage,
@@ -130,8 +146,146 @@ class Binary():
         print(f"Writing binary to file '{self.name}'")
         with open(self.name, "wb") as bin_file:
             bin_file.write(binary)
+        self.binary = binary
+
+    def write_delta(self, base_image_name):
+        """Save a delta which rebuilds this image from the application installed by base_image_name"""
+        with open(base_image_name, "rb") as f:
+            base_image = f.read()
+        header = struct.unpack_from('<QLLLLLLLLL', base_image)
+        if header[0] != IMAGE_MAGIC:
+            sys.exit(f"'{base_image_name}' is no Larus image")
+        base_sw_version = header[5]
+        base_app = base_image[header[7] - header[3]:][:header[8]]
+
+        print(f"\nCreating delta against '{base_image_name}' (software version 0x{base_sw_version:08X})")
+        ops = create_delta_ops(base_app, self.binary)
+
+        data = {
+             'Magic Number': DELTA_MAGIC,
+             'CRC <place holder>': 0x12345678,
+             'Delta Format Version': 1,
+             'Base Software Version': base_sw_version,
+             'Hardware Version': self.hw_version,
+             'Software Version': self.sw_version,
+             'Base Length': len(base_app),
+             'Image Length': len(self.binary),
+             'Image CRC': struct.unpack_from('<L', self.binary, 8)[0],
+             'Delta Length': 80 + len(ops),
+             'Reserved': 0
+        }
+        for key, value in data.items():
+            print(f"  {key:21}0x{value:08X}")
+
+        delta = bytearray(struct.pack('<QLLLLLLLLLL', *data.values()))
+        delta += hashlib.sha256(base_app).digest()
+        delta += ops
+        delta[8:12] = struct.pack("<L", stm32_crc(delta[12:]))
+
+        name = self.name[:-4] + "_delta.bin" if self.name.endswith(".bin") else self.name + "_delta.bin"
+        print(f"\nTotal size of delta: {round(len(delta) / 1024)}k")
+        print(f"Writing delta to file '{name}'")
+        with open(name, "wb") as bin_file:
+            bin_file.write(delta)
 
-if ((len(sys.argv) == 2) and ("LEGACY" in str(sys.argv[1]))):
+    def create_slot_image(self, elf_name, slot_addr):
+        """Slot header and the application linked for this slot"""
+        app = ReadApp(elf_name)
+        app_bin = app.get_binary(slot_addr + BOOT_SLOT_HEADER_BYTES, slot_addr + BOOT_SLOT_BYTES)
+        if app.get_symbol_address("g_pfnVectors") != slot_addr + BOOT_SLOT_HEADER_BYTES:
+            sys.exit(f"'{elf_name}' is not linked for the slot at 0x{slot_addr:08X}")
+
+        data = {
+             'Magic Number': BOOT_SLOT_MAGIC,
+             'CRC <place holder>': 0x12345678,
+             'Header Version': 1,
+             'Link Address': slot_addr,
+             'Hardware Version': self.hw_version,
+             'Software Version': self.sw_version,
+             'Image Length': BOOT_SLOT_HEADER_BYTES + len(app_bin)
+        }
+        print(f'\nCreating Slot Header for 0x{slot_addr:08X}:')
+        for key, value in data.items():
+            print(f"  {key:21}0x{value:08X}")
+
+        header = bytearray(struct.pack('<QLLLLLL', *data.values()))
+        header += bytes(4 * 16 - len(header))
+        header += struct.pack('<' + 'L' * BOOT_SLOT_STATE_WORDS, *[0xffffffff] * BOOT_SLOT_STATE_WORDS)
+        header += bytes(BOOT_SLOT_HEADER_BYTES - len(header))
+
+        image = header + app_bin
+        if len(image) > BOOT_SLOT_BYTES:
+            sys.exit(f"'{elf_name}' does not fit into a boot slot")
+        image[8:12] = struct.pack("<L", stm32_crc(image[12:]))
+        return image
+
+    def write_slot_files(self, slots):
+        """Save the update image with both slot variants and the migration image for the legacy layout"""
+        slot_a = self.create_slot_image(slots["elf_a"], BOOT_SLOT_A_ADDR)
+        slot_b = self.create_slot_image(slots["elf_b"], BOOT_SLOT_B_ADDR)
+
+        base_name = self.name[:-4] if self.name.endswith(".bin") else self.name
+        name = base_name + "_ab.bin"
+        print(f"\nTotal size of slot image: {round((len(slot_a) + len(slot_b)) / 1024)}k")
+        print(f"Writing slot image to file '{name}'")
+        with open(name, "wb") as bin_file:
+            bin_file.write(slot_a + slot_b)
+
+        # installed by the copy function of a sensor without boot selector
+        with open(slots["selector"], "rb") as f:
+            selector = f.read()
+        if len(selector) > BOOT_SELECTOR_BYTES:
+            sys.exit(f"'{slots['selector']}' does not fit into flash sector 0")
+        self.app_bin = selector + b'\xff' * (BOOT_SELECTOR_BYTES - len(selector)) + slot_a
+        self.app_addr_start = BOOT_SELECTOR_ADDR
+        if 0x1000 + len(self.copy_bin) + len(self.app_bin) > BOOT_SLOT_B_ADDR + 0x6_0000 - self.addr_storage:
+            sys.exit("the migration image does not fit into the update storage")
+        self.name = base_name + "_migrate.bin"
+        self.write_file()
+
+def create_delta_ops(base, target):
+    """Block-wise delta: COPY runs found in base, everything else as ADD (literal) words"""
+    index = {}
+    for ofs in range(0, len(base) - DELTA_BLOCK + 1, 4):
+        index.setdefault(bytes(base[ofs:ofs + DELTA_BLOCK]), ofs)
+
+    ops = bytearray()
+    literal = bytearray()
+    copied = 0
+
+    def flush_literal():
+        if literal:
+            ops.extend(struct.pack('<L', DELTA_OP_ADD | (len(literal) // 4)))
+            ops.extend(literal)
+            literal.clear()
+
+    pos = 0
+    while pos < len(target):
+        source = index.get(bytes(target[pos:pos + DELTA_BLOCK]))
+        if source is None:
+            literal.extend(target[pos:pos + 4])
+            pos += 4
+            continue
+        length = DELTA_BLOCK
+        while (pos + length < len(target) and source + length < len(base)
+               and target[pos + length:pos + length + 4] == base[source + length:source + length + 4]):
+            length += 4
+        flush_literal()
+        ops.extend(struct.pack('<LL', DELTA_OP_COPY | (length // 4), source))
+        copied += length
+        pos += length
+    flush_literal()
+
+    print(f"  {copied} of {len(target)} bytes taken from the installed application")
+    return ops
+
+# usage: pack.py [LEGACY] [--delta installed_image.bin] [--slots]
+if "--delta" in sys.argv and sys.argv.index("--delta") + 1 < len(sys.argv):
+    base_image_name = sys.argv[sys.argv.index("--delta") + 1]
+else:
+    base_image_name = None
+
+if ((len(sys.argv) >= 2) and ("LEGACY" in str(sys.argv[1]))):
     print("Larus App Image Packer - Legacy")
     with open("scripts/pack_legacy.toml", "r") as f:
         spec = toml.load(f)
@@ -139,6 +293,8 @@ if ((len(sys.argv) == 2) and ("LEGACY" in str(sys.argv[1]))):
         image.read_new_app(spec["app"])
         image.read_copy_app(spec["copy"])
         image.write_file()
+        if base_image_name:
+            image.write_delta(base_image_name)
 
 else:
     print("Larus App Image Packer")
@@ -148,6 +304,7 @@ else:
         image.read_new_app(spec["app"])
         image.read_copy_app(spec["copy"])
         image.write_file()
-
-
-
+        if base_image_name:
+            image.write_delta(base_image_name)
+        if "--slots" in sys.argv:
+            image.write_slot_files(spec["slots"])
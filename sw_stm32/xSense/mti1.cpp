@@ -34,6 +34,8 @@
 #include "stdint.h"
 #include "communicator.h"
 #include "system_state.h"
+#include "warm_restart.h"
+#include "boot_timeline.h"
 
 #if RUN_MTi_1_MODULE
 
@@ -61,7 +63,7 @@ COMMON traceHandle EXTI15_10_Handle;
 #endif
 
 static inline void
-init_ports_and_reset_mti (void) // GPIO stuff
+init_ports_and_reset_mti (bool reset_mti) // GPIO stuff
 {
 #if TRACE_ISR == 1
   EXTI15_10_Handle = xTraceSetISRProperties("EXTI15_10", 15);
@@ -80,6 +82,7 @@ init_ports_and_reset_mti (void) // GPIO stuff
   HAL_GPIO_WritePin ( IMU_PORT, IMU_PSEL0, GPIO_PIN_RESET);
   HAL_GPIO_WritePin ( IMU_PORT, IMU_PSEL1, GPIO_PIN_SET);
 
+  HAL_GPIO_WritePin ( IMU_PORT, IMU_NRST, GPIO_PIN_SET); // no reset pulse by the configuration
   GPIO_InitStruct.Pin = IMU_NRST;
   GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
   HAL_GPIO_Init (IMU_PORT, &GPIO_InitStruct);
@@ -91,6 +94,9 @@ init_ports_and_reset_mti (void) // GPIO stuff
   HAL_NVIC_SetPriority (EXTI15_10_IRQn, STANDARD_ISR_PRIORITY, 0);
   HAL_NVIC_EnableIRQ (EXTI15_10_IRQn);
 
+  if( not reset_mti)
+    return;
+
   HAL_GPIO_WritePin ( IMU_PORT, IMU_NRST, GPIO_PIN_RESET);
   delay (PLANNED_DELAY_4_MTI_MS);
   HAL_GPIO_WritePin ( IMU_PORT, IMU_NRST, GPIO_PIN_SET);
@@ -210,17 +216,36 @@ static void run (void*)
 	chn = xTraceRegisterString("MTi-ISR");
 	drop_privileges();
 #endif
+  // the MTi has not seen the reset of the processor and is still measuring
+  bool warm_restart = warm_restart_available ();
+
 restart:
 
   acquire_privileges();
-  init_ports_and_reset_mti ();
+  init_ports_and_reset_mti ( not warm_restart);
   drop_privileges();
 
+  (void) MTi_ready.wait (0); // forget data ready events from before the reset
+
   uint8_t buf[DATA_BUFSIZE_BYTES];
   MtsspDriverSpi SPI_driver;
   MtsspInterface IMU_interface (&SPI_driver);
 
-  delay (LONGEST_WAIT_4_MTI_MS); // MTi 1 typically needs 168ms to reset itself
+  if( warm_restart)
+    {
+      warm_restart = false; // on any failure: reset and configure the MTi
+
+      readDataFrom_MTI (&IMU_interface, buf); // data ready is pending since the reset
+      if( false == MTi_ready.wait (LONGEST_WAIT_4_MTI_MS))
+	goto restart;
+      readDataFrom_MTI (&IMU_interface, buf);
+
+      update_system_state_set (MTI_SENSOR_AVAILABE);
+      goto start_measurement;
+    }
+
+  // MTi 1 typically needs 168ms to reset itself, then it signals data ready
+  (void) MTi_ready.wait (LONGEST_WAIT_4_MTI_MS);
 
   if( false == checkDataReadyLine())
 	goto restart;
@@ -266,6 +291,7 @@ restart:
 	}
     }
 
+start_measurement:
   XbusMessage cnf (XMID_GotoMeasurement);
   IMU_interface.sendXbusMessage (&cnf);
 
@@ -283,6 +309,8 @@ restart:
       readDataFrom_MTI (&IMU_interface, buf);
     }
 
+  boot_milestone (BOOT_MTI_MEASURING);
+
   while (true)
     {
       if( false == MTi_ready.wait (DAQ_LOOP_WAIT_4_MTI_MS))